@@ -0,0 +1,98 @@
+/*
+ * WMBag scaling benchmark.
+ *
+ * For bags of 10, 100, 1000 and 10000 items, measures the average time of
+ * inserting and deleting at the front (which shifts the index of every
+ * other item), getting an item by index, and finding and removing an
+ * item by value. All of them should grow logarithmically with the size.
+ *
+ * usage: bagbench [operations]
+ */
+
+#include <WINGs/WUtil.h>
+
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static WMBag *createBag(int size)
+{
+	WMBag *bag = WMCreateBag(size);
+	long i;
+
+	for (i = 0; i < size; i++)
+		WMPutInBag(bag, (void *)(i + 1));
+
+	return bag;
+}
+
+int main(int argc, char **argv)
+{
+	static const int sizes[] = { 10, 100, 1000, 10000 };
+	int operations = 100000;
+	double start, insert, get, find, remove;
+	WMBag *bag;
+	long item;
+	int i, j, size;
+
+	if (argc > 1)
+		operations = atoi(argv[1]);
+	if (operations < 1) {
+		fprintf(stderr, "usage: %s [operations]\n", argv[0]);
+		return 1;
+	}
+
+	printf("%8s %14s %14s %14s %14s\n", "items", "insert+delete", "get", "first", "remove+put");
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		size = sizes[i];
+		bag = createBag(size);
+
+		/* insert at the front and delete it again: the size stays the same */
+		start = now();
+		for (j = 0; j < operations; j++) {
+			WMInsertInBag(bag, 0, (void *)-1L);
+			WMDeleteFromBag(bag, 0);
+		}
+		insert = now() - start;
+
+		start = now();
+		for (j = 0, item = 0; j < operations; j++)
+			item += (long)WMGetFromBag(bag, (j * 7919) % size);
+		get = now() - start;
+		if (item == 0)
+			fprintf(stderr, "%s: empty bag\n", argv[0]);
+
+		start = now();
+		for (j = 0; j < operations; j++) {
+			if (WMGetFirstInBag(bag, (void *)(long)((j * 7919) % size + 1)) == WBNotFound)
+				fprintf(stderr, "%s: item not found\n", argv[0]);
+		}
+		find = now() - start;
+
+		/* remove an item and put it back at the end */
+		start = now();
+		for (j = 0; j < operations; j++) {
+			item = (j * 7919) % size + 1;
+			WMRemoveFromBag(bag, (void *)item);
+			WMPutInBag(bag, (void *)item);
+		}
+		remove = now() - start;
+
+		printf("%8d %11.3f us %11.3f us %11.3f us %11.3f us\n", size,
+		       insert * 1000000.0 / operations, get * 1000000.0 / operations,
+		       find * 1000000.0 / operations, remove * 1000000.0 / operations);
+
+		WMFreeBag(bag);
+	}
+
+	return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * Checks of wfindfile() and wfindfileinlist() through the directory
+ * listing cache.
+ *
+ * A file that is there must be found, and a dangling symbolic link must
+ * be reported as missing, like access() does, even when its name is in
+ * the listing of the directory.
+ *
+ * usage: findtest
+ */
+
+#include <WINGs/WUtil.h>
+
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+static void check(const char *what, const char *paths, const char *file, Bool found)
+{
+	char *list[2];
+	char *path;
+	int i;
+
+	list[0] = (char *)paths;
+	list[1] = NULL;
+
+	for (i = 0; i < 2; i++) {
+		path = i == 0 ? wfindfile(paths, file) : wfindfileinlist(list, file);
+		if ((path != NULL) != found) {
+			printf("FAIL: %s: %s %s\n", what, i == 0 ? "wfindfile" : "wfindfileinlist",
+			       found ? "did not find it" : path);
+			failures++;
+		}
+		if (path)
+			wfree(path);
+	}
+}
+
+static void checkAll(const char *dir)
+{
+	check("regular file", dir, "present", True);
+	check("missing file", dir, "absent", False);
+	check("dangling symlink", dir, "dangling", False);
+	check("symlink to a file", dir, "link", True);
+}
+
+int main(void)
+{
+	char dir[] = "/tmp/findtestXXXXXX";
+	WMFindFileStatistics stats;
+	char *path;
+	FILE *file;
+
+	if (!mkdtemp(dir)) {
+		perror("mkdtemp");
+		return 2;
+	}
+
+	path = wstrconcat(dir, "/present");
+	file = fopen(path, "w");
+	if (file)
+		fclose(file);
+	wfree(path);
+
+	path = wstrconcat(dir, "/dangling");
+	if (symlink("nowhere", path) < 0)
+		perror("symlink");
+	wfree(path);
+
+	path = wstrconcat(dir, "/link");
+	if (symlink("present", path) < 0)
+		perror("symlink");
+	wfree(path);
+
+	/* the second round goes through the listing read by the first */
+	checkAll(dir);
+	checkAll(dir);
+
+	WMGetFindFileStatistics(&stats);
+	if (stats.cached == 0 && getenv("WINGS_NO_FILE_CACHE") == NULL) {
+		printf("FAIL: the directory listing was not used\n");
+		failures++;
+	}
+
+	path = wstrconcat(dir, "/present");
+	unlink(path);
+	wfree(path);
+	path = wstrconcat(dir, "/dangling");
+	unlink(path);
+	wfree(path);
+	path = wstrconcat(dir, "/link");
+	unlink(path);
+	wfree(path);
+	rmdir(dir);
+
+	if (failures == 0)
+		printf("findtest: all checks passed\n");
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+/*
+ * Property list parser benchmark.
+ *
+ * Generates a WMWindowAttributes-like domain file with the given number of
+ * entries and reads it back repeatedly with WMReadPropListFromFile(),
+ * reporting the throughput and how many heap allocations one parse costs.
+ * The same property list is then loaded back from its compiled form with
+ * WMReadPropListFromCompiledFile() for comparison.
+ *
+ * usage: plbench [entries [iterations]]
+ */
+
+#include <WINGs/WUtil.h>
+
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __GLIBC__
+/* count the allocations done by the library by wrapping the libc allocator */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static unsigned long allocCount = 0;
+
+void *malloc(size_t size)
+{
+	allocCount++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	allocCount++;
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	allocCount++;
+	return __libc_realloc(ptr, size);
+}
+#define HAVE_ALLOC_COUNT
+#endif
+
+static const char *classes[] = {
+	"XTerm", "Firefox", "Emacs", "Gimp", "Thunderbird", "URxvt", "Xpdf", "Pidgin"
+};
+
+static void writeDomain(FILE *f, int entries)
+{
+	int i;
+
+	fputs("{\n", f);
+	for (i = 0; i < entries; i++) {
+		const char *class = classes[i % (sizeof(classes) / sizeof(classes[0]))];
+
+		fprintf(f, "  \"instance%d.%s\" = {\n", i, class);
+		fprintf(f, "    Icon = \"/usr/share/icons/hicolor/48x48/apps/%s-%d.png\";\n", class, i);
+		fputs("    NoAppIcon = No;\n", f);
+		fputs("    SharedAppIcon = Yes;\n", f);
+		fputs("    AlwaysUserIcon = Yes;\n", f);
+		fprintf(f, "    StartWorkspace = \"Workspace %d\";\n", i % 4);
+		fprintf(f, "    Command = \"%s -title \\\"window %d\\\"\\n\";\n", class, i);
+		fputs("    Geometry = (0, 0, 640, 480);\n", f);
+		fputs("  };\n", f);
+	}
+	fputs("}\n", f);
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int main(int argc, char **argv)
+{
+	char path[] = "/tmp/plbench.XXXXXX";
+	char *cpath;
+	const char *sources[2];
+	WMPropList *compiled;
+	int entries = 2000, iterations = 50;
+	WMPropList *plist;
+	long size;
+	double start, elapsed;
+	int fd, i;
+	FILE *f;
+#ifdef HAVE_ALLOC_COUNT
+	unsigned long allocs;
+#endif
+
+	if (argc > 1)
+		entries = atoi(argv[1]);
+	if (argc > 2)
+		iterations = atoi(argv[2]);
+	if (entries < 1 || iterations < 1) {
+		fprintf(stderr, "usage: %s [entries [iterations]]\n", argv[0]);
+		return 1;
+	}
+
+	fd = mkstemp(path);
+	if (fd < 0 || (f = fdopen(fd, "w")) == NULL) {
+		perror(path);
+		return 1;
+	}
+	writeDomain(f, entries);
+	size = ftell(f);
+	fclose(f);
+
+	/* warm up the page cache and check that the file parses */
+	plist = WMReadPropListFromFile(path);
+	if (!plist || WMGetPropListItemCount(plist) != entries) {
+		fprintf(stderr, "%s: could not parse generated file %s\n", argv[0], path);
+		unlink(path);
+		return 1;
+	}
+	WMReleasePropList(plist);
+
+#ifdef HAVE_ALLOC_COUNT
+	allocs = allocCount;
+#endif
+	start = now();
+	for (i = 0; i < iterations; i++) {
+		plist = WMReadPropListFromFile(path);
+		WMReleasePropList(plist);
+	}
+	elapsed = now() - start;
+
+	printf("%d entries, %ld bytes, %d iterations\n", entries, size, iterations);
+	printf("parse: %.3f ms/file, %.1f MB/s\n", elapsed * 1000.0 / iterations,
+	       (double)size * iterations / elapsed / (1024.0 * 1024.0));
+#ifdef HAVE_ALLOC_COUNT
+	printf("allocations: %lu per parse\n", (allocCount - allocs) / iterations);
+#endif
+
+	sources[0] = path;
+	sources[1] = NULL;
+	cpath = wstrconcat(path, ".cache");
+	plist = WMReadPropListFromFile(path);
+	if (!WMWritePropListToCompiledFile(plist, cpath, sources)) {
+		fprintf(stderr, "%s: could not write compiled file %s\n", argv[0], cpath);
+		unlink(path);
+		return 1;
+	}
+	compiled = WMReadPropListFromCompiledFile(cpath, sources);
+	if (!compiled || !WMIsPropListEqualTo(plist, compiled)) {
+		fprintf(stderr, "%s: compiled file %s does not match the text\n", argv[0], cpath);
+		unlink(cpath);
+		unlink(path);
+		return 1;
+	}
+	WMReleasePropList(compiled);
+	WMReleasePropList(plist);
+
+#ifdef HAVE_ALLOC_COUNT
+	allocs = allocCount;
+#endif
+	start = now();
+	for (i = 0; i < iterations; i++) {
+		plist = WMReadPropListFromCompiledFile(cpath, sources);
+		WMReleasePropList(plist);
+	}
+	elapsed = now() - start;
+
+	printf("compiled: %.3f ms/file\n", elapsed * 1000.0 / iterations);
+#ifdef HAVE_ALLOC_COUNT
+	printf("allocations: %lu per load\n", (allocCount - allocs) / iterations);
+#endif
+
+	unlink(cpath);
+	wfree(cpath);
+	unlink(path);
+
+	return 0;
+}
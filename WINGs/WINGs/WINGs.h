@@ -463,6 +463,27 @@ typedef struct WMInputPanel {
 } WMInputPanel;
 
 
+/* how WMTruncateString() makes a string fit */
+typedef enum WMTruncationMode {
+    WTTruncateTail,		       /* "beginning of the te..." */
+    WTTruncateMiddle		       /* "first ...end of the text" */
+} WMTruncationMode;
+
+
+/*
+ * Remembers the last string truncated by a caller, so repainting the same
+ * text at the same width does not measure it again. Must be zeroed before
+ * the first use and released with WMFreeTruncationCache().
+ */
+typedef struct WMTruncationCache {
+    WMFont *font;
+    char *text;
+    char *result;
+    int width;
+    WMTruncationMode mode;
+} WMTruncationCache;
+
+
 /* Basic font styles. Used to easily get one style from another */
 typedef enum WMFontStyle {
     WFSNormal = 0,
@@ -816,6 +837,24 @@ void WMDrawImageString(WMScreen *scr, Drawable d, WMColor *color,
 
 int WMWidthOfString(WMFont *font, const char *text, int length);
 
+/*
+ * Measures all the prefixes of text at once: widths must have room for
+ * length + 1 entries, and widths[i] is set to the width of the first i
+ * bytes. Returns the width of the whole text.
+ */
+int WMWidthsOfStringPrefixes(WMFont *font, const char *text, int length, int *widths);
+
+/*
+ * Returns a newly allocated copy of text shortened with "..." so that it
+ * fits in width pixels. In WTTruncateMiddle mode the first word is kept
+ * if it fits and the end of the text is shown after the dots. cache may
+ * be NULL.
+ */
+char* WMTruncateString(WMFont *font, const char *text, int width,
+                       WMTruncationMode mode, WMTruncationCache *cache);
+
+void WMFreeTruncationCache(WMTruncationCache *cache);
+
 /* ---[ WINGs/wpixmap.c ]------------------------------------------------- */
 
 WMPixmap* WMRetainPixmap(WMPixmap *pixmap);
@@ -1256,6 +1295,9 @@ void WMSetListUserDrawItemHeight(WMList *lPtr, unsigned short height);
 
 int WMGetListItemHeight(WMList *lPtr);
 
+/* repaints a single row, if it is visible */
+void WMRedisplayListItem(WMList *lPtr, int row);
+
 /* don't free the returned data */
 WMArray* WMGetListSelectedItems(WMList *lPtr);
 
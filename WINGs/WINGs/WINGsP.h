@@ -459,6 +459,9 @@ typedef struct W_Font {
     short refCount;
     char *name;
 
+    unsigned short *advances;      /* advance + 1 of the first 256 chars, 0 if unknown */
+    WMHashTable *wideAdvances;     /* same for the others */
+
 #ifdef USE_PANGO
     PangoLayout *layout;
 #endif
@@ -200,6 +200,13 @@ void* wmalloc(size_t size);
 void* wrealloc(void *ptr, size_t newsize);
 void wfree(void *ptr);
 
+void* W_Malloc(size_t size, const char *file, int line);
+void* W_Realloc(void *ptr, size_t newsize, const char *file, int line);
+
+/* the caller is recorded when memory accounting is on */
+#define wmalloc(size) W_Malloc(size, __FILE__, __LINE__)
+#define wrealloc(ptr, newsize) W_Realloc(ptr, newsize, __FILE__, __LINE__)
+
 void wrelease(void *ptr);
 void* wretain(void *ptr);
 
@@ -207,6 +214,56 @@ typedef void waborthandler(int);
 
 waborthandler* wsetabort(waborthandler* handler);
 
+/*
+ * A slab allocates small objects of a single type from shared blocks,
+ * which saves the per-allocation overhead of malloc() and keeps objects
+ * of the same type together. Slabs also count their objects, so the
+ * statistics can point at leaks. Objects are zero filled like wmalloc().
+ */
+typedef struct W_Slab WMSlab;
+
+typedef struct WMSlabStatistics {
+	const char *name;
+	size_t objectSize;		/* rounded up to the size class */
+	unsigned long live;		/* objects currently allocated */
+	unsigned long peak;		/* most objects allocated at once */
+	unsigned long allocated;	/* objects allocated since startup */
+	size_t bytes;			/* bytes used by the live objects */
+	size_t reserved;		/* bytes held by the slab */
+} WMSlabStatistics;
+
+WMSlab* WMCreateSlab(const char *name, size_t objectSize);
+
+void* WMSlabAlloc(WMSlab *slab);
+
+void WMSlabFree(WMSlab *slab, void *ptr);
+
+/* fills up to count entries and returns how many slabs there are */
+int WMGetSlabStatistics(WMSlabStatistics *stats, int count);
+
+void WMLogSlabStatistics(void);
+
+/*
+ * Memory accounting is turned on by setting WINGS_MEMORY_STATS in the
+ * environment. Each source line calling wmalloc() or wrealloc() is then
+ * an allocation site, counting the blocks it holds.
+ */
+typedef struct WMMemorySiteStatistics {
+	const char *file;
+	int line;
+	unsigned long live;		/* blocks currently allocated */
+	unsigned long allocated;	/* blocks allocated since startup */
+	size_t bytes;			/* bytes held by the live blocks */
+} WMMemorySiteStatistics;
+
+/* fills up to count entries, biggest first, and returns how many sites
+ * there are */
+int WMGetMemorySiteStatistics(WMMemorySiteStatistics *stats, int count);
+
+/* the heap usage per source file, the top allocation sites and the
+ * slabs, as text to be freed with wfree() */
+char* WMGetMemoryStatisticsDescription(int maxSites);
+
 /* ---[ WINGs/error.c ]--------------------------------------------------- */
 
 enum {
@@ -236,6 +293,22 @@ char* wfindfileinarray(WMPropList* array, const char *file);
 
 char* wexpandpath(const char *path);
 
+/*
+ * The searches in path lists done by the functions above are answered
+ * from cached directory listings. These count how well that works.
+ */
+typedef struct WMFindFileStatistics {
+	unsigned long lookups;		/* files searched for in path lists */
+	unsigned long found;
+	unsigned long cached;		/* directories searched in their listing */
+	unsigned long uncached;		/* directories searched with access() */
+	unsigned long directoryReads;	/* listings read from the file system */
+	unsigned long events;		/* changes notified by inotify */
+	unsigned int directories;	/* listings held */
+} WMFindFileStatistics;
+
+void WMGetFindFileStatistics(WMFindFileStatistics *stats);
+
 int wcopy_file(const char *toPath, const char *srcFile, const char *destFile);
 
 /* don't free the returned string */
@@ -269,6 +342,16 @@ char* wstrappend(char *dst, const char *src);
 size_t wstrlcpy(char *, const char *, size_t);
 size_t wstrlcat(char *, const char *, size_t);
 
+/* Returns the shared copy of a string, so interned strings can be
+ * compared with ==. Every intern or retain must be balanced with a
+ * release. NULL is returned as is. */
+const char* WMInternString(const char *str);
+
+/* str must have been returned by WMInternString() */
+const char* WMRetainInternedString(const char *str);
+
+void WMReleaseInternedString(const char *str);
+
 
 void wtokensplit(char *command, char ***argv, int *argc);
 
@@ -719,6 +802,10 @@ const char* WMGetNotificationName(WMNotification *notification);
 void WMAddNotificationObserver(WMNotificationObserverAction *observerAction,
                                void *observer, const char *name, void *object);
 
+void WMAddNotificationObserverWithStyle(WMNotificationObserverAction *observerAction,
+                                        void *observer, const char *name, void *object,
+                                        WMPostingStyle postingStyle, unsigned coalesceMask);
+
 void WMPostNotification(WMNotification *notification);
 
 void WMRemoveNotificationObserver(void *observer);
@@ -728,6 +815,10 @@ void WMRemoveNotificationObserverWithName(void *observer, const char *name,
 
 void WMPostNotificationName(const char *name, void *object, void *clientData);
 
+void WMCancelDeferredNotifications(void *object);
+
+unsigned long WMGetCoalescedNotificationCount(void);
+
 WMNotificationQueue* WMGetDefaultNotificationQueue(void);
 
 WMNotificationQueue* WMCreateNotificationQueue(void);
@@ -836,9 +927,19 @@ WMPropList* WMGetPLDictionaryKeys(WMPropList *plist);
  * retained from the original */
 WMPropList* WMShallowCopyPropList(WMPropList *plist);
 
-/* Makes a completely separate replica of the original proplist */
+/* Makes a completely separate replica of the original proplist.
+ * Immutable parts of it are shared instead of copied */
 WMPropList* WMDeepCopyPropList(WMPropList *plist);
 
+/* Returns the immutable instance with the same contents as plist. All
+ * immutable property lists with the same contents are the same object,
+ * so they take memory only once and comparing them is cheap. Release it
+ * when you're done. Trying to change it is an error; WMShallowCopyPropList()
+ * gives a mutable copy of its first level */
+WMPropList* WMCreateImmutablePropList(WMPropList *plist);
+
+Bool WMIsPropListImmutable(WMPropList *plist);
+
 WMPropList* WMCreatePropListFromDescription(const char *desc);
 
 /* Free the returned string when you no longer need it */
@@ -850,6 +951,16 @@ WMPropList* WMReadPropListFromPipe(const char *command);
 
 Bool WMWritePropListToFile(WMPropList *plist, const char *path);
 
+/* Does not touch the file if it already has the same contents */
+Bool WMWritePropListToFileIfChanged(WMPropList *plist, const char *path);
+
+/* Binary copy of a property list that is only valid while the (NULL
+ * terminated) list of text files it was built from stays unchanged */
+WMPropList* WMReadPropListFromCompiledFile(const char *path, const char **sources);
+
+Bool WMWritePropListToCompiledFile(WMPropList *plist, const char *path,
+                                   const char **sources);
+
 /* ---[ WINGs/userdefaults.c ]-------------------------------------------- */
 
 /* don't free the returned string */
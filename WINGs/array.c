@@ -23,6 +23,16 @@ typedef struct W_Array {
 	WMFreeDataProc *destructor;	/* the destructor to free elements */
 } W_Array;
 
+static WMSlab *arraySlab = NULL;
+
+static WMArray *allocArray(void)
+{
+	if (!arraySlab)
+		arraySlab = WMCreateSlab("WMArray", sizeof(WMArray));
+
+	return WMSlabAlloc(arraySlab);
+}
+
 WMArray *WMCreateArray(int initialSize)
 {
 	return WMCreateArrayWithDestructor(initialSize, NULL);
@@ -32,7 +42,7 @@ WMArray *WMCreateArrayWithDestructor(int initialSize, WMFreeDataProc * destructo
 {
 	WMArray *array;
 
-	array = wmalloc(sizeof(WMArray));
+	array = allocArray();
 
 	if (initialSize <= 0) {
 		initialSize = INITIAL_SIZE;
@@ -51,7 +61,7 @@ WMArray *WMCreateArrayWithArray(WMArray * array)
 {
 	WMArray *newArray;
 
-	newArray = wmalloc(sizeof(WMArray));
+	newArray = allocArray();
 
 	newArray->items = wmalloc(sizeof(void *) * array->allocSize);
 	memcpy(newArray->items, array->items, sizeof(void *) * array->itemCount);
@@ -82,7 +92,7 @@ void WMFreeArray(WMArray * array)
 
 	WMEmptyArray(array);
 	wfree(array->items);
-	wfree(array);
+	WMSlabFree(arraySlab, array);
 }
 
 int WMGetArrayItemCount(WMArray * array)
@@ -4,6 +4,14 @@
 
 #include "WUtil.h"
 
+/*
+ * The bag is a red-black tree ordered by index. Indexes need not be
+ * contiguous (WMSetInBag() can use any index), and inserting or deleting
+ * an element shifts the indexes of all the elements after it. To make
+ * that shift cheap, each node stores its index relative to its parent
+ * (the root stores its real index), so adding to all the indexes past
+ * some point only changes the nodes on one path from the root.
+ */
 typedef struct W_Node {
 	struct W_Node *parent;
 	struct W_Node *left;
@@ -11,7 +19,11 @@ typedef struct W_Node {
 	int color;
 
 	void *data;
-	int index;
+	int offset;		/* index - index of parent */
+
+	/* other nodes with the same data, when the item table is in use */
+	struct W_Node *nextSame;
+	struct W_Node *prevSame;
 } W_Node;
 
 typedef struct W_Bag {
@@ -21,20 +33,36 @@ typedef struct W_Bag {
 
 	int count;
 
+	/* data -> list of nodes holding it, built on the first search by item */
+	WMHashTable *items;
+
 	void (*destructor) (void *item);
 } W_Bag;
 
+static WMSlab *nodeSlab = NULL;
+
 #define IS_LEFT(node) (node == node->parent->left)
 #define IS_RIGHT(node) (node == node->parent->right)
 
 static void leftRotate(W_Bag * tree, W_Node * node)
 {
 	W_Node *node2;
+	int offset;
 
 	node2 = node->right;
+	offset = node2->offset;
+
+	/* node2 takes the place of node, indexes stay the same */
+	node2->offset += node->offset;
+	node->offset = -offset;
+	if (node2->left != tree->nil)
+		node2->left->offset += offset;
+
 	node->right = node2->left;
 
-	node2->left->parent = node;
+	/* keep the parent of the sentinel, rbDeleteFixup() may use it */
+	if (node2->left != tree->nil)
+		node2->left->parent = node;
 
 	node2->parent = node->parent;
 
@@ -54,11 +82,20 @@ static void leftRotate(W_Bag * tree, W_Node * node)
 static void rightRotate(W_Bag * tree, W_Node * node)
 {
 	W_Node *node2;
+	int offset;
 
 	node2 = node->left;
+	offset = node2->offset;
+
+	node2->offset += node->offset;
+	node->offset = -offset;
+	if (node2->right != tree->nil)
+		node2->right->offset += offset;
+
 	node->left = node2->right;
 
-	node2->right->parent = node;
+	if (node2->right != tree->nil)
+		node2->right->parent = node;
 
 	node2->parent = node->parent;
 
@@ -75,32 +112,36 @@ static void rightRotate(W_Bag * tree, W_Node * node)
 	node->parent = node2;
 }
 
-static void treeInsert(W_Bag * tree, W_Node * node)
+static void treeInsert(W_Bag * tree, W_Node * node, int index)
 {
 	W_Node *y = tree->nil;
 	W_Node *x = tree->root;
+	int yindex = 0, xindex = 0;
 
 	while (x != tree->nil) {
 		y = x;
-		if (node->index <= x->index)
+		xindex += x->offset;
+		yindex = xindex;
+		if (index <= xindex)
 			x = x->left;
 		else
 			x = x->right;
 	}
 	node->parent = y;
+	node->offset = index - yindex;
 	if (y == tree->nil)
 		tree->root = node;
-	else if (node->index <= y->index)
+	else if (index <= yindex)
 		y->left = node;
 	else
 		y->right = node;
 }
 
-static void rbTreeInsert(W_Bag * tree, W_Node * node)
+static void rbTreeInsert(W_Bag * tree, W_Node * node, int index)
 {
 	W_Node *y;
 
-	treeInsert(tree, node);
+	treeInsert(tree, node, index);
 
 	node->color = 'R';
 
@@ -251,56 +292,115 @@ static W_Node *treePredecessor(W_Node * node, W_Node * nil)
 	return y;
 }
 
-static W_Node *rbTreeDelete(W_Bag * tree, W_Node * node)
+static void transplant(W_Bag * tree, W_Node * node, W_Node * node2)
+{
+	if (node->parent == tree->nil)
+		tree->root = node2;
+	else if (IS_LEFT(node))
+		node->parent->left = node2;
+	else
+		node->parent->right = node2;
+	node2->parent = node->parent;
+}
+
+/* unlinks node from the tree, the other nodes keep their indexes */
+static void rbTreeDelete(W_Bag * tree, W_Node * node)
 {
 	W_Node *nil = tree->nil;
 	W_Node *x, *y;
-
-	if (node->left == nil || node->right == nil) {
-		y = node;
-	} else {
-		y = treeSuccessor(node, nil);
-	}
-
-	if (y->left != nil) {
-		x = y->left;
+	int color, distance;
+
+	color = node->color;
+
+	if (node->left == nil) {
+		x = node->right;
+		if (x != nil)
+			x->offset += node->offset;
+		transplant(tree, node, x);
+	} else if (node->right == nil) {
+		x = node->left;
+		x->offset += node->offset;
+		transplant(tree, node, x);
 	} else {
+		/* y, the successor of node, takes its place */
+		y = node->right;
+		distance = y->offset;
+		while (y->left != nil) {
+			y = y->left;
+			distance += y->offset;
+		}
+		color = y->color;
 		x = y->right;
-	}
 
-	x->parent = y->parent;
-
-	if (y->parent == nil) {
-		tree->root = x;
-	} else {
-		if (IS_LEFT(y)) {
-			y->parent->left = x;
+		if (y->parent == node) {
+			x->parent = y;
 		} else {
-			y->parent->right = x;
+			if (x != nil)
+				x->offset += y->offset;
+			transplant(tree, y, x);
+			y->right = node->right;
+			y->right->parent = y;
+			y->right->offset -= distance;
 		}
+		transplant(tree, node, y);
+		y->offset = node->offset + distance;
+		y->left = node->left;
+		y->left->parent = y;
+		y->left->offset -= distance;
+		y->color = node->color;
 	}
-	if (y != node) {
-		node->index = y->index;
-		node->data = y->data;
-	}
-	if (y->color == 'B') {
+
+	if (color == 'B')
 		rbDeleteFixup(tree, x);
+}
+
+/* adds delta to the index of all the nodes with an index >= index */
+static void shiftIndexes(W_Bag * tree, int index, int delta)
+{
+	W_Node *node = tree->root;
+	int nindex = 0;
+
+	while (node != tree->nil) {
+		nindex += node->offset;
+		if (nindex >= index) {
+			/* the whole subtree moves, except what is on the left */
+			node->offset += delta;
+			nindex += delta;
+			if (node->left != tree->nil)
+				node->left->offset -= delta;
+			node = node->left;
+		} else {
+			node = node->right;
+		}
 	}
+}
 
-	return y;
+static int nodeIndex(W_Bag * tree, W_Node * node)
+{
+	int index = 0;
+
+	for (; node != tree->nil; node = node->parent)
+		index += node->offset;
+
+	return index;
 }
 
-static W_Node *treeSearch(W_Node * root, W_Node * nil, int index)
+static W_Node *treeSearch(W_Bag * tree, int index)
 {
-	if (root == nil || root->index == index) {
-		return root;
-	}
+	W_Node *node = tree->root;
+	int nindex = 0;
 
-	if (index < root->index) {
-		return treeSearch(root->left, nil, index);
-	} else {
-		return treeSearch(root->right, nil, index);
+	while (node != tree->nil) {
+		nindex += node->offset;
+		if (index == nindex)
+			return node;
+		if (index < nindex)
+			node = node->left;
+		else
+			node = node->right;
 	}
+
+	return node;
 }
 
 static W_Node *treeFind(W_Node * root, W_Node * nil, void *data)
@@ -319,32 +419,145 @@ static W_Node *treeFind(W_Node * root, W_Node * nil, void *data)
 	return tmp;
 }
 
+static void linkItem(W_Bag * tree, W_Node * node)
+{
+	W_Node *head;
+
+	if (!tree->items)
+		return;
+
+	head = WMHashGet(tree->items, node->data);
+	node->prevSame = NULL;
+	node->nextSame = head;
+	if (head)
+		head->prevSame = node;
+	WMHashInsert(tree->items, node->data, node);
+}
+
+static void unlinkItem(W_Bag * tree, W_Node * node)
+{
+	if (!tree->items)
+		return;
+
+	if (node->nextSame)
+		node->nextSame->prevSame = node->prevSame;
+	if (node->prevSame)
+		node->prevSame->nextSame = node->nextSame;
+	else if (node->nextSame)
+		WMHashInsert(tree->items, node->data, node->nextSame);
+	else
+		WMHashRemove(tree->items, node->data);
+}
+
+static void linkTreeItems(W_Bag * tree, W_Node * node)
+{
+	if (node == tree->nil)
+		return;
+
+	linkTreeItems(tree, node->right);
+	linkItem(tree, node);
+	linkTreeItems(tree, node->left);
+}
+
+/* the list of nodes holding item, or NULL */
+static W_Node *itemNodes(W_Bag * tree, void *item)
+{
+	if (!tree->items) {
+		tree->items = WMCreateHashTable(WMIntHashCallbacks);
+		linkTreeItems(tree, tree->root);
+	}
+
+	return WMHashGet(tree->items, item);
+}
+
+/* the node with the lowest index holding item */
+static W_Node *findItem(W_Bag * tree, void *item)
+{
+	W_Node *node, *best;
+	int index, bestIndex;
+
+	/* NULL can't be a key in the table */
+	if (item == NULL)
+		return treeFind(tree->root, tree->nil, item);
+
+	best = itemNodes(tree, item);
+	if (!best)
+		return tree->nil;
+
+	if (best->nextSame) {
+		bestIndex = nodeIndex(tree, best);
+		for (node = best->nextSame; node; node = node->nextSame) {
+			index = nodeIndex(tree, node);
+			if (index < bestIndex) {
+				best = node;
+				bestIndex = index;
+			}
+		}
+	}
+
+	return best;
+}
+
+static W_Node *createNode(W_Bag * tree, void *item, int index)
+{
+	W_Node *node;
+
+	if (!nodeSlab)
+		nodeSlab = WMCreateSlab("W_Node", sizeof(W_Node));
+	node = WMSlabAlloc(nodeSlab);
+
+	node->data = item;
+	node->left = tree->nil;
+	node->right = tree->nil;
+	node->parent = tree->nil;
+
+	rbTreeInsert(tree, node, index);
+	if (item)
+		linkItem(tree, node);
+
+	tree->count++;
+
+	return node;
+}
+
+static void destroyNode(W_Bag * tree, W_Node * node)
+{
+	tree->count--;
+
+	if (node->data)
+		unlinkItem(tree, node);
+	rbTreeDelete(tree, node);
+	if (tree->destructor)
+		tree->destructor(node->data);
+	WMSlabFree(nodeSlab, node);
+}
+
 #if 0
 static char buf[512];
 
-static void printNodes(W_Node * node, W_Node * nil, int depth)
+static void printNodes(W_Node * node, W_Node * nil, int index, int depth)
 {
 	if (node == nil) {
 		return;
 	}
 
-	printNodes(node->left, nil, depth + 1);
+	index += node->offset;
+
+	printNodes(node->left, nil, index, depth + 1);
 
 	memset(buf, ' ', depth * 2);
 	buf[depth * 2] = 0;
 	if (IS_LEFT(node))
-		printf("%s/(%2i\n", buf, node->index);
+		printf("%s/(%2i\n", buf, index);
 	else
-		printf("%s\\(%2i\n", buf, node->index);
+		printf("%s\\(%2i\n", buf, index);
 
-	printNodes(node->right, nil, depth + 1);
+	printNodes(node->right, nil, index, depth + 1);
 }
 
 void PrintTree(WMBag * bag)
 {
-	W_TreeBag *tree = (W_TreeBag *) bag->data;
-
-	printNodes(tree->root, tree->nil, 0);
+	printNodes(bag->root, bag->nil, 0, 0);
 }
 #endif
 
@@ -360,7 +573,7 @@ WMBag *WMCreateTreeBagWithDestructor(WMFreeDataProc * destructor)
 	bag = wmalloc(sizeof(WMBag));
 	bag->nil = wmalloc(sizeof(W_Node));
 	bag->nil->left = bag->nil->right = bag->nil->parent = bag->nil;
-	bag->nil->index = WBNotFound;
+	bag->nil->color = 'B';
 	bag->root = bag->nil;
 	bag->destructor = destructor;
 
@@ -384,59 +597,22 @@ void WMAppendBag(WMBag * self, WMBag * bag)
 
 void WMPutInBag(WMBag * self, void *item)
 {
-	W_Node *ptr;
-
-	ptr = wmalloc(sizeof(W_Node));
-
-	ptr->data = item;
-	ptr->index = self->count;
-	ptr->left = self->nil;
-	ptr->right = self->nil;
-	ptr->parent = self->nil;
-
-	rbTreeInsert(self, ptr);
-
-	self->count++;
+	createNode(self, item, self->count);
 }
 
 void WMInsertInBag(WMBag * self, int index, void *item)
 {
-	W_Node *ptr;
-
-	ptr = wmalloc(sizeof(W_Node));
-
-	ptr->data = item;
-	ptr->index = index;
-	ptr->left = self->nil;
-	ptr->right = self->nil;
-	ptr->parent = self->nil;
-
-	rbTreeInsert(self, ptr);
-
-	while ((ptr = treeSuccessor(ptr, self->nil)) != self->nil) {
-		ptr->index++;
-	}
-
-	self->count++;
+	shiftIndexes(self, index, 1);
+	createNode(self, item, index);
 }
 
 static int treeDeleteNode(WMBag * self, W_Node *ptr)
 {
 	if (ptr != self->nil) {
-		W_Node *tmp;
+		int index = nodeIndex(self, ptr);
 
-		self->count--;
-
-		tmp = treeSuccessor(ptr, self->nil);
-		while (tmp != self->nil) {
-			tmp->index--;
-			tmp = treeSuccessor(tmp, self->nil);
-		}
-
-		ptr = rbTreeDelete(self, ptr);
-		if (self->destructor)
-			self->destructor(ptr->data);
-		wfree(ptr);
+		destroyNode(self, ptr);
+		shiftIndexes(self, index + 1, -1);
 		return 1;
 	}
 	return 0;
@@ -444,25 +620,16 @@ static int treeDeleteNode(WMBag * self, W_Node *ptr)
 
 int WMRemoveFromBag(WMBag * self, void *item)
 {
-	W_Node *ptr = treeFind(self->root, self->nil, item);
+	W_Node *ptr = findItem(self, item);
 	return treeDeleteNode(self, ptr);
 }
 
 int WMEraseFromBag(WMBag * self, int index)
 {
-	W_Node *ptr = treeSearch(self->root, self->nil, index);
+	W_Node *ptr = treeSearch(self, index);
 
 	if (ptr != self->nil) {
-
-		self->count--;
-
-		ptr = rbTreeDelete(self, ptr);
-		if (self->destructor)
-			self->destructor(ptr->data);
-		wfree(ptr);
-
-		wassertrv(self->count == 0 || self->root->index >= 0, 1);
-
+		destroyNode(self, ptr);
 		return 1;
 	} else {
 		return 0;
@@ -471,7 +638,7 @@ int WMEraseFromBag(WMBag * self, int index)
 
 int WMDeleteFromBag(WMBag * self, int index)
 {
-	W_Node *ptr = treeSearch(self->root, self->nil, index);
+	W_Node *ptr = treeSearch(self, index);
 	return treeDeleteNode(self, ptr);
 }
 
@@ -479,7 +646,7 @@ void *WMGetFromBag(WMBag * self, int index)
 {
 	W_Node *node;
 
-	node = treeSearch(self->root, self->nil, index);
+	node = treeSearch(self, index);
 	if (node != self->nil)
 		return node->data;
 	else
@@ -490,9 +657,9 @@ int WMGetFirstInBag(WMBag * self, void *item)
 {
 	W_Node *node;
 
-	node = treeFind(self->root, self->nil, item);
+	node = findItem(self, item);
 	if (node != self->nil)
-		return node->index;
+		return nodeIndex(self, node);
 	else
 		return WBNotFound;
 }
@@ -518,40 +685,51 @@ static int treeCount(W_Node * root, W_Node * nil, void *item)
 
 int WMCountInBag(WMBag * self, void *item)
 {
-	return treeCount(self->root, self->nil, item);
+	W_Node *node;
+	int count = 0;
+
+	if (item == NULL)
+		return treeCount(self->root, self->nil, item);
+
+	for (node = itemNodes(self, item); node; node = node->nextSame)
+		count++;
+
+	return count;
 }
 
 void *WMReplaceInBag(WMBag * self, int index, void *item)
 {
-	W_Node *ptr = treeSearch(self->root, self->nil, index);
+	W_Node *ptr = treeSearch(self, index);
 	void *old = NULL;
 
 	if (item == NULL) {
-		self->count--;
-		ptr = rbTreeDelete(self, ptr);
-		if (self->destructor)
-			self->destructor(ptr->data);
-		wfree(ptr);
+		if (ptr != self->nil)
+			destroyNode(self, ptr);
 	} else if (ptr != self->nil) {
 		old = ptr->data;
+		if (old)
+			unlinkItem(self, ptr);
 		ptr->data = item;
+		linkItem(self, ptr);
 	} else {
-		W_Node *ptr;
-
-		ptr = wmalloc(sizeof(W_Node));
+		createNode(self, item, index);
+	}
 
-		ptr->data = item;
-		ptr->index = index;
-		ptr->left = self->nil;
-		ptr->right = self->nil;
-		ptr->parent = self->nil;
+	return old;
+}
 
-		rbTreeInsert(self, ptr);
+/* turns the indexes stored in the offsets into offsets */
+static void makeOffsets(W_Bag * tree, W_Node * node, int parentIndex)
+{
+	int index;
 
-		self->count++;
-	}
+	if (node == tree->nil)
+		return;
 
-	return old;
+	index = node->offset;
+	node->offset = index - parentIndex;
+	makeOffsets(tree, node->left, index);
+	makeOffsets(tree, node->right, index);
 }
 
 void WMSortBag(WMBag * self, WMCompareDataProc * comparer)
@@ -577,10 +755,17 @@ void WMSortBag(WMBag * self, WMCompareDataProc * comparer)
 	i = 0;
 	tmp = treeMinimum(self->root, self->nil);
 	while (tmp != self->nil) {
-		tmp->index = i;
+		tmp->offset = i;
 		tmp->data = items[i++];
 		tmp = treeSuccessor(tmp, self->nil);
 	}
+	makeOffsets(self, self->root, 0);
+
+	/* rebuilt on the next search by item */
+	if (self->items) {
+		WMFreeHashTable(self->items);
+		self->items = NULL;
+	}
 
 	wfree(items);
 }
@@ -597,7 +782,7 @@ static void deleteTree(WMBag * self, W_Node * node)
 
 	deleteTree(self, node->right);
 
-	wfree(node);
+	WMSlabFree(nodeSlab, node);
 }
 
 void WMEmptyBag(WMBag * self)
@@ -605,6 +790,10 @@ void WMEmptyBag(WMBag * self)
 	deleteTree(self, self->root);
 	self->root = self->nil;
 	self->count = 0;
+	if (self->items) {
+		WMFreeHashTable(self->items);
+		self->items = NULL;
+	}
 }
 
 void WMFreeBag(WMBag * self)
@@ -631,27 +820,29 @@ void WMMapBag(WMBag * self, void (*function) (void *, void *), void *data)
 	mapTree(self, self->root, function, data);
 }
 
-static int findInTree(W_Bag * tree, W_Node * node, WMMatchDataProc * function, void *cdata)
+static int findInTree(W_Bag * tree, W_Node * node, int index, WMMatchDataProc * function, void *cdata)
 {
-	int index;
+	int found;
 
 	if (node == tree->nil)
 		return WBNotFound;
 
-	index = findInTree(tree, node->left, function, cdata);
-	if (index != WBNotFound)
-		return index;
+	index += node->offset;
+
+	found = findInTree(tree, node->left, index, function, cdata);
+	if (found != WBNotFound)
+		return found;
 
 	if ((*function) (node->data, cdata)) {
-		return node->index;
+		return index;
 	}
 
-	return findInTree(tree, node->right, function, cdata);
+	return findInTree(tree, node->right, index, function, cdata);
 }
 
 int WMFindInBag(WMBag * self, WMMatchDataProc * match, void *cdata)
 {
-	return findInTree(self, self->root, match, cdata);
+	return findInTree(self, self->root, 0, match, cdata);
 }
 
 void *WMBagFirst(WMBag * self, WMBagIterator * ptr)
@@ -725,7 +916,7 @@ void *WMBagIteratorAtIndex(WMBag * self, int index, WMBagIterator * ptr)
 {
 	W_Node *node;
 
-	node = treeSearch(self->root, self->nil, index);
+	node = treeSearch(self, index);
 
 	if (node == self->nil) {
 		*ptr = NULL;
@@ -738,8 +929,5 @@ void *WMBagIteratorAtIndex(WMBag * self, int index, WMBagIterator * ptr)
 
 int WMBagIndexForIterator(WMBag * bag, WMBagIterator ptr)
 {
-	/* Parameter not used, but tell the compiler that it is ok */
-	(void) bag;
-
-	return ((W_Node *) ptr)->index;
+	return nodeIndex(bag, (W_Node *) ptr);
 }
@@ -33,6 +33,12 @@
 #include <string.h>
 #include <pwd.h>
 #include <limits.h>
+#include <dirent.h>
+#include <stdint.h>
+#include <time.h>
+#ifdef HAVE_INOTIFY
+#include <sys/inotify.h>
+#endif
 
 #ifndef PATH_MAX
 #define PATH_MAX  1024
@@ -232,6 +238,287 @@ static const char *nextchar(const char *string, char tok)
 	return string;
 }
 
+/*
+ * Directory listings used to search files in path lists. A file is looked
+ * up in the listing of each directory before calling access() on its full
+ * path, so that misses cost no system call. A name in the listing may
+ * still be a dangling symbolic link, so hits are checked with access().
+ * Listings are kept up to date with inotify where it is available, and
+ * revalidated with stat() at most once per second otherwise.
+ *
+ * Setting WINGS_NO_FILE_CACHE in the environment disables the cache.
+ */
+typedef struct DirListing {
+	char *path;			/* expanded, without a trailing / */
+	WMHashTable *names;		/* NULL if the directory could not be read */
+	Bool exists;
+	Bool stale;
+	int watch;			/* inotify watch, or -1 */
+	time_t mtime;
+	time_t listed;
+	time_t checked;
+} DirListing;
+
+static WMHashTable *listingsByDir = NULL;	/* as written in the path lists */
+static WMHashTable *listingsByPath = NULL;	/* expanded */
+static int cacheEnabled = -1;
+
+static WMFindFileStatistics findStats;
+
+#ifdef HAVE_INOTIFY
+static WMHashTable *listingsByWatch = NULL;
+static int inotifyFd = -1;
+static Bool inotifyTried = False;
+
+static void watchListing(DirListing *dl)
+{
+	if (!inotifyTried) {
+		inotifyTried = True;
+		inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (inotifyFd >= 0)
+			listingsByWatch = WMCreateHashTable(WMIntHashCallbacks);
+	}
+	if (inotifyFd < 0)
+		return;
+
+	dl->watch = inotify_add_watch(inotifyFd, dl->path,
+				      IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+				      | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+	if (dl->watch < 0)
+		return;
+
+	/* the same directory through another path, poll that one instead */
+	if (WMHashGet(listingsByWatch, (void *)(intptr_t) dl->watch)) {
+		dl->watch = -1;
+		return;
+	}
+	WMHashInsert(listingsByWatch, (void *)(intptr_t) dl->watch, dl);
+}
+
+static void forgetWatch(DirListing *dl, Bool remove)
+{
+	WMHashRemove(listingsByWatch, (void *)(intptr_t) dl->watch);
+	if (remove)
+		inotify_rm_watch(inotifyFd, dl->watch);
+	dl->watch = -1;
+	dl->stale = True;
+}
+
+static void processEvents(void)
+{
+	char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *event;
+	WMHashEnumerator e;
+	DirListing *dl;
+	ssize_t length, i;
+
+	if (inotifyFd < 0)
+		return;
+
+	while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+		for (i = 0; i < length; i += sizeof(struct inotify_event) + event->len) {
+			event = (const struct inotify_event *)&buffer[i];
+			findStats.events++;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				e = WMEnumerateHashTable(listingsByPath);
+				while ((dl = WMNextHashEnumeratorItem(&e)) != NULL)
+					dl->stale = True;
+				continue;
+			}
+
+			dl = WMHashGet(listingsByWatch, (void *)(intptr_t) event->wd);
+			if (!dl)
+				continue;
+
+			if (event->mask & (IN_IGNORED | IN_DELETE_SELF)) {
+				forgetWatch(dl, False);
+			} else if (event->mask & IN_MOVE_SELF) {
+				forgetWatch(dl, True);
+			} else if (dl->names && event->len > 0) {
+				if (event->mask & (IN_CREATE | IN_MOVED_TO))
+					WMHashInsert(dl->names, event->name, dl);
+				else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+					WMHashRemove(dl->names, event->name);
+			}
+		}
+	}
+}
+#endif
+
+static void readListing(DirListing *dl)
+{
+	struct stat st;
+	struct dirent *entry;
+	DIR *dir;
+
+	findStats.directoryReads++;
+
+	if (dl->names) {
+		WMFreeHashTable(dl->names);
+		dl->names = NULL;
+	}
+	dl->stale = False;
+	dl->checked = dl->listed = time(NULL);
+
+	if (stat(dl->path, &st) < 0 || !S_ISDIR(st.st_mode)) {
+		dl->exists = False;
+		dl->mtime = 0;
+		return;
+	}
+	dl->exists = True;
+	dl->mtime = st.st_mtime;
+
+#ifdef HAVE_INOTIFY
+	/* watch before reading, so no change can be missed */
+	if (dl->watch < 0)
+		watchListing(dl);
+#endif
+
+	dir = opendir(dl->path);
+	if (!dir)
+		return;
+
+	dl->names = WMCreateHashTable(WMStringHashCallbacks);
+	while ((entry = readdir(dir)) != NULL)
+		WMHashInsert(dl->names, entry->d_name, dl);
+	closedir(dir);
+}
+
+static Bool isListingCurrent(DirListing *dl)
+{
+	struct stat st;
+	time_t now;
+
+	if (dl->stale)
+		return False;
+	if (dl->watch >= 0)
+		return True;
+
+	now = time(NULL);
+	if (now == dl->checked)
+		return True;
+	dl->checked = now;
+
+	if (stat(dl->path, &st) < 0 || !S_ISDIR(st.st_mode))
+		return !dl->exists;
+
+	/* a change in the second the listing was read may not show in mtime */
+	return dl->exists && st.st_mtime == dl->mtime && dl->mtime < dl->listed;
+}
+
+static DirListing *getListing(const char *dir)
+{
+	DirListing *dl;
+	char *path;
+	size_t len;
+
+	if (!listingsByDir) {
+		listingsByDir = WMCreateHashTable(WMStringHashCallbacks);
+		listingsByPath = WMCreateHashTable(WMStringPointerHashCallbacks);
+	}
+
+	dl = WMHashGet(listingsByDir, dir);
+	if (!dl) {
+		path = wexpandpath(dir);
+		if (!path)
+			return NULL;
+		len = strlen(path);
+		while (len > 1 && path[len - 1] == '/')
+			path[--len] = 0;
+
+		dl = WMHashGet(listingsByPath, path);
+		if (dl) {
+			wfree(path);
+		} else {
+			dl = wmalloc(sizeof(DirListing));
+			dl->path = path;
+			dl->watch = -1;
+			dl->stale = True;
+			WMHashInsert(listingsByPath, dl->path, dl);
+		}
+		WMHashInsert(listingsByDir, dir, dl);
+	}
+
+	if (!isListingCurrent(dl))
+		readListing(dl);
+
+	return dl;
+}
+
+static void beginSearch(void)
+{
+	if (cacheEnabled < 0)
+		cacheEnabled = getenv("WINGS_NO_FILE_CACHE") == NULL;
+
+	findStats.lookups++;
+#ifdef HAVE_INOTIFY
+	if (cacheEnabled)
+		processEvents();
+#endif
+}
+
+static char *endSearch(char *fullpath)
+{
+	if (fullpath)
+		findStats.found++;
+
+	return fullpath;
+}
+
+/* Returns the full path of file in the directory dir, if it exists */
+static char *findInDirectory(const char *dir, const char *file)
+{
+	DirListing *dl;
+	char *path, *fullpath;
+	size_t len;
+
+	len = strlen(dir);
+	if (len == 0)
+		return NULL;
+
+	/* names with a path or variables in them are not in any listing */
+	if (cacheEnabled && !strchr(file, '/') && !strchr(file, '$')) {
+		dl = getListing(dir);
+		if (dl && (dl->names || !dl->exists)) {
+			findStats.cached++;
+			if (!dl->names || !WMHashGet(dl->names, file))
+				return NULL;
+
+			len = strlen(dl->path);
+			fullpath = wmalloc(len + strlen(file) + 2);
+			sprintf(fullpath, "%s%s%s", dl->path, dl->path[len - 1] == '/' ? "" : "/", file);
+			if (access(fullpath, F_OK) == 0)
+				return fullpath;
+			wfree(fullpath);
+			return NULL;
+		}
+	}
+
+	findStats.uncached++;
+
+	path = wmalloc(len + strlen(file) + 2);
+	sprintf(path, "%s%s%s", dir, dir[len - 1] == '/' ? "" : "/", file);
+
+	/* expand tilde */
+	fullpath = wexpandpath(path);
+	wfree(path);
+	if (fullpath) {
+		/* check if file exists */
+		if (access(fullpath, F_OK) == 0)
+			return fullpath;
+		wfree(fullpath);
+	}
+
+	return NULL;
+}
+
+void WMGetFindFileStatistics(WMFindFileStatistics *stats)
+{
+	*stats = findStats;
+	stats->directories = listingsByPath ? WMCountHashTable(listingsByPath) : 0;
+}
+
 /*
  *----------------------------------------------------------------------
  * findfile--
@@ -249,9 +536,9 @@ static const char *nextchar(const char *string, char tok)
  */
 char *wfindfile(const char *paths, const char *file)
 {
-	char *path;
+	char dir[PATH_MAX];
 	const char *tmp, *tmp2;
-	int len, flen;
+	size_t len;
 	char *fullpath;
 
 	if (!file)
@@ -274,7 +561,8 @@ char *wfindfile(const char *paths, const char *file)
 		}
 	}
 
-	flen = strlen(file);
+	beginSearch();
+
 	tmp = paths;
 	while (*tmp) {
 		tmp = skipchar(tmp, ':');
@@ -282,40 +570,23 @@ char *wfindfile(const char *paths, const char *file)
 			break;
 		tmp2 = nextchar(tmp, ':');
 		len = tmp2 - tmp;
-		path = wmalloc(len + flen + 2);
-		path = memcpy(path, tmp, len);
-		path[len] = 0;
-		if (path[len - 1] != '/' &&
-		    wstrlcat(path, "/", len + flen + 2) >= len + flen + 2) {
-			wfree(path);
-			return NULL;
-		}
+		if (len < sizeof(dir)) {
+			memcpy(dir, tmp, len);
+			dir[len] = 0;
 
-		if (wstrlcat(path, file, len + flen + 2) >= len + flen + 2) {
-			wfree(path);
-			return NULL;
-		}
-
-		fullpath = wexpandpath(path);
-		wfree(path);
-
-		if (fullpath) {
-			if (access(fullpath, F_OK) == 0) {
-				return fullpath;
-			}
-			wfree(fullpath);
+			fullpath = findInDirectory(dir, file);
+			if (fullpath)
+				return endSearch(fullpath);
 		}
 		tmp = tmp2;
 	}
 
-	return NULL;
+	return endSearch(NULL);
 }
 
 char *wfindfileinlist(char *const *path_list, const char *file)
 {
 	int i;
-	char *path;
-	int len, flen;
 	char *fullpath;
 
 	if (!file)
@@ -338,37 +609,20 @@ char *wfindfileinlist(char *const *path_list, const char *file)
 		}
 	}
 
-	flen = strlen(file);
+	beginSearch();
+
 	for (i = 0; path_list[i] != NULL; i++) {
-		len = strlen(path_list[i]);
-		path = wmalloc(len + flen + 2);
-		path = memcpy(path, path_list[i], len);
-		path[len] = 0;
-		if (wstrlcat(path, "/", len + flen + 2) >= len + flen + 2 ||
-		    wstrlcat(path, file, len + flen + 2) >= len + flen + 2) {
-			wfree(path);
-			return NULL;
-		}
-		/* expand tilde */
-		fullpath = wexpandpath(path);
-		wfree(path);
-		if (fullpath) {
-			/* check if file exists */
-			if (access(fullpath, F_OK) == 0) {
-				return fullpath;
-			}
-			wfree(fullpath);
-		}
+		fullpath = findInDirectory(path_list[i], file);
+		if (fullpath)
+			return endSearch(fullpath);
 	}
 
-	return NULL;
+	return endSearch(NULL);
 }
 
 char *wfindfileinarray(WMPropList *array, const char *file)
 {
 	int i;
-	char *path;
-	int len, flen;
 	char *fullpath;
 
 	if (!file)
@@ -391,37 +645,21 @@ char *wfindfileinarray(WMPropList *array, const char *file)
 		}
 	}
 
-	flen = strlen(file);
+	beginSearch();
+
 	for (i = 0; i < WMGetPropListItemCount(array); i++) {
 		WMPropList *prop;
-		char *p;
 
 		prop = WMGetFromPLArray(array, i);
-		if (!prop)
+		if (!prop || !WMIsPLString(prop))
 			continue;
-		p = WMGetFromPLString(prop);
-
-		len = strlen(p);
-		path = wmalloc(len + flen + 2);
-		path = memcpy(path, p, len);
-		path[len] = 0;
-		if (wstrlcat(path, "/", len + flen + 2) >= len + flen + 2 ||
-		    wstrlcat(path, file, len + flen + 2) >= len + flen + 2) {
-			wfree(path);
-			return NULL;
-		}
-		/* expand tilde */
-		fullpath = wexpandpath(path);
-		wfree(path);
-		if (fullpath) {
-			/* check if file exists */
-			if (access(fullpath, F_OK) == 0) {
-				return fullpath;
-			}
-			wfree(fullpath);
-		}
+
+		fullpath = findInDirectory(WMGetFromPLString(prop), file);
+		if (fullpath)
+			return endSearch(fullpath);
 	}
-	return NULL;
+
+	return endSearch(NULL);
 }
 
 int wcopy_file(const char *dest_dir, const char *src_file, const char *dest_file)
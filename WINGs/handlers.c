@@ -44,6 +44,8 @@ typedef struct InputHandler {
 /* queue of timer event handlers */
 static TimerHandler *timerHandler = NULL;
 
+static WMSlab *timerSlab = NULL;
+
 static WMArray *idleHandler = NULL;
 
 static WMArray *inputHandler = NULL;
@@ -126,9 +128,9 @@ WMHandlerID WMAddTimerHandler(int milliseconds, WMCallback * callback, void *cda
 {
 	TimerHandler *handler;
 
-	handler = malloc(sizeof(TimerHandler));
-	if (!handler)
-		return NULL;
+	if (!timerSlab)
+		timerSlab = WMCreateSlab("TimerHandler", sizeof(TimerHandler));
+	handler = WMSlabAlloc(timerSlab);
 
 	rightNow(&handler->when);
 	addmillisecs(&handler->when, milliseconds);
@@ -163,7 +165,7 @@ void WMDeleteTimerWithClientData(void *cdata)
 		tmp->nextDelay = 0;
 		if (!IS_ZERO(tmp->when)) {
 			timerHandler = tmp->next;
-			wfree(tmp);
+			WMSlabFree(timerSlab, tmp);
 		}
 	} else {
 		while (tmp->next) {
@@ -173,7 +175,7 @@ void WMDeleteTimerWithClientData(void *cdata)
 				if (IS_ZERO(handler->when))
 					break;
 				tmp->next = handler->next;
-				wfree(handler);
+				WMSlabFree(timerSlab, handler);
 				break;
 			}
 			tmp = tmp->next;
@@ -197,12 +199,12 @@ void WMDeleteTimerHandler(WMHandlerID handlerID)
 
 	if (tmp == handler) {
 		timerHandler = handler->next;
-		wfree(handler);
+		WMSlabFree(timerSlab, handler);
 	} else {
 		while (tmp->next) {
 			if (tmp->next == handler) {
 				tmp->next = handler->next;
-				wfree(handler);
+				WMSlabFree(timerSlab, handler);
 				break;
 			}
 			tmp = tmp->next;
@@ -328,7 +330,7 @@ void W_CheckTimerHandlers(void)
 			addmillisecs(&handler->when, handler->nextDelay);
 			enqueueTimerHandler(handler);
 		} else {
-			wfree(handler);
+			WMSlabFree(timerSlab, handler);
 		}
 	}
 
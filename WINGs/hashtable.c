@@ -35,6 +35,9 @@ typedef struct W_HashTable {
 #define RELKEY(table, key) if ((table)->callbacks.releaseKey) \
     (*(table)->callbacks.releaseKey)(key)
 
+/* hash items are the most numerous objects in WINGs */
+static WMSlab *itemSlab = NULL;
+
 static inline unsigned hashString(const void *param)
 {
 	const char *key = param;
@@ -115,7 +118,7 @@ void WMResetHashTable(WMHashTable * table)
 		while (item) {
 			tmp = item->next;
 			RELKEY(table, item->key);
-			wfree(item);
+			WMSlabFree(itemSlab, item);
 			item = tmp;
 		}
 	}
@@ -141,7 +144,7 @@ void WMFreeHashTable(WMHashTable * table)
 		while (item) {
 			tmp = item->next;
 			RELKEY(table, item->key);
-			wfree(item);
+			WMSlabFree(itemSlab, item);
 			item = tmp;
 		}
 	}
@@ -244,7 +247,9 @@ void *WMHashInsert(WMHashTable * table, const void *key, const void *data)
 	} else {
 		HashItem *nitem;
 
-		nitem = wmalloc(sizeof(HashItem));
+		if (!itemSlab)
+			itemSlab = WMCreateSlab("HashItem", sizeof(HashItem));
+		nitem = WMSlabAlloc(itemSlab);
 		nitem->key = DUPKEY(table, key);
 		nitem->data = data;
 		nitem->next = table->table[h];
@@ -279,7 +284,7 @@ static HashItem *deleteFromList(HashTable * table, HashItem * item, const void *
 
 		next = item->next;
 		RELKEY(table, item->key);
-		wfree(item);
+		WMSlabFree(itemSlab, item);
 
 		table->itemCount--;
 
@@ -29,6 +29,8 @@
 #include <string.h>
 #include <assert.h>
 #include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
 
 #ifdef HAVE_STDNORETURN
 #include <stdnoreturn.h>
@@ -77,7 +79,160 @@ static int Aborting = 0;	/* if we're in the middle of an emergency exit */
 
 static WMHashTable *table = NULL;
 
-void *wmalloc(size_t size)
+/*
+ * Memory accounting: when WINGS_MEMORY_STATS is set in the environment,
+ * every block from wmalloc() and wrealloc() is recorded with the source
+ * line that asked for it, and WMGetMemoryStatisticsDescription() reports
+ * the bytes held per source file and the biggest allocation sites. The
+ * tables use malloc() directly so they do not account for themselves.
+ */
+
+typedef struct MemorySite {
+	struct MemorySite *next;
+	const char *file;
+	int line;
+
+	unsigned long live;
+	unsigned long allocated;
+	size_t bytes;
+} MemorySite;
+
+typedef struct MemoryBlock {
+	void *ptr;		/* NULL for a free slot */
+	size_t size;
+	MemorySite *site;
+} MemoryBlock;
+
+#define SITE_BUCKETS  1021
+
+static int accounting = -1;	/* -1 until the environment is checked */
+
+static MemorySite *sites[SITE_BUCKETS];
+static int siteCount = 0;
+
+static MemoryBlock *blocks = NULL;	/* open addressing, by address */
+static size_t blockMask = 0;
+static size_t blockCount = 0;
+
+static Bool accountingEnabled(void)
+{
+	if (accounting < 0)
+		accounting = (getenv("WINGS_MEMORY_STATS") != NULL);
+
+	return accounting;
+}
+
+static inline size_t blockSlot(const void *ptr)
+{
+	return (((uintptr_t) ptr >> 4) * 2654435761u) & blockMask;
+}
+
+static MemorySite *findSite(const char *file, int line)
+{
+	MemorySite *site;
+	unsigned h;
+
+	if (!file)
+		file = "?";
+	h = (((uintptr_t) file >> 3) ^ (unsigned)line * 31u) % SITE_BUCKETS;
+	for (site = sites[h]; site; site = site->next) {
+		if (site->file == file && site->line == line)
+			return site;
+	}
+
+	site = calloc(1, sizeof(MemorySite));
+	if (!site)
+		return NULL;
+	site->file = file;
+	site->line = line;
+	site->next = sites[h];
+	sites[h] = site;
+	siteCount++;
+
+	return site;
+}
+
+static Bool growBlocks(void)
+{
+	MemoryBlock *old = blocks;
+	size_t i, slot, oldSize = old ? blockMask + 1 : 0;
+	size_t newSize = oldSize ? oldSize * 2 : 4096;
+
+	blocks = calloc(newSize, sizeof(MemoryBlock));
+	if (!blocks) {
+		blocks = old;
+		return False;
+	}
+	blockMask = newSize - 1;
+
+	for (i = 0; i < oldSize; i++) {
+		if (!old[i].ptr)
+			continue;
+		for (slot = blockSlot(old[i].ptr); blocks[slot].ptr; slot = (slot + 1) & blockMask)
+			;
+		blocks[slot] = old[i];
+	}
+	free(old);
+
+	return True;
+}
+
+static void forgetBlock(void *ptr)
+{
+	size_t slot, next, home;
+	MemorySite *site;
+
+	if (!blocks)
+		return;
+
+	for (slot = blockSlot(ptr); blocks[slot].ptr != ptr; slot = (slot + 1) & blockMask) {
+		if (!blocks[slot].ptr)
+			return;	/* not from wmalloc(), or from before accounting started */
+	}
+
+	site = blocks[slot].site;
+	site->live--;
+	site->bytes -= blocks[slot].size;
+	blockCount--;
+
+	/* move back the entries that probed past the slot being emptied */
+	for (next = (slot + 1) & blockMask; blocks[next].ptr; next = (next + 1) & blockMask) {
+		home = blockSlot(blocks[next].ptr);
+		if (((next - home) & blockMask) >= ((next - slot) & blockMask)) {
+			blocks[slot] = blocks[next];
+			slot = next;
+		}
+	}
+	blocks[slot].ptr = NULL;
+}
+
+static void recordBlock(void *ptr, size_t size, const char *file, int line)
+{
+	MemorySite *site;
+	size_t slot;
+
+	/* a block freed with free() left its entry behind */
+	forgetBlock(ptr);
+
+	if ((blockCount + 1) * 2 > (blocks ? blockMask + 1 : 0) && !growBlocks())
+		return;
+	site = findSite(file, line);
+	if (!site)
+		return;
+
+	for (slot = blockSlot(ptr); blocks[slot].ptr; slot = (slot + 1) & blockMask)
+		;
+	blocks[slot].ptr = ptr;
+	blocks[slot].size = size;
+	blocks[slot].site = site;
+	blockCount++;
+
+	site->live++;
+	site->allocated++;
+	site->bytes += size;
+}
+
+void *W_Malloc(size_t size, const char *file, int line)
 {
 	void *tmp;
 
@@ -108,19 +263,23 @@ void *wmalloc(size_t size)
 		}
 	}
 	memset(tmp, 0, size);
+	if (accountingEnabled())
+		recordBlock(tmp, size, file, line);
 	return tmp;
 }
 
-void *wrealloc(void *ptr, size_t newsize)
+void *W_Realloc(void *ptr, size_t newsize, const char *file, int line)
 {
 	void *nptr;
 
 	if (!ptr) {
-		nptr = wmalloc(newsize);
+		nptr = W_Malloc(newsize, file, line);
 	} else if (newsize == 0) {
 		wfree(ptr);
 		nptr = NULL;
 	} else {
+		if (accountingEnabled())
+			forgetBlock(ptr);
 #ifdef USE_BOEHM_GC
 		nptr = GC_REALLOC(ptr, newsize);
 #else
@@ -145,6 +304,8 @@ void *wrealloc(void *ptr, size_t newsize)
 				}
 			}
 		}
+		if (accountingEnabled())
+			recordBlock(nptr, newsize, file, line);
 	}
 	return nptr;
 }
@@ -177,6 +338,9 @@ void *wretain(void *ptr)
 
 void wfree(void *ptr)
 {
+	if (ptr && accounting > 0)
+		forgetBlock(ptr);
+
 	if (ptr)
 #ifdef USE_BOEHM_GC
 		/* This should eventually be removed, once the criss-cross
@@ -220,3 +384,384 @@ void wrelease(void *ptr)
 #endif
 	}
 }
+
+/*
+ * Slabs: small fixed-size objects of one type, carved out of blocks of
+ * SLAB_BLOCK_SIZE bytes aligned to their size, so the block of an object
+ * is found by masking its address. Each block keeps its own list of free
+ * slots and the slab keeps the blocks that still have room, so objects of
+ * a type stay packed together and a block that empties can be given back.
+ *
+ * Object sizes are rounded up to a multiple of SLAB_ALIGN; objects bigger
+ * than SLAB_MAX_OBJECT, builds using the Boehm GC (which would not scan
+ * the blocks) and processes started with WINGS_NO_SLAB in the environment
+ * (for memory checkers) use wmalloc() instead, but are still counted.
+ */
+
+#define SLAB_BLOCK_SIZE  16384
+#define SLAB_ALIGN       16
+#define SLAB_MAX_OBJECT  512
+
+#define SLAB_ROUND(size) (((size) + SLAB_ALIGN - 1) & ~((size_t) SLAB_ALIGN - 1))
+
+typedef struct W_SlabBlock {
+	struct W_SlabBlock *next;
+	struct W_SlabBlock *prev;
+	WMSlab *slab;
+
+	void *free;		/* slots given back */
+	unsigned used;		/* slots in use */
+	unsigned fresh;		/* first slot never handed out */
+} W_SlabBlock;
+
+#define SLAB_HEADER_SIZE SLAB_ROUND(sizeof(W_SlabBlock))
+
+struct W_Slab {
+	struct W_Slab *next;	/* all the slabs, for the statistics */
+
+	char *name;
+	size_t objectSize;
+	unsigned perBlock;	/* 0 if the slab uses wmalloc() */
+
+	W_SlabBlock *partial;	/* blocks with free slots */
+	W_SlabBlock *spare;	/* an empty block kept for reuse */
+
+	unsigned long live;
+	unsigned long peak;
+	unsigned long allocated;
+	unsigned long blocks;
+};
+
+static WMSlab *slabList = NULL;
+
+static Bool slabsDisabled(void)
+{
+	static int disabled = -1;
+
+	if (disabled < 0) {
+#if defined(USE_BOEHM_GC) || !defined(HAVE_POSIX_MEMALIGN)
+		disabled = 1;
+#else
+		disabled = (getenv("WINGS_NO_SLAB") != NULL);
+#endif
+	}
+
+	return disabled;
+}
+
+WMSlab *WMCreateSlab(const char *name, size_t objectSize)
+{
+	WMSlab *slab;
+
+	assert(objectSize > 0);
+
+	slab = wmalloc(sizeof(WMSlab));
+	slab->name = wstrdup(name);
+	slab->objectSize = SLAB_ROUND(objectSize);
+	if (slab->objectSize <= SLAB_MAX_OBJECT && !slabsDisabled())
+		slab->perBlock = (SLAB_BLOCK_SIZE - SLAB_HEADER_SIZE) / slab->objectSize;
+
+	slab->next = slabList;
+	slabList = slab;
+
+	return slab;
+}
+
+static void linkBlock(WMSlab *slab, W_SlabBlock *block)
+{
+	block->prev = NULL;
+	block->next = slab->partial;
+	if (slab->partial)
+		slab->partial->prev = block;
+	slab->partial = block;
+}
+
+static void unlinkBlock(WMSlab *slab, W_SlabBlock *block)
+{
+	if (block->prev)
+		block->prev->next = block->next;
+	else
+		slab->partial = block->next;
+	if (block->next)
+		block->next->prev = block->prev;
+	block->next = block->prev = NULL;
+}
+
+static W_SlabBlock *createBlock(WMSlab *slab)
+{
+	W_SlabBlock *block = NULL;
+
+#ifdef HAVE_POSIX_MEMALIGN
+	if (posix_memalign((void **)&block, SLAB_BLOCK_SIZE, SLAB_BLOCK_SIZE) != 0)
+		block = NULL;
+#endif
+	if (block == NULL) {
+		if (Aborting) {
+			fputs("Really Bad Error: recursive malloc() failure.", stderr);
+			exit(-1);
+		}
+		wfatal("virtual memory exhausted");
+		Aborting = 1;
+		wAbort(False);
+	}
+
+	block->slab = slab;
+	block->free = NULL;
+	block->used = 0;
+	block->fresh = 0;
+	slab->blocks++;
+
+	return block;
+}
+
+static void countAlloc(WMSlab *slab)
+{
+	slab->allocated++;
+	if (++slab->live > slab->peak)
+		slab->peak = slab->live;
+}
+
+void *WMSlabAlloc(WMSlab *slab)
+{
+	W_SlabBlock *block;
+	void *ptr;
+
+	countAlloc(slab);
+	if (slab->perBlock == 0)
+		return wmalloc(slab->objectSize);
+
+	block = slab->partial;
+	if (!block) {
+		if (slab->spare) {
+			block = slab->spare;
+			slab->spare = NULL;
+		} else {
+			block = createBlock(slab);
+		}
+		linkBlock(slab, block);
+	}
+
+	if (block->free) {
+		ptr = block->free;
+		block->free = *(void **)ptr;
+	} else {
+		ptr = (char *)block + SLAB_HEADER_SIZE + block->fresh * slab->objectSize;
+		block->fresh++;
+	}
+	if (++block->used == slab->perBlock)
+		unlinkBlock(slab, block);
+
+	memset(ptr, 0, slab->objectSize);
+	return ptr;
+}
+
+void WMSlabFree(WMSlab *slab, void *ptr)
+{
+	W_SlabBlock *block;
+
+	if (!ptr)
+		return;
+
+	slab->live--;
+	if (slab->perBlock == 0) {
+		wfree(ptr);
+		return;
+	}
+
+	block = (W_SlabBlock *) ((uintptr_t) ptr & ~((uintptr_t) SLAB_BLOCK_SIZE - 1));
+	assert(block->slab == slab);
+
+	*(void **)ptr = block->free;
+	block->free = ptr;
+	if (block->used-- == slab->perBlock)
+		linkBlock(slab, block);
+
+	if (block->used == 0) {
+		unlinkBlock(slab, block);
+		if (slab->spare) {
+			free(block);
+			slab->blocks--;
+		} else {
+			block->free = NULL;
+			block->fresh = 0;
+			slab->spare = block;
+		}
+	}
+}
+
+int WMGetSlabStatistics(WMSlabStatistics *stats, int count)
+{
+	WMSlab *slab;
+	int i;
+
+	for (slab = slabList, i = 0; slab; slab = slab->next, i++) {
+		if (i >= count)
+			continue;
+		stats[i].name = slab->name;
+		stats[i].objectSize = slab->objectSize;
+		stats[i].live = slab->live;
+		stats[i].peak = slab->peak;
+		stats[i].allocated = slab->allocated;
+		stats[i].bytes = slab->live * slab->objectSize;
+		if (slab->perBlock)
+			stats[i].reserved = slab->blocks * SLAB_BLOCK_SIZE;
+		else
+			stats[i].reserved = stats[i].bytes;
+	}
+
+	return i;
+}
+
+void WMLogSlabStatistics(void)
+{
+	WMSlabStatistics *stats;
+	int i, count;
+
+	count = WMGetSlabStatistics(NULL, 0);
+	if (count == 0)
+		return;
+
+	stats = wmalloc(count * sizeof(WMSlabStatistics));
+	WMGetSlabStatistics(stats, count);
+	for (i = 0; i < count; i++) {
+		wmessage("%-24s %4zu bytes: %8lu live (%zu bytes, %zu reserved), %8lu peak, %10lu allocated",
+			 stats[i].name, stats[i].objectSize, stats[i].live, stats[i].bytes,
+			 stats[i].reserved, stats[i].peak, stats[i].allocated);
+	}
+	wfree(stats);
+}
+
+static int compareSites(const void *a, const void *b)
+{
+	const WMMemorySiteStatistics *sa = a, *sb = b;
+
+	if (sa->bytes != sb->bytes)
+		return sa->bytes < sb->bytes ? 1 : -1;
+	return 0;
+}
+
+int WMGetMemorySiteStatistics(WMMemorySiteStatistics *stats, int count)
+{
+	MemorySite *site;
+	int i, n = 0;
+
+	if (!accountingEnabled() || count <= 0)
+		return siteCount;
+
+	for (i = 0; i < SITE_BUCKETS; i++) {
+		for (site = sites[i]; site && n < count; site = site->next, n++) {
+			stats[n].file = site->file;
+			stats[n].line = site->line;
+			stats[n].live = site->live;
+			stats[n].allocated = site->allocated;
+			stats[n].bytes = site->bytes;
+		}
+	}
+	qsort(stats, n, sizeof(WMMemorySiteStatistics), compareSites);
+
+	return siteCount;
+}
+
+static const char *baseName(const char *file)
+{
+	const char *slash = strrchr(file, '/');
+
+	return slash ? slash + 1 : file;
+}
+
+static char *appendLine(char *text, const char *fmt, ...)
+{
+	char line[256];
+	va_list args;
+
+	va_start(args, fmt);
+	vsnprintf(line, sizeof(line), fmt, args);
+	va_end(args);
+
+	return wstrappend(text, line);
+}
+
+char *WMGetMemoryStatisticsDescription(int maxSites)
+{
+	WMMemorySiteStatistics *stats, *files;
+	WMSlabStatistics *slabs;
+	char *text = wstrdup("");
+	size_t total = 0;
+	int i, j, count, fileCount;
+
+	count = WMGetMemorySiteStatistics(NULL, 0);
+	if (!accountingEnabled()) {
+		text = appendLine(text, "heap: not accounted, start with WINGS_MEMORY_STATS set\n");
+	} else if (count > 0) {
+		/*
+		 * Take a copy first, building the text allocates memory too.
+		 * The copy itself adds up to two sites.
+		 */
+		count += 2;
+		stats = wmalloc(count * sizeof(WMMemorySiteStatistics));
+		files = wmalloc(count * sizeof(WMMemorySiteStatistics));
+		count = WMIN(WMGetMemorySiteStatistics(stats, count), count);
+
+		fileCount = 0;
+		for (i = 0; i < count; i++) {
+			total += stats[i].bytes;
+			for (j = 0; j < fileCount; j++) {
+				if (strcmp(files[j].file, baseName(stats[i].file)) == 0)
+					break;
+			}
+			if (j == fileCount) {
+				files[j].file = baseName(stats[i].file);
+				fileCount++;
+			}
+			files[j].live += stats[i].live;
+			files[j].allocated += stats[i].allocated;
+			files[j].bytes += stats[i].bytes;
+		}
+		qsort(files, fileCount, sizeof(WMMemorySiteStatistics), compareSites);
+
+		text = appendLine(text, "heap: %zu bytes in %zu blocks\n", total, blockCount);
+		for (i = 0; i < fileCount && files[i].bytes > 0; i++) {
+			text = appendLine(text, "  %-28s %10zu bytes %8lu blocks %10lu allocated\n",
+					  files[i].file, files[i].bytes, files[i].live, files[i].allocated);
+		}
+		text = appendLine(text, "top allocation sites:\n");
+		for (i = 0; i < count && i < maxSites && stats[i].bytes > 0; i++) {
+			char where[64];
+
+			snprintf(where, sizeof(where), "%s:%d", baseName(stats[i].file), stats[i].line);
+			text = appendLine(text, "  %-28s %10zu bytes %8lu blocks %10lu allocated\n",
+					  where, stats[i].bytes, stats[i].live, stats[i].allocated);
+		}
+		wfree(files);
+		wfree(stats);
+	}
+
+	count = WMGetSlabStatistics(NULL, 0);
+	if (count > 0) {
+		slabs = wmalloc(count * sizeof(WMSlabStatistics));
+		count = WMIN(WMGetSlabStatistics(slabs, count), count);
+		text = appendLine(text, "slabs:\n");
+		for (i = 0; i < count; i++) {
+			text = appendLine(text, "  %-28s %10zu bytes %8lu objects %9lu peak %10zu reserved\n",
+					  slabs[i].name, slabs[i].bytes, slabs[i].live,
+					  slabs[i].peak, slabs[i].reserved);
+		}
+		wfree(slabs);
+	}
+
+	return text;
+}
+
+/* for callers that were built before wmalloc() became a macro */
+#undef wmalloc
+#undef wrealloc
+
+void *wmalloc(size_t size)
+{
+	return W_Malloc(size, NULL, 0);
+}
+
+void *wrealloc(void *ptr, size_t newsize)
+{
+	return W_Realloc(ptr, newsize, NULL, 0);
+}
@@ -31,11 +31,15 @@ void *WMGetNotificationClientData(WMNotification * notification)
 	return notification->clientData;
 }
 
+static WMSlab *notificationSlab = NULL;
+
 WMNotification *WMCreateNotification(const char *name, void *object, void *clientData)
 {
 	Notification *nPtr;
 
-	nPtr = wmalloc(sizeof(Notification));
+	if (!notificationSlab)
+		notificationSlab = WMCreateSlab("WMNotification", sizeof(Notification));
+	nPtr = WMSlabAlloc(notificationSlab);
 	nPtr->name = name;
 	nPtr->object = object;
 	nPtr->clientData = clientData;
@@ -49,7 +53,7 @@ void WMReleaseNotification(WMNotification * notification)
 	notification->refCount--;
 
 	if (notification->refCount < 1) {
-		wfree(notification);
+		WMSlabFree(notificationSlab, notification);
 	}
 }
 
@@ -69,6 +73,9 @@ typedef struct NotificationObserver {
 	const char *name;
 	void *object;
 
+	WMPostingStyle postingStyle;	/* WMPostNow, or deferred to a queue flush */
+	unsigned coalesceMask;	/* how pending deliveries are merged */
+
 	struct NotificationObserver *prev;	/* for tables */
 	struct NotificationObserver *next;
 	struct NotificationObserver *nextAction;	/* for observerTable */
@@ -80,11 +87,25 @@ typedef struct W_NotificationCenter {
 	NotificationObserver *nilList;	/* obervers that catch everything */
 
 	WMHashTable *observerTable;	/* observer -> NotificationObserver */
+
+	WMArray *asapDeliveries;	/* PendingDelivery for WMPostASAP observers */
+	WMArray *idleDeliveries;	/* PendingDelivery for WMPostWhenIdle observers */
 } NotificationCenter;
 
+/* a notification waiting to be handed to a deferred observer */
+typedef struct PendingDelivery {
+	NotificationObserver *orec;
+	WMNotification *notification;
+} PendingDelivery;
+
 /* default (and only) center */
 static NotificationCenter *notificationCenter = NULL;
 
+static WMSlab *observerSlab = NULL;
+
+/* number of posts that were merged into an already pending one */
+static unsigned long coalescedCount = 0;
+
 void W_InitNotificationCenter(void)
 {
 	notificationCenter = wmalloc(sizeof(NotificationCenter));
@@ -92,6 +113,16 @@ void W_InitNotificationCenter(void)
 	notificationCenter->objectTable = WMCreateHashTable(WMIntHashCallbacks);
 	notificationCenter->nilList = NULL;
 	notificationCenter->observerTable = WMCreateHashTable(WMIntHashCallbacks);
+	notificationCenter->asapDeliveries = WMCreateArray(8);
+	notificationCenter->idleDeliveries = WMCreateArray(8);
+}
+
+static void freePendingDelivery(void *data)
+{
+	PendingDelivery *pending = (PendingDelivery *) data;
+
+	WMReleaseNotification(pending->notification);
+	wfree(pending);
 }
 
 void W_ReleaseNotificationCenter(void)
@@ -103,6 +134,16 @@ void W_ReleaseNotificationCenter(void)
 			WMFreeHashTable(notificationCenter->objectTable);
 		if (notificationCenter->observerTable)
 			WMFreeHashTable(notificationCenter->observerTable);
+		if (notificationCenter->asapDeliveries) {
+			while (WMGetArrayItemCount(notificationCenter->asapDeliveries))
+				freePendingDelivery(WMPopFromArray(notificationCenter->asapDeliveries));
+			WMFreeArray(notificationCenter->asapDeliveries);
+		}
+		if (notificationCenter->idleDeliveries) {
+			while (WMGetArrayItemCount(notificationCenter->idleDeliveries))
+				freePendingDelivery(WMPopFromArray(notificationCenter->idleDeliveries));
+			WMFreeArray(notificationCenter->idleDeliveries);
+		}
 
 		wfree(notificationCenter);
 		notificationCenter = NULL;
@@ -112,14 +153,39 @@ void W_ReleaseNotificationCenter(void)
 void
 WMAddNotificationObserver(WMNotificationObserverAction * observerAction,
 			  void *observer, const char *name, void *object)
+{
+	WMAddNotificationObserverWithStyle(observerAction, observer, name, object, WMPostNow, WNCNone);
+}
+
+/*
+ * Registers an observer that is not called from inside WMPostNotification
+ * but when the ASAP (postingStyle == WMPostASAP) or idle (WMPostWhenIdle)
+ * notification queues are flushed, which happens once per turn of the
+ * event loop. While a delivery is pending, further matching posts are
+ * merged into it according to coalesceMask (WNCOnName merges any post for
+ * this registration, WNCOnSender only posts from the same object) and the
+ * observer only sees the most recent one.
+ *
+ * The notification object may be gone by the time the observer runs, so
+ * deferred observers should not dereference it unless its owner calls
+ * WMCancelDeferredNotifications() before destroying it.
+ */
+void
+WMAddNotificationObserverWithStyle(WMNotificationObserverAction * observerAction,
+				   void *observer, const char *name, void *object,
+				   WMPostingStyle postingStyle, unsigned coalesceMask)
 {
 	NotificationObserver *oRec, *rec;
 
-	oRec = wmalloc(sizeof(NotificationObserver));
+	if (!observerSlab)
+		observerSlab = WMCreateSlab("NotificationObserver", sizeof(NotificationObserver));
+	oRec = WMSlabAlloc(observerSlab);
 	oRec->observerAction = observerAction;
 	oRec->observer = observer;
 	oRec->name = name;
 	oRec->object = object;
+	oRec->postingStyle = postingStyle;
+	oRec->coalesceMask = coalesceMask;
 	oRec->next = NULL;
 	oRec->prev = NULL;
 
@@ -157,6 +223,91 @@ WMAddNotificationObserver(WMNotificationObserverAction * observerAction,
 	}
 }
 
+static void deliverNotification(NotificationObserver * orec, WMNotification * notification)
+{
+	WMArray *deliveries;
+	PendingDelivery *pending;
+	WMArrayIterator iter;
+
+	if (!orec->observerAction)
+		return;
+
+	switch (orec->postingStyle) {
+	case WMPostASAP:
+		deliveries = notificationCenter->asapDeliveries;
+		break;
+	case WMPostWhenIdle:
+		deliveries = notificationCenter->idleDeliveries;
+		break;
+	default:
+		(*orec->observerAction) (orec->observer, notification);
+		return;
+	}
+
+	if (orec->coalesceMask != WNCNone) {
+		WM_ITERATE_ARRAY(deliveries, pending, iter) {
+			if (pending->orec != orec)
+				continue;
+			if ((orec->coalesceMask & WNCOnSender)
+			    && pending->notification->object != notification->object)
+				continue;
+
+			/* keep the newest notification, its client data is the current one */
+			WMReleaseNotification(pending->notification);
+			pending->notification = WMRetainNotification(notification);
+			coalescedCount++;
+			return;
+		}
+	}
+
+	pending = wmalloc(sizeof(PendingDelivery));
+	pending->orec = orec;
+	pending->notification = WMRetainNotification(notification);
+	WMAddToArray(deliveries, pending);
+}
+
+static void dropPendingDeliveries(WMArray * deliveries, NotificationObserver * orec, void *object)
+{
+	PendingDelivery *pending;
+	int i;
+
+	for (i = WMGetArrayItemCount(deliveries) - 1; i >= 0; i--) {
+		pending = WMGetFromArray(deliveries, i);
+		if ((orec && pending->orec == orec) || (object && pending->notification->object == object)) {
+			WMDeleteFromArray(deliveries, i);
+			freePendingDelivery(pending);
+		}
+	}
+}
+
+static void freeObserverRecord(NotificationObserver * orec)
+{
+	if (orec->postingStyle != WMPostNow) {
+		dropPendingDeliveries(notificationCenter->asapDeliveries, orec, NULL);
+		dropPendingDeliveries(notificationCenter->idleDeliveries, orec, NULL);
+	}
+	WMSlabFree(observerSlab, orec);
+}
+
+/*
+ * Forgets every deferred delivery of a notification posted with object as
+ * its sender. Call it before freeing an object whose notifications may
+ * still be sitting in a queue.
+ */
+void WMCancelDeferredNotifications(void *object)
+{
+	if (!notificationCenter || !object)
+		return;
+
+	dropPendingDeliveries(notificationCenter->asapDeliveries, NULL, object);
+	dropPendingDeliveries(notificationCenter->idleDeliveries, NULL, object);
+}
+
+unsigned long WMGetCoalescedNotificationCount(void)
+{
+	return coalescedCount;
+}
+
 void WMPostNotification(WMNotification * notification)
 {
 	NotificationObserver *orec, *tmp;
@@ -171,9 +322,7 @@ void WMPostNotification(WMNotification * notification)
 
 		if (!orec->object || !notification->object || orec->object == notification->object) {
 			/* tell the observer */
-			if (orec->observerAction) {
-				(*orec->observerAction) (orec->observer, notification);
-			}
+			deliverNotification(orec, notification);
 		}
 
 		orec = tmp;
@@ -186,9 +335,7 @@ void WMPostNotification(WMNotification * notification)
 		tmp = orec->next;
 
 		/* tell the observer */
-		if (orec->observerAction) {
-			(*orec->observerAction) (orec->observer, notification);
-		}
+		deliverNotification(orec, notification);
 		orec = tmp;
 	}
 
@@ -198,9 +345,7 @@ void WMPostNotification(WMNotification * notification)
 		tmp = orec->next;
 
 		/* tell the observer */
-		if (orec->observerAction) {
-			(*orec->observerAction) (orec->observer, notification);
-		}
+		deliverNotification(orec, notification);
 		orec = tmp;
 	}
 
@@ -256,7 +401,7 @@ void WMRemoveNotificationObserver(void *observer)
 		if (orec->next)
 			orec->next->prev = orec->prev;
 
-		wfree(orec);
+		freeObserverRecord(orec);
 
 		orec = tmp;
 	}
@@ -315,7 +460,7 @@ void WMRemoveNotificationObserverWithName(void *observer, const char *name, void
 				orec->prev->next = orec->next;
 			if (orec->next)
 				orec->next->prev = orec->prev;
-			wfree(orec);
+			freeObserverRecord(orec);
 		} else {
 			/* append this action in the new action list */
 			orec->nextAction = NULL;
@@ -434,8 +579,14 @@ void
 WMEnqueueCoalesceNotification(WMNotificationQueue * queue,
 			      WMNotification * notification, WMPostingStyle postingStyle, unsigned coalesceMask)
 {
-	if (coalesceMask != WNCNone)
+	if (coalesceMask != WNCNone) {
+		int pending;
+
+		pending = WMGetArrayItemCount(queue->asapQueue) + WMGetArrayItemCount(queue->idleQueue);
 		WMDequeueNotificationMatching(queue, notification, coalesceMask);
+		coalescedCount += pending - WMGetArrayItemCount(queue->asapQueue)
+		    - WMGetArrayItemCount(queue->idleQueue);
+	}
 
 	switch (postingStyle) {
 	case WMPostNow:
@@ -453,6 +604,20 @@ WMEnqueueCoalesceNotification(WMNotificationQueue * queue,
 	}
 }
 
+static void flushPendingDeliveries(WMArray * deliveries)
+{
+	PendingDelivery *pending;
+
+	/* observers may post again while being told, which appends to the array */
+	while (WMGetArrayItemCount(deliveries)) {
+		pending = WMGetFromArray(deliveries, 0);
+		WMDeleteFromArray(deliveries, 0);
+
+		(*pending->orec->observerAction) (pending->orec->observer, pending->notification);
+		freePendingDelivery(pending);
+	}
+}
+
 void W_FlushASAPNotificationQueue(void)
 {
 	WMNotificationQueue *queue = notificationQueueList;
@@ -465,6 +630,8 @@ void W_FlushASAPNotificationQueue(void)
 
 		queue = queue->next;
 	}
+	if (notificationCenter)
+		flushPendingDeliveries(notificationCenter->asapDeliveries);
 }
 
 void W_FlushIdleNotificationQueue(void)
@@ -479,4 +646,6 @@ void W_FlushIdleNotificationQueue(void)
 
 		queue = queue->next;
 	}
+	if (notificationCenter)
+		flushPendingDeliveries(notificationCenter->idleDeliveries);
 }
@@ -4,8 +4,10 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <ftw.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,6 +17,10 @@
 #include "WUtil.h"
 #include "wconfig.h"
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 typedef enum {
 	WPLString = 0x57504c01,
 	WPLData = 0x57504c02,
@@ -33,20 +39,22 @@ typedef struct W_PropList {
 	} d;
 
 	int retainCount;
+
+	unsigned hash;		/* contents hash, for immutable lists */
+	Bool immutable;
+
+	unsigned char sizeClass;	/* slab the node came from, see allocPropList() */
 } W_PropList;
 
 typedef struct PLData {
 	const char *ptr;
 	int pos;
+	int length;
 	const char *filename;
 	int lineNumber;
+	WMHashTable *strings;	/* string contents -> WMPropList, for sharing */
 } PLData;
 
-typedef struct StringBuffer {
-	char *str;
-	int size;
-} StringBuffer;
-
 static unsigned hashPropList(const void *param);
 static WMPropList *getPLString(PLData * pldata);
 static WMPropList *getPLQString(PLData * pldata);
@@ -66,8 +74,16 @@ static const WMHashTableCallbacks WMPropListHashCallbacks = {
 
 static Bool caseSensitive = True;
 
+/* all the immutable property lists, see WMCreateImmutablePropList() */
+static WMHashTable *uniqueTable = NULL;
+
 #define BUFFERSIZE           8192
-#define BUFFERSIZE_INCREMENT 1024
+
+/* files at least this big are mapped instead of read into a buffer */
+#define MMAP_THRESHOLD       (64 * 1024)
+
+/* longest string token looked up in the document string table without allocating */
+#define INTERN_BUFFER_SIZE   256
 
 #if 0
 # define DPUT(s) puts(s)
@@ -83,11 +99,49 @@ static Bool caseSensitive = True;
 #define ISSTRINGABLE(c) (isalnum(c) || (c)=='.' || (c)=='_' || (c)=='/' \
     || (c)=='+')
 
-#define CHECK_BUFFER_SIZE(buf, ptr) \
-    if ((ptr) >= (buf).size-1) {\
-    (buf).size += BUFFERSIZE_INCREMENT;\
-    (buf).str = wrealloc((buf).str, (buf).size);\
-    }
+/*
+ * Strings created by the parser keep their characters in the same block as
+ * the node itself, so they must not be freed separately
+ */
+#define INLINE_STRING(plist) ((plist)->d.string == (char *)((plist) + 1))
+
+/*
+ * Nodes come from slabs of NODE_CLASS_SIZE byte steps, so a node and a
+ * short inline string share one of a few size classes. Size class 0 is
+ * used for nodes allocated with wmalloc().
+ */
+#define NODE_CLASS_SIZE      32
+#define NODE_CLASSES         8
+
+static WMSlab *nodeSlabs[NODE_CLASSES];
+
+static WMPropList *allocPropList(size_t stringSize)
+{
+	size_t size = sizeof(W_PropList) + stringSize;
+	int sizeClass = (size + NODE_CLASS_SIZE - 1) / NODE_CLASS_SIZE;
+	WMPropList *plist;
+	char name[32];
+
+	if (sizeClass > NODE_CLASSES)
+		return wmalloc(size);
+
+	if (!nodeSlabs[sizeClass - 1]) {
+		snprintf(name, sizeof(name), "WMPropList/%d", sizeClass * NODE_CLASS_SIZE);
+		nodeSlabs[sizeClass - 1] = WMCreateSlab(name, sizeClass * NODE_CLASS_SIZE);
+	}
+	plist = WMSlabAlloc(nodeSlabs[sizeClass - 1]);
+	plist->sizeClass = sizeClass;
+
+	return plist;
+}
+
+static void freePropList(WMPropList *plist)
+{
+	if (plist->sizeClass == 0)
+		wfree(plist);
+	else
+		WMSlabFree(nodeSlabs[plist->sizeClass - 1], plist);
+}
 
 #define inrange(ch, min, max) ((ch)>=(min) && (ch)<=(max))
 #define noquote(ch) (inrange(ch, 'a', 'z') || inrange(ch, 'A', 'Z') || inrange(ch, '0', '9') || ((ch)=='_') || ((ch)=='.') || ((ch)=='$'))
@@ -180,17 +234,22 @@ static void releasePropListByCount(WMPropList * plist, int count)
 
 	plist->retainCount -= count;
 
+	/* the table compares children, so it must be updated while they exist */
+	if (plist->immutable && plist->retainCount < 1)
+		WMHashRemove(uniqueTable, plist);
+
 	switch (plist->type) {
 	case WPLString:
 		if (plist->retainCount < 1) {
-			wfree(plist->d.string);
-			wfree(plist);
+			if (!INLINE_STRING(plist))
+				wfree(plist->d.string);
+			freePropList(plist);
 		}
 		break;
 	case WPLData:
 		if (plist->retainCount < 1) {
 			WMReleaseData(plist->d.data);
-			wfree(plist);
+			freePropList(plist);
 		}
 		break;
 	case WPLArray:
@@ -199,7 +258,7 @@ static void releasePropListByCount(WMPropList * plist, int count)
 		}
 		if (plist->retainCount < 1) {
 			WMFreeArray(plist->d.array);
-			wfree(plist);
+			freePropList(plist);
 		}
 		break;
 	case WPLDictionary:
@@ -210,7 +269,7 @@ static void releasePropListByCount(WMPropList * plist, int count)
 		}
 		if (plist->retainCount < 1) {
 			WMFreeHashTable(plist->d.dict);
-			wfree(plist);
+			freePropList(plist);
 		}
 		break;
 	default:
@@ -220,253 +279,361 @@ static void releasePropListByCount(WMPropList * plist, int count)
 	}
 }
 
-static char *dataDescription(WMPropList * plist)
+/*
+ * Descriptions are produced through a PLWriter, which either collects
+ * them in memory, streams them to a file through a fixed size buffer,
+ * only counts them, or compares them with the current contents of a file.
+ */
+typedef enum {
+	PLWriteMemory,
+	PLWriteFile,
+	PLWriteCount,
+	PLWriteCompare
+} PLWriteMode;
+
+typedef struct PLWriter {
+	PLWriteMode mode;
+	int fd;
+	char *buffer;
+	size_t size;
+	size_t used;		/* for PLWriteCompare, the unread part is [used, avail) */
+	size_t avail;
+	size_t total;		/* bytes produced so far */
+	size_t limit;		/* PLWriteCount stops once total goes past this */
+	Bool failed;		/* write error, mismatch or limit exceeded */
+} PLWriter;
+
+static void initWriter(PLWriter *writer, PLWriteMode mode, int fd, char *buffer, size_t size)
+{
+	memset(writer, 0, sizeof(PLWriter));
+	writer->mode = mode;
+	writer->fd = fd;
+	writer->buffer = buffer;
+	writer->size = size;
+	writer->limit = (size_t) -1;
+}
+
+static Bool flushWriter(PLWriter *writer)
+{
+	size_t done = 0;
+	ssize_t count;
+
+	if (writer->mode != PLWriteFile || writer->failed)
+		return !writer->failed;
+
+	while (done < writer->used) {
+		count = write(writer->fd, writer->buffer + done, writer->used - done);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0) {
+			writer->failed = True;
+			return False;
+		}
+		done += count;
+	}
+	writer->used = 0;
+
+	return True;
+}
+
+/* for PLWriteCompare, checks that the file has no more data */
+static Bool writerAtEnd(PLWriter *writer)
+{
+	ssize_t count;
+
+	if (writer->failed || writer->used < writer->avail)
+		return False;
+
+	do {
+		count = read(writer->fd, writer->buffer, writer->size);
+	} while (count < 0 && errno == EINTR);
+
+	return (count == 0);
+}
+
+static void putBytes(PLWriter *writer, const char *bytes, size_t len)
+{
+	size_t chunk;
+	ssize_t count;
+
+	if (writer->failed)
+		return;
+
+	writer->total += len;
+
+	switch (writer->mode) {
+	case PLWriteCount:
+		if (writer->total > writer->limit)
+			writer->failed = True;
+		break;
+
+	case PLWriteMemory:
+		if (writer->used + len + 1 > writer->size) {
+			while (writer->used + len + 1 > writer->size)
+				writer->size = writer->size * 2 + 64;
+			writer->buffer = wrealloc(writer->buffer, writer->size);
+		}
+		memcpy(writer->buffer + writer->used, bytes, len);
+		writer->used += len;
+		break;
+
+	case PLWriteFile:
+		while (len > 0) {
+			if (writer->used == writer->size && !flushWriter(writer))
+				return;
+			chunk = writer->size - writer->used;
+			if (chunk > len)
+				chunk = len;
+			memcpy(writer->buffer + writer->used, bytes, chunk);
+			writer->used += chunk;
+			bytes += chunk;
+			len -= chunk;
+		}
+		break;
+
+	case PLWriteCompare:
+		while (len > 0) {
+			if (writer->used == writer->avail) {
+				do {
+					count = read(writer->fd, writer->buffer, writer->size);
+				} while (count < 0 && errno == EINTR);
+				if (count <= 0) {
+					writer->failed = True;
+					return;
+				}
+				writer->used = 0;
+				writer->avail = count;
+			}
+			chunk = writer->avail - writer->used;
+			if (chunk > len)
+				chunk = len;
+			if (memcmp(writer->buffer + writer->used, bytes, chunk) != 0) {
+				writer->failed = True;
+				return;
+			}
+			writer->used += chunk;
+			bytes += chunk;
+			len -= chunk;
+		}
+		break;
+	}
+}
+
+static inline void putChar(PLWriter *writer, char ch)
+{
+	if (writer->mode == PLWriteFile && writer->used < writer->size && !writer->failed) {
+		writer->buffer[writer->used++] = ch;
+		writer->total++;
+	} else {
+		putBytes(writer, &ch, 1);
+	}
+}
+
+static void putIndent(PLWriter *writer, int count)
+{
+	static const char spaces[] = "                                ";
+
+	while (count > 0) {
+		int chunk = (count < sizeof(spaces) - 1) ? count : sizeof(spaces) - 1;
+
+		putBytes(writer, spaces, chunk);
+		count -= chunk;
+	}
+}
+
+static void writeData(PLWriter *writer, WMPropList * plist)
 {
 	const unsigned char *data;
-	char *retVal;
-	int i, j, length;
+	int i, length;
 
 	data = WMDataBytes(plist->d.data);
 	length = WMGetDataLength(plist->d.data);
 
-	retVal = (char *)wmalloc(2 * length + length / 4 + 3);
-
-	retVal[0] = '<';
-	for (i = 0, j = 1; i < length; i++) {
-		retVal[j++] = num2char((data[i] >> 4) & 0x0f);
-		retVal[j++] = num2char(data[i] & 0x0f);
+	putChar(writer, '<');
+	for (i = 0; i < length; i++) {
+		putChar(writer, num2char((data[i] >> 4) & 0x0f));
+		putChar(writer, num2char(data[i] & 0x0f));
 		if ((i & 0x03) == 3 && i != length - 1) {
 			/* if we've just finished a 32-bit int, add a space */
-			retVal[j++] = ' ';
+			putChar(writer, ' ');
 		}
 	}
-	retVal[j++] = '>';
-	retVal[j] = '\0';
-
-	return retVal;
+	putChar(writer, '>');
 }
 
-static char *stringDescription(WMPropList * plist)
+static void writeString(PLWriter *writer, WMPropList * plist)
 {
-	const char *str;
-	char *retVal, *sPtr, *dPtr;
-	int len, quote;
+	const unsigned char *str, *sPtr;
 	unsigned char ch;
+	int quote;
 
-	str = plist->d.string;
+	str = (const unsigned char *)plist->d.string;
 
-	if (strlen(str) == 0) {
-		return wstrdup("\"\"");
+	if (*str == 0) {
+		putBytes(writer, "\"\"", 2);
+		return;
 	}
 
 	/* FIXME: make this work with unichars. */
 
 	quote = 0;
-	sPtr = (char *)str;
-	len = 0;
-	while ((ch = *sPtr)) {
-		if (!noquote(ch)) {
+	for (sPtr = str; *sPtr; sPtr++) {
+		if (!noquote(*sPtr)) {
 			quote = 1;
-			if (charesc(ch))
-				len++;
-			else if (numesc(ch))
-				len += 3;
+			break;
 		}
-		sPtr++;
-		len++;
 	}
 
-	if (quote)
-		len += 2;
-
-	retVal = (char *)wmalloc(len + 1);
-
-	sPtr = (char *)str;
-	dPtr = retVal;
+	if (!quote) {
+		putBytes(writer, (const char *)str, sPtr - str + strlen((const char *)sPtr));
+		return;
+	}
 
-	if (quote)
-		*dPtr++ = '"';
+	putChar(writer, '"');
 
-	while ((ch = *sPtr)) {
+	for (sPtr = str; (ch = *sPtr); sPtr++) {
 		if (charesc(ch)) {
-			*(dPtr++) = '\\';
+			putChar(writer, '\\');
 			switch (ch) {
 			case '\a':
-				*dPtr = 'a';
+				putChar(writer, 'a');
 				break;
 			case '\b':
-				*dPtr = 'b';
+				putChar(writer, 'b');
 				break;
 			case '\t':
-				*dPtr = 't';
+				putChar(writer, 't');
 				break;
 			case '\n':
-				*dPtr = 'n';
+				putChar(writer, 'n');
 				break;
 			case '\v':
-				*dPtr = 'v';
+				putChar(writer, 'v');
 				break;
 			case '\f':
-				*dPtr = 'f';
+				putChar(writer, 'f');
 				break;
 			default:
-				*dPtr = ch;	/* " or \ */
+				putChar(writer, ch);	/* " or \ */
 			}
 		} else if (numesc(ch)) {
-			*(dPtr++) = '\\';
-			*(dPtr++) = '0' + ((ch >> 6) & 07);
-			*(dPtr++) = '0' + ((ch >> 3) & 07);
-			*dPtr = '0' + (ch & 07);
+			putChar(writer, '\\');
+			putChar(writer, '0' + ((ch >> 6) & 07));
+			putChar(writer, '0' + ((ch >> 3) & 07));
+			putChar(writer, '0' + (ch & 07));
 		} else {
-			*dPtr = ch;
+			putChar(writer, ch);
 		}
-		sPtr++;
-		dPtr++;
 	}
 
-	if (quote)
-		*dPtr++ = '"';
-
-	*dPtr = '\0';
-
-	return retVal;
+	putChar(writer, '"');
 }
 
-static char *description(WMPropList * plist)
+static void writeDescription(PLWriter *writer, WMPropList * plist)
 {
 	WMPropList *key, *val;
-	char *retstr = NULL;
-	char *str, *tmp, *skey, *sval;
 	WMHashEnumerator e;
 	int i;
 
 	switch (plist->type) {
 	case WPLString:
-		retstr = stringDescription(plist);
+		writeString(writer, plist);
 		break;
 	case WPLData:
-		retstr = dataDescription(plist);
+		writeData(writer, plist);
 		break;
 	case WPLArray:
-		retstr = wstrdup("(");
-		for (i = 0; i < WMGetArrayItemCount(plist->d.array); i++) {
-			str = description(WMGetFromArray(plist->d.array, i));
-			if (i == 0) {
-				retstr = wstrappend(retstr, str);
-			} else {
-				tmp = (char *)wmalloc(strlen(retstr) + strlen(str) + 3);
-				sprintf(tmp, "%s, %s", retstr, str);
-				wfree(retstr);
-				retstr = tmp;
-			}
-			wfree(str);
+		putChar(writer, '(');
+		for (i = 0; i < WMGetArrayItemCount(plist->d.array) && !writer->failed; i++) {
+			if (i > 0)
+				putBytes(writer, ", ", 2);
+			writeDescription(writer, WMGetFromArray(plist->d.array, i));
 		}
-		retstr = wstrappend(retstr, ")");
+		putChar(writer, ')');
 		break;
 	case WPLDictionary:
-		retstr = wstrdup("{");
+		putChar(writer, '{');
 		e = WMEnumerateHashTable(plist->d.dict);
-		while (WMNextHashEnumeratorItemAndKey(&e, (void **)&val, (void **)&key)) {
-			skey = description(key);
-			sval = description(val);
-			tmp = (char *)wmalloc(strlen(retstr) + strlen(skey) + strlen(sval) + 5);
-			sprintf(tmp, "%s%s = %s;", retstr, skey, sval);
-			wfree(skey);
-			wfree(sval);
-			wfree(retstr);
-			retstr = tmp;
-		}
-		retstr = wstrappend(retstr, "}");
+		while (!writer->failed && WMNextHashEnumeratorItemAndKey(&e, (void **)&val, (void **)&key)) {
+			writeDescription(writer, key);
+			putBytes(writer, " = ", 3);
+			writeDescription(writer, val);
+			putChar(writer, ';');
+		}
+		putChar(writer, '}');
 		break;
 	default:
 		wwarning(_("Used proplist functions on non-WMPropLists objects"));
-		wassertrv(False, NULL);
+		wassertr(False);
 		break;
 	}
-
-	return retstr;
 }
 
-static char *indentedDescription(WMPropList * plist, int level)
+static void writeIndentedDescription(PLWriter *writer, WMPropList * plist, int level)
 {
 	WMPropList *key, *val;
-	char *retstr = NULL;
-	char *str, *tmp, *skey, *sval;
 	WMHashEnumerator e;
+	PLWriter counter;
 	int i;
 
 	if (plist->type == WPLArray /* || plist->type==WPLDictionary */ ) {
-		retstr = description(plist);
-
-		if (retstr && ((2 * (level + 1) + strlen(retstr)) <= 77)) {
-			return retstr;
-		} else if (retstr) {
-			wfree(retstr);
-			retstr = NULL;
+		/* short arrays go in a single line */
+		initWriter(&counter, PLWriteCount, -1, NULL, 0);
+		/* past 38 levels there is no room left, and the limit is unsigned */
+		counter.limit = level < 38 ? 77 - 2 * (level + 1) : 0;
+		writeDescription(&counter, plist);
+		if (!counter.failed) {
+			writeDescription(writer, plist);
+			return;
 		}
 	}
 
 	switch (plist->type) {
 	case WPLString:
-		retstr = stringDescription(plist);
+		writeString(writer, plist);
 		break;
 	case WPLData:
-		retstr = dataDescription(plist);
+		writeData(writer, plist);
 		break;
 	case WPLArray:
-		retstr = wstrdup("(\n");
-		for (i = 0; i < WMGetArrayItemCount(plist->d.array); i++) {
-			str = indentedDescription(WMGetFromArray(plist->d.array, i), level + 1);
-			if (i == 0) {
-				tmp = (char *)wmalloc(2 * (level + 1) + strlen(retstr) + strlen(str) + 1);
-				sprintf(tmp, "%s%*s%s", retstr, 2 * (level + 1), "", str);
-				wfree(retstr);
-				retstr = tmp;
-			} else {
-				tmp = (char *)wmalloc(2 * (level + 1) + strlen(retstr) + strlen(str) + 3);
-				sprintf(tmp, "%s,\n%*s%s", retstr, 2 * (level + 1), "", str);
-				wfree(retstr);
-				retstr = tmp;
-			}
-			wfree(str);
+		putBytes(writer, "(\n", 2);
+		for (i = 0; i < WMGetArrayItemCount(plist->d.array) && !writer->failed; i++) {
+			if (i > 0)
+				putBytes(writer, ",\n", 2);
+			putIndent(writer, 2 * (level + 1));
+			writeIndentedDescription(writer, WMGetFromArray(plist->d.array, i), level + 1);
 		}
-		tmp = (char *)wmalloc(strlen(retstr) + 2 * level + 3);
-		sprintf(tmp, "%s\n%*s)", retstr, 2 * level, "");
-		wfree(retstr);
-		retstr = tmp;
+		putChar(writer, '\n');
+		putIndent(writer, 2 * level);
+		putChar(writer, ')');
 		break;
 	case WPLDictionary:
-		retstr = wstrdup("{\n");
+		putBytes(writer, "{\n", 2);
 		e = WMEnumerateHashTable(plist->d.dict);
-		while (WMNextHashEnumeratorItemAndKey(&e, (void **)&val, (void **)&key)) {
-			skey = indentedDescription(key, level + 1);
-			sval = indentedDescription(val, level + 1);
-			tmp = (char *)wmalloc(2 * (level + 1) + strlen(retstr) + strlen(skey)
-					      + strlen(sval) + 6);
-			sprintf(tmp, "%s%*s%s = %s;\n", retstr, 2 * (level + 1), "", skey, sval);
-			wfree(skey);
-			wfree(sval);
-			wfree(retstr);
-			retstr = tmp;
-		}
-		tmp = (char *)wmalloc(strlen(retstr) + 2 * level + 2);
-		sprintf(tmp, "%s%*s}", retstr, 2 * level, "");
-		wfree(retstr);
-		retstr = tmp;
+		while (!writer->failed && WMNextHashEnumeratorItemAndKey(&e, (void **)&val, (void **)&key)) {
+			putIndent(writer, 2 * (level + 1));
+			writeIndentedDescription(writer, key, level + 1);
+			putBytes(writer, " = ", 3);
+			writeIndentedDescription(writer, val, level + 1);
+			putBytes(writer, ";\n", 2);
+		}
+		putIndent(writer, 2 * level);
+		putChar(writer, '}');
 		break;
 	default:
 		wwarning(_("Used proplist functions on non-WMPropLists objects"));
-		wassertrv(False, NULL);
+		wassertr(False);
 		break;
 	}
-
-	return retstr;
 }
 
 static inline int getChar(PLData * pldata)
 {
 	int c;
 
+	if (pldata->pos >= pldata->length)
+		return 0;
+
 	c = pldata->ptr[pldata->pos];
 	if (c == 0) {
 		return 0;
@@ -485,6 +652,8 @@ static inline int getNonSpaceChar(PLData * pldata)
 	int c;
 
 	while (1) {
+		if (pldata->pos >= pldata->length)
+			return 0;
 		c = pldata->ptr[pldata->pos];
 		if (c == 0) {
 			break;
@@ -500,37 +669,33 @@ static inline int getNonSpaceChar(PLData * pldata)
 	return c;
 }
 
-static char *unescapestr(const char *src)
+/*
+ * Copies the len characters of src to dest, resolving the backslash escapes.
+ * The result is never longer than the source.
+ */
+static void unescapestr(char *dest, const char *src, int len)
 {
-	char *dest = wmalloc(strlen(src) + 1);
+	const char *end = src + len;
 	char *dPtr;
 	char ch;
 
-	for (dPtr = dest; ; dPtr++) {
+	for (dPtr = dest; src < end; dPtr++) {
 		ch = *src++;
-		if (ch == '\0')
-			break;
-		else if (ch != '\\')
+		if (ch != '\\')
 			*dPtr = ch;
+		else if (src == end)
+			*dPtr = '\\';
 		else {
 			ch = *(src++);
-			if (ch == '\0') {
-				*dPtr = '\\';
-				break;
-			} else if ((ch >= '0') && (ch <= '7')) {
+			if ((ch >= '0') && (ch <= '7')) {
 				char wch;
 
 				/* Convert octal number to character */
 				wch = (ch & 07);
-				ch = *src;
-				if ((ch >= '0') && (ch <= '7')) {
-					src++;
-					wch = (wch << 3) | (ch & 07);
-					ch = *src;
-					if ((ch >= '0') && (ch <= '7')) {
-						src++;
-						wch = (wch << 3) | (ch & 07);
-					}
+				if (src < end && (*src >= '0') && (*src <= '7')) {
+					wch = (wch << 3) | (*src++ & 07);
+					if (src < end && (*src >= '0') && (*src <= '7'))
+						wch = (wch << 3) | (*src++ & 07);
 				}
 				*dPtr = wch;
 			} else {
@@ -564,96 +729,87 @@ static char *unescapestr(const char *src)
 	}
 
 	*dPtr = 0;
-
-	return dest;
 }
 
-static WMPropList *getPLString(PLData * pldata)
+/*
+ * Makes a string node for the len characters at src, which still contain
+ * backslash escapes if escaped is set. The characters are stored in the
+ * same allocation as the node, and a string that already appeared in the
+ * document is shared instead of being created again: domain files repeat
+ * the same keys and values (NoAppIcon, Yes, ...) over and over.
+ */
+static WMPropList *getPLStringToken(PLData * pldata, const char *src, int len, Bool escaped)
 {
-	WMPropList *plist;
-	StringBuffer sBuf;
-	int ptr = 0;
-	int c;
-
-	sBuf.str = wmalloc(BUFFERSIZE);
-	sBuf.size = BUFFERSIZE;
-
-	while (1) {
-		c = getChar(pldata);
-		if (ISSTRINGABLE(c)) {
-			CHECK_BUFFER_SIZE(sBuf, ptr);
-			sBuf.str[ptr++] = c;
-		} else {
-			if (c != 0) {
-				pldata->pos--;
-			}
-			break;
-		}
+	WMPropList *plist, *shared;
+	char buffer[INTERN_BUFFER_SIZE];
+
+	if (!escaped && len < sizeof(buffer)) {
+		memcpy(buffer, src, len);
+		buffer[len] = 0;
+		shared = WMHashGet(pldata->strings, buffer);
+		if (shared)
+			return WMRetainPropList(shared);
 	}
 
-	sBuf.str[ptr] = 0;
+	plist = allocPropList(len + 1);
+	plist->type = WPLString;
+	plist->d.string = (char *)(plist + 1);
+	plist->retainCount = 1;
 
-	if (ptr == 0) {
-		plist = NULL;
+	if (escaped) {
+		unescapestr(plist->d.string, src, len);
+		shared = WMHashGet(pldata->strings, plist->d.string);
+		if (shared) {
+			freePropList(plist);
+			return WMRetainPropList(shared);
+		}
 	} else {
-		char *tmp = unescapestr(sBuf.str);
-		plist = WMCreatePLString(tmp);
-		wfree(tmp);
+		memcpy(plist->d.string, src, len);
 	}
 
-	wfree(sBuf.str);
+	/* the table keeps its own reference until the parsing is over */
+	WMHashInsert(pldata->strings, plist->d.string, WMRetainPropList(plist));
 
 	return plist;
 }
 
+static WMPropList *getPLString(PLData * pldata)
+{
+	int start = pldata->pos;
+
+	/* unquoted strings can contain neither escapes nor newlines */
+	while (pldata->pos < pldata->length && ISSTRINGABLE((unsigned char)pldata->ptr[pldata->pos]))
+		pldata->pos++;
+
+	if (pldata->pos == start)
+		return NULL;
+
+	return getPLStringToken(pldata, pldata->ptr + start, pldata->pos - start, False);
+}
+
 static WMPropList *getPLQString(PLData * pldata)
 {
-	WMPropList *plist;
-	int ptr = 0, escaping = 0, ok = 1;
+	Bool escaped = False;
+	int start = pldata->pos;
 	int c;
-	StringBuffer sBuf;
-
-	sBuf.str = wmalloc(BUFFERSIZE);
-	sBuf.size = BUFFERSIZE;
 
 	while (1) {
 		c = getChar(pldata);
-		if (!escaping) {
-			if (c == '\\') {
-				escaping = 1;
-				continue;
-			} else if (c == '"') {
-				break;
-			}
-		} else {
-			CHECK_BUFFER_SIZE(sBuf, ptr);
-			sBuf.str[ptr++] = '\\';
-			escaping = 0;
+		if (c == '\\') {
+			escaped = True;
+			c = getChar(pldata);
+		} else if (c == '"') {
+			break;
 		}
 
 		if (c == 0) {
 			COMPLAIN(pldata, _("unterminated PropList string"));
-			ok = 0;
-			break;
-		} else {
-			CHECK_BUFFER_SIZE(sBuf, ptr);
-			sBuf.str[ptr++] = c;
+			return NULL;
 		}
 	}
 
-	sBuf.str[ptr] = 0;
-
-	if (!ok) {
-		plist = NULL;
-	} else {
-		char *tmp = unescapestr(sBuf.str);
-		plist = WMCreatePLString(tmp);
-		wfree(tmp);
-	}
-
-	wfree(sBuf.str);
-
-	return plist;
+	/* the text is used straight from the source, without the closing quote */
+	return getPLStringToken(pldata, pldata->ptr + start, pldata->pos - start - 1, escaped);
 }
 
 static WMPropList *getPLData(PLData * pldata)
@@ -749,8 +905,8 @@ static WMPropList *getPLArray(PLData * pldata)
 			ok = 0;
 			break;
 		}
-		WMAddToPLArray(array, obj);
-		WMReleasePropList(obj);
+		/* the array is only referenced by us, so hand over our reference */
+		WMAddToArray(array->d.array, obj);
 	}
 
 	if (!ok) {
@@ -830,9 +986,9 @@ static WMPropList *getPLDictionary(PLData * pldata)
 			break;
 		}
 
-		WMPutInPLDictionary(dict, key, value);
-		WMReleasePropList(key);
-		WMReleasePropList(value);
+		/* as with arrays, the dictionary takes over our references */
+		WMRemoveFromPLDictionary(dict, key);
+		WMHashInsert(dict->d.dict, key, value);
 	}
 
 	if (!ok) {
@@ -895,74 +1051,254 @@ static WMPropList *getPropList(PLData * pldata)
 	return plist;
 }
 
-void WMPLSetCaseSensitive(Bool caseSensitiveness)
+/*
+ * Immutable property lists
+ *
+ * WMCreateImmutablePropList() returns the unique immutable instance of a
+ * given property list: all the immutable lists with the same contents are
+ * the same object, found through uniqueTable. The table does not hold
+ * references, lists leave it when they are freed.
+ *
+ * Every immutable list caches a hash of its contents which ignores the
+ * case of strings, so two of them with different hashes can never be
+ * equal, whatever WMPLSetCaseSensitive() says. Together with identity
+ * this makes comparing them a constant time operation in practice.
+ */
+
+static unsigned hashUniqueNode(const void *param)
 {
-	caseSensitive = caseSensitiveness;
+	return ((const WMPropList *)param)->hash;
 }
 
-WMPropList *WMCreatePLString(const char *str)
+/* exact comparison, children of immutable lists are compared by identity */
+static Bool isSameUniqueNode(const void *param1, const void *param2)
 {
-	WMPropList *plist;
+	const WMPropList *plist = param1, *other = param2;
+	WMPropList *key, *value, *okey, *ovalue;
+	WMHashEnumerator e;
+	int i, n;
 
-	wassertrv(str != NULL, NULL);
+	if (plist == other)
+		return True;
+	if (plist->type != other->type || plist->hash != other->hash)
+		return False;
 
-	plist = (WMPropList *) wmalloc(sizeof(W_PropList));
-	plist->type = WPLString;
-	plist->d.string = wstrdup(str);
-	plist->retainCount = 1;
+	switch (plist->type) {
+	case WPLString:
+		return (strcmp(plist->d.string, other->d.string) == 0);
+	case WPLData:
+		return WMIsDataEqualToData(plist->d.data, other->d.data);
+	case WPLArray:
+		n = WMGetArrayItemCount(plist->d.array);
+		if (n != WMGetArrayItemCount(other->d.array))
+			return False;
+		for (i = 0; i < n; i++) {
+			if (WMGetFromArray(plist->d.array, i) != WMGetFromArray(other->d.array, i))
+				return False;
+		}
+		return True;
+	case WPLDictionary:
+		if (WMCountHashTable(plist->d.dict) != WMCountHashTable(other->d.dict))
+			return False;
+		e = WMEnumerateHashTable(plist->d.dict);
+		while (WMNextHashEnumeratorItemAndKey(&e, (void **)&value, (void **)&key)) {
+			if (!WMHashGetItemAndKey(other->d.dict, key, (void **)&ovalue, (void **)&okey) ||
+			    okey != key || ovalue != value)
+				return False;
+		}
+		return True;
+	default:
+		break;
+	}
 
-	return plist;
+	return False;
 }
 
-WMPropList *WMCreatePLData(WMData * data)
-{
-	WMPropList *plist;
+static const WMHashTableCallbacks UniquePropListHashCallbacks = {
+	hashUniqueNode,
+	isSameUniqueNode,
+	NULL,
+	NULL
+};
 
-	wassertrv(data != NULL, NULL);
+static unsigned hashBytes(unsigned hash, const unsigned char *bytes, int length, Bool fold)
+{
+	int i;
 
-	plist = (WMPropList *) wmalloc(sizeof(W_PropList));
-	plist->type = WPLData;
-	plist->d.data = WMRetainData(data);
-	plist->retainCount = 1;
+	for (i = 0; i < length; i++) {
+		hash ^= fold ? tolower(bytes[i]) : bytes[i];
+		hash *= 16777619U;
+	}
 
-	return plist;
+	return hash;
 }
 
-WMPropList *WMCreatePLDataWithBytes(const unsigned char *bytes, unsigned int length)
+/* hash of a list whose children are already immutable */
+static unsigned hashUniqueContents(WMPropList * plist)
 {
-	WMPropList *plist;
-
-	wassertrv(bytes != NULL, NULL);
+	WMPropList *key, *value;
+	WMHashEnumerator e;
+	unsigned hash = 2166136261U ^ plist->type;
+	int i;
 
-	plist = (WMPropList *) wmalloc(sizeof(W_PropList));
-	plist->type = WPLData;
-	plist->d.data = WMCreateDataWithBytes(bytes, length);
-	plist->retainCount = 1;
+	switch (plist->type) {
+	case WPLString:
+		hash = hashBytes(hash, (const unsigned char *)plist->d.string, strlen(plist->d.string), True);
+		break;
+	case WPLData:
+		hash = hashBytes(hash, WMDataBytes(plist->d.data), WMGetDataLength(plist->d.data), False);
+		break;
+	case WPLArray:
+		for (i = 0; i < WMGetArrayItemCount(plist->d.array); i++)
+			hash = (hash ^ ((WMPropList *) WMGetFromArray(plist->d.array, i))->hash) * 16777619U;
+		break;
+	case WPLDictionary:
+		/* entries are combined in a way that does not depend on their order */
+		e = WMEnumerateHashTable(plist->d.dict);
+		while (WMNextHashEnumeratorItemAndKey(&e, (void **)&value, (void **)&key))
+			hash += (key->hash * 0x9e3779b1U) ^ value->hash;
+		break;
+	default:
+		break;
+	}
 
-	return plist;
+	return hash;
 }
 
-WMPropList *WMCreatePLDataWithBytesNoCopy(unsigned char *bytes, unsigned int length, WMFreeDataProc * destructor)
+/* takes over plist, whose children must already be immutable */
+static WMPropList *internPropList(WMPropList * plist)
 {
-	WMPropList *plist;
+	WMPropList *unique;
 
-	wassertrv(bytes != NULL, NULL);
+	if (!uniqueTable)
+		uniqueTable = WMCreateHashTable(UniquePropListHashCallbacks);
 
-	plist = (WMPropList *) wmalloc(sizeof(W_PropList));
-	plist->type = WPLData;
-	plist->d.data = WMCreateDataWithBytesNoCopy(bytes, length, destructor);
-	plist->retainCount = 1;
+	plist->hash = hashUniqueContents(plist);
+
+	unique = WMHashGet(uniqueTable, plist);
+	if (unique) {
+		WMRetainPropList(unique);
+		WMReleasePropList(plist);
+		return unique;
+	}
+
+	plist->immutable = True;
+	WMHashInsert(uniqueTable, plist, plist);
 
 	return plist;
 }
 
-WMPropList *WMCreatePLArray(WMPropList * elem, ...)
+WMPropList *WMCreateImmutablePropList(WMPropList * plist)
 {
-	WMPropList *plist, *nelem;
-	va_list ap;
+	WMPropList *copy, *key, *value;
+	WMHashEnumerator e;
+	int i;
 
-	plist = (WMPropList *) wmalloc(sizeof(W_PropList));
-	plist->type = WPLArray;
+	if (plist->immutable)
+		return WMRetainPropList(plist);
+
+	switch (plist->type) {
+	case WPLString:
+		copy = WMCreatePLString(plist->d.string);
+		break;
+	case WPLData:
+		copy = WMCreatePLDataWithBytes(WMDataBytes(plist->d.data), WMGetDataLength(plist->d.data));
+		break;
+	case WPLArray:
+		copy = WMCreatePLArray(NULL);
+		for (i = 0; i < WMGetArrayItemCount(plist->d.array); i++)
+			WMAddToArray(copy->d.array, WMCreateImmutablePropList(WMGetFromArray(plist->d.array, i)));
+		break;
+	case WPLDictionary:
+		copy = WMCreatePLDictionary(NULL, NULL);
+		e = WMEnumerateHashTable(plist->d.dict);
+		while (WMNextHashEnumeratorItemAndKey(&e, (void **)&value, (void **)&key)) {
+			WMHashInsert(copy->d.dict, WMCreateImmutablePropList(key),
+				     WMCreateImmutablePropList(value));
+		}
+		break;
+	default:
+		wwarning(_("Used proplist functions on non-WMPropLists objects"));
+		wassertrv(False, NULL);
+		break;
+	}
+
+	return internPropList(copy);
+}
+
+Bool WMIsPropListImmutable(WMPropList * plist)
+{
+	return plist->immutable;
+}
+
+void WMPLSetCaseSensitive(Bool caseSensitiveness)
+{
+	caseSensitive = caseSensitiveness;
+}
+
+WMPropList *WMCreatePLString(const char *str)
+{
+	WMPropList *plist;
+
+	wassertrv(str != NULL, NULL);
+
+	plist = allocPropList(0);
+	plist->type = WPLString;
+	plist->d.string = wstrdup(str);
+	plist->retainCount = 1;
+
+	return plist;
+}
+
+WMPropList *WMCreatePLData(WMData * data)
+{
+	WMPropList *plist;
+
+	wassertrv(data != NULL, NULL);
+
+	plist = allocPropList(0);
+	plist->type = WPLData;
+	plist->d.data = WMRetainData(data);
+	plist->retainCount = 1;
+
+	return plist;
+}
+
+WMPropList *WMCreatePLDataWithBytes(const unsigned char *bytes, unsigned int length)
+{
+	WMPropList *plist;
+
+	wassertrv(bytes != NULL, NULL);
+
+	plist = allocPropList(0);
+	plist->type = WPLData;
+	plist->d.data = WMCreateDataWithBytes(bytes, length);
+	plist->retainCount = 1;
+
+	return plist;
+}
+
+WMPropList *WMCreatePLDataWithBytesNoCopy(unsigned char *bytes, unsigned int length, WMFreeDataProc * destructor)
+{
+	WMPropList *plist;
+
+	wassertrv(bytes != NULL, NULL);
+
+	plist = allocPropList(0);
+	plist->type = WPLData;
+	plist->d.data = WMCreateDataWithBytesNoCopy(bytes, length, destructor);
+	plist->retainCount = 1;
+
+	return plist;
+}
+
+WMPropList *WMCreatePLArray(WMPropList * elem, ...)
+{
+	WMPropList *plist, *nelem;
+	va_list ap;
+
+	plist = allocPropList(0);
+	plist->type = WPLArray;
 	plist->d.array = WMCreateArray(4);
 	plist->retainCount = 1;
 
@@ -988,7 +1324,7 @@ WMPropList *WMCreatePLDictionary(WMPropList * key, WMPropList * value, ...)
 	WMPropList *plist, *nkey, *nvalue, *k, *v;
 	va_list ap;
 
-	plist = (WMPropList *) wmalloc(sizeof(W_PropList));
+	plist = allocPropList(0);
 	plist->type = WPLDictionary;
 	plist->d.dict = WMCreateHashTable(WMPropListHashCallbacks);
 	plist->retainCount = 1;
@@ -1061,17 +1397,22 @@ void WMReleasePropList(WMPropList * plist)
 
 	plist->retainCount--;
 
+	/* the table compares children, so it must be updated while they exist */
+	if (plist->immutable && plist->retainCount < 1)
+		WMHashRemove(uniqueTable, plist);
+
 	switch (plist->type) {
 	case WPLString:
 		if (plist->retainCount < 1) {
-			wfree(plist->d.string);
-			wfree(plist);
+			if (!INLINE_STRING(plist))
+				wfree(plist->d.string);
+			freePropList(plist);
 		}
 		break;
 	case WPLData:
 		if (plist->retainCount < 1) {
 			WMReleaseData(plist->d.data);
-			wfree(plist);
+			freePropList(plist);
 		}
 		break;
 	case WPLArray:
@@ -1080,7 +1421,7 @@ void WMReleasePropList(WMPropList * plist)
 		}
 		if (plist->retainCount < 1) {
 			WMFreeArray(plist->d.array);
-			wfree(plist);
+			freePropList(plist);
 		}
 		break;
 	case WPLDictionary:
@@ -1091,7 +1432,7 @@ void WMReleasePropList(WMPropList * plist)
 		}
 		if (plist->retainCount < 1) {
 			WMFreeHashTable(plist->d.dict);
-			wfree(plist);
+			freePropList(plist);
 		}
 		break;
 	default:
@@ -1104,6 +1445,7 @@ void WMReleasePropList(WMPropList * plist)
 void WMInsertInPLArray(WMPropList * plist, int index, WMPropList * item)
 {
 	wassertr(plist->type == WPLArray);
+	wassertr(!plist->immutable);
 
 	retainPropListByCount(item, plist->retainCount);
 	WMInsertInArray(plist->d.array, index, item);
@@ -1112,6 +1454,7 @@ void WMInsertInPLArray(WMPropList * plist, int index, WMPropList * item)
 void WMAddToPLArray(WMPropList * plist, WMPropList * item)
 {
 	wassertr(plist->type == WPLArray);
+	wassertr(!plist->immutable);
 
 	retainPropListByCount(item, plist->retainCount);
 	WMAddToArray(plist->d.array, item);
@@ -1122,6 +1465,7 @@ void WMDeleteFromPLArray(WMPropList * plist, int index)
 	WMPropList *item;
 
 	wassertr(plist->type == WPLArray);
+	wassertr(!plist->immutable);
 
 	item = WMGetFromArray(plist->d.array, index);
 	if (item != NULL) {
@@ -1136,6 +1480,7 @@ void WMRemoveFromPLArray(WMPropList * plist, WMPropList * item)
 	int i;
 
 	wassertr(plist->type == WPLArray);
+	wassertr(!plist->immutable);
 
 	for (i = 0; i < WMGetArrayItemCount(plist->d.array); i++) {
 		iPtr = WMGetFromArray(plist->d.array, i);
@@ -1150,6 +1495,7 @@ void WMRemoveFromPLArray(WMPropList * plist, WMPropList * item)
 void WMPutInPLDictionary(WMPropList * plist, WMPropList * key, WMPropList * value)
 {
 	wassertr(plist->type == WPLDictionary);
+	wassertr(!plist->immutable);
 
 	/*WMRetainPropList(key); */
 	WMRemoveFromPLDictionary(plist, key);
@@ -1164,6 +1510,7 @@ void WMRemoveFromPLDictionary(WMPropList * plist, WMPropList * key)
 	WMPropList *k, *v;
 
 	wassertr(plist->type == WPLDictionary);
+	wassertr(!plist->immutable);
 
 	if (WMHashGetItemAndKey(plist->d.dict, key, (void **)&v, (void **)&k)) {
 		WMHashRemove(plist->d.dict, k);
@@ -1172,12 +1519,33 @@ void WMRemoveFromPLDictionary(WMPropList * plist, WMPropList * key)
 	}
 }
 
+/*
+ * Replaces the immutable value for key in dict by a mutable copy of its
+ * first level, so that it can be changed, and returns that copy.
+ */
+static WMPropList *mutableCopyInDictionary(WMPropList * dict, WMPropList * key, WMPropList * value)
+{
+	WMPropList *dkey, *copy;
+
+	if (!WMHashGetItemAndKey(dict->d.dict, key, (void **)&value, (void **)&dkey))
+		return NULL;
+
+	copy = WMShallowCopyPropList(value);
+	WMRetainPropList(dkey);
+	WMPutInPLDictionary(dict, dkey, copy);
+	WMReleasePropList(dkey);
+	WMReleasePropList(copy);
+
+	return copy;
+}
+
 WMPropList *WMMergePLDictionaries(WMPropList * dest, WMPropList * source, Bool recursive)
 {
 	WMPropList *key, *value, *dvalue;
 	WMHashEnumerator e;
 
 	wassertrv(source->type == WPLDictionary && dest->type == WPLDictionary, NULL);
+	wassertrv(!dest->immutable, NULL);
 
 	if (source == dest)
 		return dest;
@@ -1186,7 +1554,10 @@ WMPropList *WMMergePLDictionaries(WMPropList * dest, WMPropList * source, Bool r
 	while (WMNextHashEnumeratorItemAndKey(&e, (void **)&value, (void **)&key)) {
 		if (recursive && value->type == WPLDictionary) {
 			dvalue = WMHashGet(dest->d.dict, key);
-			if (dvalue && dvalue->type == WPLDictionary) {
+			if (dvalue && dvalue->type == WPLDictionary && dvalue->immutable) {
+				dvalue = mutableCopyInDictionary(dest, key, dvalue);
+				WMMergePLDictionaries(dvalue, value, True);
+			} else if (dvalue && dvalue->type == WPLDictionary) {
 				WMMergePLDictionaries(dvalue, value, True);
 			} else {
 				WMPutInPLDictionary(dest, key, value);
@@ -1205,6 +1576,7 @@ WMPropList *WMSubtractPLDictionaries(WMPropList * dest, WMPropList * source, Boo
 	WMHashEnumerator e;
 
 	wassertrv(source->type == WPLDictionary && dest->type == WPLDictionary, NULL);
+	wassertrv(!dest->immutable, NULL);
 
 	if (source == dest) {
 		WMPropList *keys = WMGetPLDictionaryKeys(dest);
@@ -1225,6 +1597,8 @@ WMPropList *WMSubtractPLDictionaries(WMPropList * dest, WMPropList * source, Boo
 		if (WMIsPropListEqualTo(value, dvalue)) {
 			WMRemoveFromPLDictionary(dest, key);
 		} else if (recursive && value->type == WPLDictionary && dvalue->type == WPLDictionary) {
+			if (dvalue->immutable)
+				dvalue = mutableCopyInDictionary(dest, key, dvalue);
 			WMSubtractPLDictionaries(dvalue, value, True);
 		}
 	}
@@ -1277,6 +1651,11 @@ Bool WMIsPropListEqualTo(WMPropList * plist, WMPropList * other)
 	WMHashEnumerator enumerator;
 	int n, i;
 
+	if (plist == other)
+		return True;
+	if (plist->immutable && other->immutable && plist->hash != other->hash)
+		return False;
+
 	if (plist->type != other->type)
 		return False;
 
@@ -1368,7 +1747,7 @@ WMPropList *WMGetPLDictionaryKeys(WMPropList * plist)
 
 	wassertrv(plist->type == WPLDictionary, NULL);
 
-	array = (WMPropList *) wmalloc(sizeof(W_PropList));
+	array = allocPropList(0);
 	array->type = WPLArray;
 	array->d.array = WMCreateArray(WMCountHashTable(plist->d.dict));
 	array->retainCount = 1;
@@ -1399,7 +1778,7 @@ WMPropList *WMShallowCopyPropList(WMPropList * plist)
 		WMReleaseData(data);
 		break;
 	case WPLArray:
-		ret = (WMPropList *) wmalloc(sizeof(W_PropList));
+		ret = allocPropList(0);
 		ret->type = WPLArray;
 		ret->d.array = WMCreateArrayWithArray(plist->d.array);
 		ret->retainCount = 1;
@@ -1432,6 +1811,10 @@ WMPropList *WMDeepCopyPropList(WMPropList * plist)
 	WMData *data;
 	int i;
 
+	/* nobody can change them, so sharing them is as good as a copy */
+	if (plist->immutable)
+		return WMRetainPropList(plist);
+
 	switch (plist->type) {
 	case WPLString:
 		ret = WMCreatePLString(plist->d.string);
@@ -1468,19 +1851,27 @@ WMPropList *WMDeepCopyPropList(WMPropList * plist)
 	return ret;
 }
 
-WMPropList *WMCreatePropListFromDescription(const char *desc)
+/*
+ * Parses length bytes of text. filename is only used in the error messages,
+ * it is NULL when the text does not come from a file.
+ */
+static WMPropList *parsePropList(const char *text, int length, const char *filename)
 {
-	WMPropList *plist = NULL;
-	PLData *pldata;
+	WMPropList *plist, *string;
+	WMHashEnumerator e;
+	PLData pldata;
 
-	pldata = (PLData *) wmalloc(sizeof(PLData));
-	pldata->ptr = desc;
-	pldata->lineNumber = 1;
+	pldata.ptr = text;
+	pldata.pos = 0;
+	pldata.length = length;
+	pldata.filename = filename;
+	pldata.lineNumber = 1;
+	pldata.strings = WMCreateHashTable(WMStringPointerHashCallbacks);
 
-	plist = getPropList(pldata);
+	plist = getPropList(&pldata);
 
-	if (getNonSpaceChar(pldata) != 0 && plist) {
-		COMPLAIN(pldata, _("extra data after end of property list"));
+	if (getNonSpaceChar(&pldata) != 0 && plist) {
+		COMPLAIN(&pldata, _("extra data after end of property list"));
 		/*
 		 * We can't just ignore garbage after the end of the description
 		 * (especially if the description was read from a file), because
@@ -1491,73 +1882,103 @@ WMPropList *WMCreatePropListFromDescription(const char *desc)
 		plist = NULL;
 	}
 
-	wfree(pldata);
+	e = WMEnumerateHashTable(pldata.strings);
+	while ((string = WMNextHashEnumeratorItem(&e)))
+		WMReleasePropList(string);
+	WMFreeHashTable(pldata.strings);
 
 	return plist;
 }
 
+WMPropList *WMCreatePropListFromDescription(const char *desc)
+{
+	return parsePropList(desc, strlen(desc), NULL);
+}
+
 char *WMGetPropListDescription(WMPropList * plist, Bool indented)
 {
-	return (indented ? indentedDescription(plist, 0) : description(plist));
+	PLWriter writer;
+
+	initWriter(&writer, PLWriteMemory, -1, NULL, 0);
+	if (indented)
+		writeIndentedDescription(&writer, plist, 0);
+	else
+		writeDescription(&writer, plist);
+	putChar(&writer, 0);
+
+	return writer.buffer;
 }
 
 WMPropList *WMReadPropListFromFile(const char *file)
 {
 	WMPropList *plist = NULL;
-	PLData *pldata;
-	char *read_buf;
-	FILE *f;
+	char *read_buf = NULL;
 	struct stat stbuf;
-	size_t length;
+	size_t length, done;
+	ssize_t count;
+	int fd;
 
-	f = fopen(file, "rb");
-	if (!f) {
+	fd = open(file, O_RDONLY);
+	if (fd < 0) {
 		/* let the user print the error message if he really needs to */
 		/*werror(_("could not open domain file '%s' for reading"), file); */
 		return NULL;
 	}
 
-	if (stat(file, &stbuf) == 0) {
+	if (fstat(fd, &stbuf) == 0) {
 		length = (size_t) stbuf.st_size;
 	} else {
 		werror(_("could not get size for file '%s'"), file);
-		fclose(f);
+		close(fd);
 		return NULL;
 	}
 
-	read_buf = wmalloc(length + 1);
-	if (fread(read_buf, length, 1, f) != 1) {
-		if (ferror(f)) {
-			werror(_("error reading from file '%s'"), file);
-		}
-		fclose(f);
-		wfree(read_buf);
+	if (length == 0) {
+		close(fd);
 		return NULL;
 	}
-	read_buf[length] = '\0';
-	fclose(f);
 
-	pldata = (PLData *) wmalloc(sizeof(PLData));
-	pldata->ptr = read_buf;
-	pldata->filename = file;
-	pldata->lineNumber = 1;
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+	/*
+	 * Big domain files are parsed straight from the page cache. The files
+	 * we write are replaced with rename(), so they are not truncated while
+	 * they are mapped.
+	 */
+	if (length >= MMAP_THRESHOLD) {
+		void *map;
+
+		map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED) {
+			close(fd);
+#ifdef MADV_SEQUENTIAL
+			(void) madvise(map, length, MADV_SEQUENTIAL);
+#endif
+			plist = parsePropList(map, length, file);
+			munmap(map, length);
 
-	plist = getPropList(pldata);
+			return plist;
+		}
+	}
+#endif
 
-	if (getNonSpaceChar(pldata) != 0 && plist) {
-		COMPLAIN(pldata, _("extra data after end of property list"));
-		/*
-		 * We can't just ignore garbage after the end of the description
-		 * (especially if the description was read from a file), because
-		 * the "garbage" can be the real data and the real garbage is in
-		 * fact in the beginning of the file (which is now inside plist)
-		 */
-		WMReleasePropList(plist);
-		plist = NULL;
+	read_buf = wmalloc(length);
+	for (done = 0; done < length; done += count) {
+		count = read(fd, read_buf + done, length - done);
+		if (count < 0 && errno == EINTR) {
+			count = 0;
+		} else if (count <= 0) {
+			if (count < 0)
+				werror(_("error reading from file '%s'"), file);
+			close(fd);
+			wfree(read_buf);
+			return NULL;
+		}
 	}
+	close(fd);
+
+	plist = parsePropList(read_buf, length, file);
 
 	wfree(read_buf);
-	wfree(pldata);
 
 	return plist;
 }
@@ -1566,7 +1987,6 @@ WMPropList *WMReadPropListFromPipe(const char *command)
 {
 	FILE *file;
 	WMPropList *plist;
-	PLData *pldata;
 	char *read_buf, *read_ptr;
 	size_t remain_size, line_size;
 	const size_t block_read_size = 4096;
@@ -1601,49 +2021,29 @@ WMPropList *WMReadPropListFromPipe(const char *command)
 
 	pclose(file);
 
-	pldata = (PLData *) wmalloc(sizeof(PLData));
-	pldata->ptr = read_buf;
-	pldata->filename = command;
-	pldata->lineNumber = 1;
-
-	plist = getPropList(pldata);
-
-	if (getNonSpaceChar(pldata) != 0 && plist) {
-		COMPLAIN(pldata, _("extra data after end of property list"));
-		/*
-		 * We can't just ignore garbage after the end of the description
-		 * (especially if the description was read from a file), because
-		 * the "garbage" can be the real data and the real garbage is in
-		 * fact in the beginning of the file (which is now inside plist)
-		 */
-		WMReleasePropList(plist);
-		plist = NULL;
-	}
+	plist = parsePropList(read_buf, read_ptr - read_buf, command);
 
 	wfree(read_buf);
-	wfree(pldata);
 
 	return plist;
 }
 
-/* TODO: review this function's code */
-
-Bool WMWritePropListToFile(WMPropList * plist, const char *path)
+/*
+ * Creates a temporary file next to path, so that it can later be renamed
+ * over it. Returns the file descriptor, or -1 after printing an error
+ * unless quiet is set.
+ */
+static int createTempFile(const char *path, char **thePath, Bool quiet)
 {
-	char *thePath = NULL;
-	char *desc;
-	FILE *theFile;
+	int fd;
 #ifdef	HAVE_MKSTEMP
-	int fd, mask;
+	int mask;
 #endif
 
-	if (!wmkdirhier(path))
-		return False;
-
 	/* Use the path name of the destination file as a prefix for the
 	 * mkstemp() call so that we can be sure that both files are on
 	 * the same filesystem and the subsequent rename() will work. */
-	thePath = wstrconcat(path, ".XXXXXX");
+	*thePath = wstrconcat(path, ".XXXXXX");
 
 #ifdef  HAVE_MKSTEMP
 	/*
@@ -1656,61 +2056,657 @@ Bool WMWritePropListToFile(WMPropList * plist, const char *path)
 	 * complain, even if we do not really care in the present use case.
 	 */
 	mask = umask(S_IRWXG | S_IRWXO);
-	if ((fd = mkstemp(thePath)) < 0) {
-		werror(_("mkstemp (%s) failed"), thePath);
-		goto failure;
-	}
+	fd = mkstemp(*thePath);
 	umask(mask);
+	if (fd < 0) {
+		if (!quiet)
+			werror(_("mkstemp (%s) failed"), *thePath);
+		return -1;
+	}
 	fchmod(fd, 0666 & ~mask);
-	if ((theFile = fdopen(fd, "wb")) == NULL) {
-		close(fd);
+#else
+	if (mktemp(*thePath) == NULL) {
+		if (!quiet)
+			werror(_("mktemp (%s) failed"), *thePath);
+		return -1;
+	}
+	fd = open(*thePath, O_WRONLY | O_CREAT | O_EXCL, 0666);
+	if (fd < 0 && !quiet)
+		werror(_("open (%s) failed"), *thePath);
+#endif
+
+	return fd;
+}
+
+/*
+ * Makes the temporary file written through fd become path. The file is
+ * synced first, so that path always has either its old or its new
+ * contents, even after a crash. The errors are printed unless quiet is set.
+ */
+static Bool replaceWithTempFile(int fd, const char *thePath, const char *path, Bool quiet)
+{
+	(void)fsync(fd);
+	if (close(fd) != 0) {
+		if (!quiet)
+			werror(_("close (%s) failed"), thePath);
+		return False;
 	}
+
+	/* If we used a temporary file, we still need to rename() it be the
+	 * real file.  Also, we need to try to retain the file attributes of
+	 * the original file we are overwriting (if we are) */
+	if (rename(thePath, path) != 0) {
+		if (!quiet)
+			werror(_("rename ('%s' to '%s') failed"), thePath, path);
+		return False;
+	}
+
+	return True;
+}
+
+/*
+ * Compiled property lists
+ *
+ * A compiled file holds a property list in a binary form that can be
+ * loaded without any parsing, together with the identity (mtime to the
+ * nanosecond where available, size and inode) of the text files it was
+ * built from. The text files stay the
+ * authoritative copy: the compiled file is only used while all of them
+ * are unchanged, so it can be thrown away at any time.
+ *
+ * Layout, in the byte order of the machine that wrote it:
+ *
+ *   header        CompiledHeader
+ *   sources       sourceCount x (CompiledSource + path, padded to 4 bytes)
+ *   strings       stringCount x (uint32 length + bytes + NUL, padded)
+ *   nodes         nodeWords x uint32, the tree in pre-order
+ *
+ * A node word is (payload << 2 | kind). Strings are stored once and
+ * referenced by index, data is followed by its padded bytes, arrays and
+ * dictionaries by their elements (key, value pairs for dictionaries).
+ */
+
+#define COMPILED_MAGIC		"WMPLBIN2"
+#define COMPILED_BYTE_ORDER	0x01020304
+
+#define COMPILED_STRING		0
+#define COMPILED_DATA		1
+#define COMPILED_ARRAY		2
+#define COMPILED_DICTIONARY	3
+
+#define COMPILED_MAX_PAYLOAD	0x3fffffff
+#define COMPILED_MAX_DEPTH	512
+
+#define PAD4(len) (((len) + 3) & ~3)
+
+/* a file can be written twice within a second */
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+#define MTIME_NSEC(stbuf) ((int64_t) (stbuf).st_mtim.tv_nsec)
 #else
-	if (mktemp(thePath) == NULL) {
-		werror(_("mktemp (%s) failed"), thePath);
-		goto failure;
+#define MTIME_NSEC(stbuf) ((int64_t) 0)
+#endif
+
+typedef struct CompiledHeader {
+	char magic[8];
+	uint32_t byteOrder;
+	uint32_t sourceCount;
+	uint32_t stringCount;
+	uint32_t nodeWords;
+	uint32_t payloadSize;	/* bytes following the header */
+	uint32_t checksum;	/* FNV-1a of the payload */
+} CompiledHeader;
+
+typedef struct CompiledSource {
+	int64_t mtime;
+	int64_t mtimeNsec;
+	int64_t size;
+	uint64_t inode;
+	uint32_t exists;
+	uint32_t pathLength;
+} CompiledSource;
+
+typedef struct CompiledReader {
+	const uint32_t *nodes;
+	uint32_t nodeWords;
+	uint32_t next;
+
+	const char **strings;	/* NUL terminated, inside the file */
+	uint32_t *stringLengths;
+	WMPropList **stringNodes;	/* created on first use */
+	uint32_t stringCount;
+} CompiledReader;
+
+typedef struct CompiledWriter {
+	uint32_t *nodes;
+	uint32_t nodeWords;
+	uint32_t nodeSize;
+
+	WMHashTable *strings;	/* string -> index + 1 */
+	WMArray *stringOrder;
+	size_t stringBytes;
+} CompiledWriter;
+
+static uint32_t checksumBytes(const unsigned char *bytes, size_t length)
+{
+	uint32_t hash = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		hash ^= bytes[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+static Bool sourceIsUnchanged(const CompiledSource *source, const char *path)
+{
+	struct stat stbuf;
+
+	if (stat(path, &stbuf) < 0)
+		return (!source->exists && errno == ENOENT);
+
+	return (source->exists &&
+		source->mtime == (int64_t) stbuf.st_mtime &&
+		source->mtimeNsec == MTIME_NSEC(stbuf) &&
+		source->size == (int64_t) stbuf.st_size &&
+		source->inode == (uint64_t) stbuf.st_ino);
+}
+
+static WMPropList *getCompiledNode(CompiledReader *reader, int depth)
+{
+	WMPropList *plist, *key, *value;
+	uint32_t word, payload, i;
+
+	if (reader->next >= reader->nodeWords || depth > COMPILED_MAX_DEPTH)
+		return NULL;
+
+	word = reader->nodes[reader->next++];
+	payload = word >> 2;
+
+	switch (word & 3) {
+	case COMPILED_STRING:
+		if (payload >= reader->stringCount)
+			return NULL;
+		plist = reader->stringNodes[payload];
+		if (!plist) {
+			uint32_t len = reader->stringLengths[payload];
+
+			plist = allocPropList(len + 1);
+			plist->type = WPLString;
+			plist->d.string = (char *)(plist + 1);
+			plist->retainCount = 1;
+			memcpy(plist->d.string, reader->strings[payload], len + 1);
+
+			/* the reader keeps its own reference until the end */
+			reader->stringNodes[payload] = plist;
+		}
+		return WMRetainPropList(plist);
+
+	case COMPILED_DATA:
+		if (PAD4(payload) / 4 > reader->nodeWords - reader->next)
+			return NULL;
+		plist = WMCreatePLDataWithBytes((const unsigned char *)(reader->nodes + reader->next), payload);
+		reader->next += PAD4(payload) / 4;
+		return plist;
+
+	case COMPILED_ARRAY:
+		/* every element takes at least one word */
+		if (payload > reader->nodeWords - reader->next)
+			return NULL;
+		plist = WMCreatePLArray(NULL);
+		for (i = 0; i < payload; i++) {
+			value = getCompiledNode(reader, depth + 1);
+			if (!value) {
+				WMReleasePropList(plist);
+				return NULL;
+			}
+			WMAddToArray(plist->d.array, value);
+		}
+		return plist;
+
+	default:
+		if (payload > (reader->nodeWords - reader->next) / 2)
+			return NULL;
+		plist = WMCreatePLDictionary(NULL, NULL);
+		for (i = 0; i < payload; i++) {
+			key = getCompiledNode(reader, depth + 1);
+			if (!key || key->type != WPLString) {
+				if (key)
+					WMReleasePropList(key);
+				WMReleasePropList(plist);
+				return NULL;
+			}
+			value = getCompiledNode(reader, depth + 1);
+			if (!value) {
+				WMReleasePropList(key);
+				WMReleasePropList(plist);
+				return NULL;
+			}
+			WMRemoveFromPLDictionary(plist, key);
+			WMHashInsert(plist->d.dict, key, value);
+		}
+		return plist;
+	}
+}
+
+/*
+ * Checks and decodes a compiled file image. Returns NULL if the image is
+ * damaged or if any of the sources changed since it was written.
+ */
+static WMPropList *loadCompiledPropList(const unsigned char *image, size_t length, const char **sources)
+{
+	const CompiledHeader *header = (const CompiledHeader *)image;
+	const unsigned char *ptr, *end;
+	CompiledReader reader;
+	WMPropList *plist = NULL;
+	uint32_t i;
+
+	if (length < sizeof(CompiledHeader) ||
+	    memcmp(header->magic, COMPILED_MAGIC, sizeof(header->magic)) != 0 ||
+	    header->byteOrder != COMPILED_BYTE_ORDER ||
+	    header->payloadSize != length - sizeof(CompiledHeader))
+		return NULL;
+
+	ptr = image + sizeof(CompiledHeader);
+	end = image + length;
+
+	/* sources must match, in number and in order */
+	for (i = 0; i < header->sourceCount; i++) {
+		CompiledSource source;
+
+		if (end - ptr < sizeof(source) || sources == NULL || sources[i] == NULL)
+			return NULL;
+		memcpy(&source, ptr, sizeof(source));
+		ptr += sizeof(source);
+
+		if (end - ptr < PAD4((size_t) source.pathLength) ||
+		    strlen(sources[i]) != source.pathLength ||
+		    memcmp(ptr, sources[i], source.pathLength) != 0 ||
+		    !sourceIsUnchanged(&source, sources[i]))
+			return NULL;
+		ptr += PAD4((size_t) source.pathLength);
+	}
+	if (sources && sources[i] != NULL)
+		return NULL;
+
+	if (checksumBytes(image + sizeof(CompiledHeader), header->payloadSize) != header->checksum)
+		return NULL;
+
+	if (header->stringCount > (end - ptr) / 8)
+		return NULL;
+
+	reader.stringCount = header->stringCount;
+	reader.strings = wmalloc(sizeof(char *) * (reader.stringCount + 1));
+	reader.stringLengths = wmalloc(sizeof(uint32_t) * (reader.stringCount + 1));
+	reader.stringNodes = wmalloc(sizeof(WMPropList *) * (reader.stringCount + 1));
+
+	for (i = 0; i < reader.stringCount; i++) {
+		uint32_t len;
+
+		if (end - ptr < sizeof(len))
+			goto out;
+		memcpy(&len, ptr, sizeof(len));
+		ptr += sizeof(len);
+		if (len > COMPILED_MAX_PAYLOAD || end - ptr < PAD4((size_t) len + 1) || ptr[len] != 0)
+			goto out;
+		reader.strings[i] = (const char *)ptr;
+		reader.stringLengths[i] = len;
+		ptr += PAD4((size_t) len + 1);
+	}
+
+	if ((size_t)(end - ptr) != (size_t) header->nodeWords * 4)
+		goto out;
+
+	reader.nodes = (const uint32_t *)ptr;
+	reader.nodeWords = header->nodeWords;
+	reader.next = 0;
+
+	plist = getCompiledNode(&reader, 0);
+	if (plist && reader.next != reader.nodeWords) {
+		WMReleasePropList(plist);
+		plist = NULL;
+	}
+
+ out:
+	for (i = 0; i < reader.stringCount; i++) {
+		if (reader.stringNodes[i])
+			WMReleasePropList(reader.stringNodes[i]);
+	}
+	wfree(reader.stringNodes);
+	wfree(reader.stringLengths);
+	wfree(reader.strings);
+
+	return plist;
+}
+
+/*
+ * Reads a property list written by WMWritePropListToCompiledFile().
+ * sources is the NULL terminated list of files the property list was
+ * built from; NULL is returned if it does not match the one given when
+ * the file was written, if any of the files changed since then, or if
+ * the compiled file does not exist or is damaged.
+ */
+WMPropList *WMReadPropListFromCompiledFile(const char *path, const char **sources)
+{
+	WMPropList *plist = NULL;
+	unsigned char *image;
+	struct stat stbuf;
+	size_t length, done;
+	ssize_t count;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &stbuf) < 0 || stbuf.st_size < sizeof(CompiledHeader) ||
+	    stbuf.st_size > COMPILED_MAX_PAYLOAD) {
+		close(fd);
+		return NULL;
+	}
+	length = (size_t) stbuf.st_size;
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+	image = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (image != MAP_FAILED) {
+		close(fd);
+		plist = loadCompiledPropList(image, length, sources);
+		munmap(image, length);
+
+		return plist;
 	}
-	theFile = fopen(thePath, "wb");
 #endif
 
-	if (theFile == NULL) {
-		werror(_("open (%s) failed"), thePath);
-		goto failure;
+	/* the image must be aligned for the node words, which wmalloc() is */
+	image = wmalloc(length);
+	for (done = 0; done < length; done += count) {
+		count = read(fd, image + done, length - done);
+		if (count < 0 && errno == EINTR) {
+			count = 0;
+		} else if (count <= 0) {
+			close(fd);
+			wfree(image);
+			return NULL;
+		}
 	}
+	close(fd);
 
-	desc = indentedDescription(plist, 0);
+	plist = loadCompiledPropList(image, length, sources);
 
-	if (fprintf(theFile, "%s\n", desc) != strlen(desc) + 1) {
-		werror(_("writing to file: %s failed"), thePath);
-		wfree(desc);
-		goto failure;
+	wfree(image);
+
+	return plist;
+}
+
+static void putCompiledWord(CompiledWriter *writer, uint32_t word)
+{
+	if (writer->nodeWords == writer->nodeSize) {
+		writer->nodeSize = writer->nodeSize * 2 + 256;
+		writer->nodes = wrealloc(writer->nodes, writer->nodeSize * sizeof(uint32_t));
 	}
+	writer->nodes[writer->nodeWords++] = word;
+}
 
-	wfree(desc);
+static Bool putCompiledNode(CompiledWriter *writer, WMPropList *plist)
+{
+	WMHashEnumerator e;
+	WMPropList *key, *value;
+	uintptr_t index;
+	int i, count;
 
-	(void)fsync(fileno(theFile));
-	if (fclose(theFile) != 0) {
-		werror(_("fclose (%s) failed"), thePath);
-		goto failure;
+	switch (plist->type) {
+	case WPLString:
+		index = (uintptr_t) WMHashGet(writer->strings, plist->d.string);
+		if (index == 0) {
+			index = WMGetArrayItemCount(writer->stringOrder) + 1;
+			if (index > COMPILED_MAX_PAYLOAD || strlen(plist->d.string) > COMPILED_MAX_PAYLOAD)
+				return False;
+			WMAddToArray(writer->stringOrder, plist->d.string);
+			WMHashInsert(writer->strings, plist->d.string, (void *)index);
+			writer->stringBytes += sizeof(uint32_t) + PAD4(strlen(plist->d.string) + 1);
+		}
+		putCompiledWord(writer, (uint32_t)((index - 1) << 2) | COMPILED_STRING);
+		return True;
+
+	case WPLData:
+		{
+			const unsigned char *bytes = WMDataBytes(plist->d.data);
+			unsigned len = WMGetDataLength(plist->d.data);
+			uint32_t word;
+
+			if (len > COMPILED_MAX_PAYLOAD)
+				return False;
+			putCompiledWord(writer, (len << 2) | COMPILED_DATA);
+			for (i = 0; i < len; i += 4) {
+				word = 0;
+				memcpy(&word, bytes + i, (len - i < 4) ? len - i : 4);
+				putCompiledWord(writer, word);
+			}
+		}
+		return True;
+
+	case WPLArray:
+		count = WMGetArrayItemCount(plist->d.array);
+		putCompiledWord(writer, ((uint32_t) count << 2) | COMPILED_ARRAY);
+		for (i = 0; i < count; i++) {
+			if (!putCompiledNode(writer, WMGetFromArray(plist->d.array, i)))
+				return False;
+		}
+		return True;
+
+	case WPLDictionary:
+		count = WMCountHashTable(plist->d.dict);
+		putCompiledWord(writer, ((uint32_t) count << 2) | COMPILED_DICTIONARY);
+		e = WMEnumerateHashTable(plist->d.dict);
+		while (WMNextHashEnumeratorItemAndKey(&e, (void **)&value, (void **)&key)) {
+			if (!putCompiledNode(writer, key) || !putCompiledNode(writer, value))
+				return False;
+		}
+		return True;
+
+	default:
+		wwarning(_("Used proplist functions on non-WMPropLists objects"));
+		wassertrv(False, False);
+		break;
 	}
 
-	/* If we used a temporary file, we still need to rename() it be the
-	 * real file.  Also, we need to try to retain the file attributes of
-	 * the original file we are overwriting (if we are) */
-	if (rename(thePath, path) != 0) {
-		werror(_("rename ('%s' to '%s') failed"), thePath, path);
+	return False;
+}
+
+static Bool writeAll(int fd, const void *bytes, size_t length)
+{
+	const char *ptr = bytes;
+	ssize_t count;
+
+	while (length > 0) {
+		count = write(fd, ptr, length);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0)
+			return False;
+		ptr += count;
+		length -= count;
+	}
+
+	return True;
+}
+
+/*
+ * Writes plist in compiled form to path, recording the current state of
+ * the NULL terminated list of sources, which are the files the property
+ * list was built from. Sources that do not exist are recorded as such.
+ * The file is replaced atomically.
+ */
+Bool WMWritePropListToCompiledFile(WMPropList *plist, const char *path, const char **sources)
+{
+	CompiledWriter writer;
+	CompiledHeader header;
+	unsigned char *image, *ptr;
+	size_t sourceBytes, length;
+	char *thePath;
+	Bool ok = False;
+	int i, sourceCount, fd;
+
+	memset(&writer, 0, sizeof(writer));
+	writer.strings = WMCreateHashTable(WMStringPointerHashCallbacks);
+	writer.stringOrder = WMCreateArray(64);
+
+	if (!putCompiledNode(&writer, plist) || writer.nodeWords > COMPILED_MAX_PAYLOAD / 4) {
+		wwarning(_("property list is too big to be compiled into %s"), path);
+		goto out;
+	}
+
+	sourceBytes = 0;
+	for (sourceCount = 0; sources && sources[sourceCount]; sourceCount++)
+		sourceBytes += sizeof(CompiledSource) + PAD4(strlen(sources[sourceCount]));
+
+	length = sizeof(CompiledHeader) + sourceBytes + writer.stringBytes + writer.nodeWords * sizeof(uint32_t);
+	image = wmalloc(length);
+
+	ptr = image + sizeof(CompiledHeader);
+	for (i = 0; i < sourceCount; i++) {
+		CompiledSource source;
+		struct stat stbuf;
+
+		memset(&source, 0, sizeof(source));
+		if (stat(sources[i], &stbuf) == 0) {
+			source.exists = 1;
+			source.mtime = stbuf.st_mtime;
+			source.mtimeNsec = MTIME_NSEC(stbuf);
+			source.size = stbuf.st_size;
+			source.inode = stbuf.st_ino;
+		}
+		source.pathLength = strlen(sources[i]);
+		memcpy(ptr, &source, sizeof(source));
+		ptr += sizeof(source);
+		memcpy(ptr, sources[i], source.pathLength);
+		ptr += PAD4((size_t) source.pathLength);
+	}
+
+	for (i = 0; i < WMGetArrayItemCount(writer.stringOrder); i++) {
+		const char *str = WMGetFromArray(writer.stringOrder, i);
+		uint32_t len = strlen(str);
+
+		memcpy(ptr, &len, sizeof(len));
+		ptr += sizeof(len);
+		memcpy(ptr, str, len);
+		ptr += PAD4((size_t) len + 1);
+	}
+
+	memcpy(ptr, writer.nodes, writer.nodeWords * sizeof(uint32_t));
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, COMPILED_MAGIC, sizeof(header.magic));
+	header.byteOrder = COMPILED_BYTE_ORDER;
+	header.sourceCount = sourceCount;
+	header.stringCount = WMGetArrayItemCount(writer.stringOrder);
+	header.nodeWords = writer.nodeWords;
+	header.payloadSize = length - sizeof(CompiledHeader);
+	header.checksum = checksumBytes(image + sizeof(CompiledHeader), header.payloadSize);
+	memcpy(image, &header, sizeof(header));
+
+	/* the compiled file is only a shortcut, the text is read when it is missing */
+	fd = createTempFile(path, &thePath, True);
+	if (fd >= 0) {
+		if (!writeAll(fd, image, length))
+			close(fd);
+		else
+			ok = replaceWithTempFile(fd, thePath, path, True);
+		if (!ok)
+			unlink(thePath);
+	}
+	wfree(thePath);
+	wfree(image);
+
+ out:
+	WMFreeArray(writer.stringOrder);
+	WMFreeHashTable(writer.strings);
+	if (writer.nodes)
+		wfree(writer.nodes);
+
+	return ok;
+}
+
+/* checks if path already holds what we would write for plist */
+static Bool propListMatchesFile(WMPropList * plist, const char *path)
+{
+	char buffer[BUFFERSIZE];
+	PLWriter writer;
+	Bool match;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return False;
+
+	initWriter(&writer, PLWriteCompare, fd, buffer, sizeof(buffer));
+	writeIndentedDescription(&writer, plist, 0);
+	putChar(&writer, '\n');
+	match = writerAtEnd(&writer);
+
+	close(fd);
+
+	return match;
+}
+
+static Bool writePropListToFile(WMPropList * plist, const char *path, Bool onlyIfChanged)
+{
+	char buffer[BUFFERSIZE];
+	char *thePath = NULL;
+	PLWriter writer;
+	int fd;
+
+	if (!wmkdirhier(path))
+		return False;
+
+	if (onlyIfChanged && propListMatchesFile(plist, path))
+		return True;
+
+	fd = createTempFile(path, &thePath, False);
+	if (fd < 0)
+		goto failure;
+
+	/* the description is streamed out, it is never kept in memory */
+	initWriter(&writer, PLWriteFile, fd, buffer, sizeof(buffer));
+	writeIndentedDescription(&writer, plist, 0);
+	putChar(&writer, '\n');
+
+	if (!flushWriter(&writer)) {
+		werror(_("writing to file: %s failed"), thePath);
+		close(fd);
 		goto failure;
 	}
 
+	if (!replaceWithTempFile(fd, thePath, path, False))
+		goto failure;
+
 	wfree(thePath);
 	return True;
 
  failure:
-	unlink(thePath);
-	wfree(thePath);
+	if (thePath) {
+		unlink(thePath);
+		wfree(thePath);
+	}
 	return False;
 }
 
+Bool WMWritePropListToFile(WMPropList * plist, const char *path)
+{
+	return writePropListToFile(plist, path, False);
+}
+
+/*
+ * Same as WMWritePropListToFile(), but leaves the file alone if it already
+ * has the same contents, so that its modification time does not change
+ * and whoever watches it is not woken up for nothing.
+ */
+Bool WMWritePropListToFileIfChanged(WMPropList * plist, const char *path)
+{
+	return writePropListToFile(plist, path, True);
+}
+
 /*
  * create a directory hierarchy
  *
@@ -8,6 +8,7 @@
 
 #include "wconfig.h"
 
+#include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -240,6 +241,66 @@ char *wstrappend(char *dst, const char *src)
 	return dst;
 }
 
+/*
+ * Interned strings have a single, reference counted copy per contents,
+ * so two of them are equal exactly when their addresses are.
+ */
+typedef struct InternedString {
+	unsigned refCount;
+	char string[1];
+} InternedString;
+
+#define INTERNED(str) ((InternedString *) ((str) - offsetof(InternedString, string)))
+
+static WMHashTable *internTable = NULL;
+
+const char *WMInternString(const char *str)
+{
+	InternedString *entry;
+	size_t len;
+
+	if (!str)
+		return NULL;
+
+	if (!internTable)
+		internTable = WMCreateHashTable(WMStringPointerHashCallbacks);
+
+	entry = WMHashGet(internTable, str);
+	if (!entry) {
+		len = strlen(str);
+		entry = wmalloc(sizeof(InternedString) + len);
+		memcpy(entry->string, str, len + 1);
+		WMHashInsert(internTable, entry->string, entry);
+	}
+	entry->refCount++;
+
+	return entry->string;
+}
+
+const char *WMRetainInternedString(const char *str)
+{
+	if (str)
+		INTERNED(str)->refCount++;
+
+	return str;
+}
+
+void WMReleaseInternedString(const char *str)
+{
+	InternedString *entry;
+
+	if (!str)
+		return;
+
+	entry = INTERNED(str);
+	wassertr(entry->refCount > 0);
+
+	if (--entry->refCount == 0) {
+		WMHashRemove(internTable, entry->string);
+		wfree(entry);
+	}
+}
+
 
 #ifdef HAVE_STRLCAT
 size_t
@@ -7,6 +7,7 @@ typedef struct W_Browser {
 	W_View *view;
 
 	char **titles;
+	WMTruncationCache *titleCaches;	/* titles truncated to the column width */
 	WMList **columns;
 
 	short columnCount;
@@ -75,7 +76,6 @@ static void loadColumn(WMBrowser * bPtr, int column);
 
 static void removeColumn(WMBrowser * bPtr, int column);
 
-static char *createTruncatedString(WMFont * font, const char *text, int *textLen, int width);
 
 static void willResizeBrowser(W_ViewDelegate *, WMView *, unsigned int *, unsigned int *);
 
@@ -239,24 +239,14 @@ static void drawTitleOfColumn(WMBrowser * bPtr, int column)
 	W_DrawRelief(scr, bPtr->view->window, x, 0, bPtr->columnSize.width, bPtr->titleHeight, WRSunken);
 
 	if (column < bPtr->usedColumnCount && bPtr->titles[column]) {
-		int titleLen = strlen(bPtr->titles[column]);
-		int widthC = bPtr->columnSize.width - 8;
-
-		if (WMWidthOfString(scr->boldFont, bPtr->titles[column], titleLen)
-		    > widthC) {
-			char *titleBuf = createTruncatedString(scr->boldFont,
-							       bPtr->titles[column],
-							       &titleLen, widthC);
-			W_PaintText(bPtr->view, bPtr->view->window, scr->boldFont, x,
-				    (bPtr->titleHeight - WMFontHeight(scr->boldFont)) / 2,
-				    bPtr->columnSize.width, WACenter, scr->white, False, titleBuf, titleLen);
-			wfree(titleBuf);
-		} else {
-			W_PaintText(bPtr->view, bPtr->view->window, scr->boldFont, x,
-				    (bPtr->titleHeight - WMFontHeight(scr->boldFont)) / 2,
-				    bPtr->columnSize.width, WACenter, scr->white,
-				    False, bPtr->titles[column], titleLen);
-		}
+		char *titleBuf = WMTruncateString(scr->boldFont, bPtr->titles[column],
+						  bPtr->columnSize.width - 8, WTTruncateTail,
+						  &bPtr->titleCaches[column]);
+
+		W_PaintText(bPtr->view, bPtr->view->window, scr->boldFont, x,
+			    (bPtr->titleHeight - WMFontHeight(scr->boldFont)) / 2,
+			    bPtr->columnSize.width, WACenter, scr->white, False, titleBuf, strlen(titleBuf));
+		wfree(titleBuf);
 	}
 }
 
@@ -314,6 +304,7 @@ static void removeColumn(WMBrowser * bPtr, int column)
 			wfree(bPtr->titles[i]);
 			bPtr->titles[i] = NULL;
 		}
+		WMFreeTruncationCache(&bPtr->titleCaches[i]);
 		WMRemoveNotificationObserverWithName(bPtr, WMListSelectionDidChangeNotification, bPtr->columns[i]);
 		WMDestroyWidget(bPtr->columns[i]);
 		bPtr->columns[i] = NULL;
@@ -326,6 +317,7 @@ static void removeColumn(WMBrowser * bPtr, int column)
 	wfree(bPtr->columns);
 	bPtr->titles = tlist;
 	bPtr->columns = clist;
+	bPtr->titleCaches = wrealloc(bPtr->titleCaches, sizeof(WMTruncationCache) * (bPtr->columnCount));
 }
 
 WMListItem *WMGetBrowserSelectedItemInColumn(WMBrowser * bPtr, int column)
@@ -495,8 +487,8 @@ static void paintItem(WMList * lPtr, int index, Drawable d, char *text, int stat
 		widthC = (state & WLDSIsBranch) ? width - 20 : width - 8;
 		textLen = strlen(text);
 		if (WMWidthOfString(font, text, textLen) > widthC) {
-			char *textBuf = createTruncatedString(font, text, &textLen, widthC);
-			W_PaintText(view, d, font, x + 4, y, widthC, WALeft, scr->black, False, textBuf, textLen);
+			char *textBuf = WMTruncateString(font, text, widthC, WTTruncateTail, NULL);
+			W_PaintText(view, d, font, x + 4, y, widthC, WALeft, scr->black, False, textBuf, strlen(textBuf));
 			wfree(textBuf);
 		} else {
 			W_PaintText(view, d, font, x + 4, y, widthC, WALeft, scr->black, False, text, textLen);
@@ -1069,8 +1061,10 @@ int WMAddBrowserColumn(WMBrowser * bPtr)
 		wfree(bPtr->titles);
 	bPtr->columns = clist;
 	bPtr->titles = tlist;
+	bPtr->titleCaches = wrealloc(bPtr->titleCaches, sizeof(WMTruncationCache) * bPtr->columnCount);
 
 	bPtr->titles[index] = NULL;
+	memset(&bPtr->titleCaches[index], 0, sizeof(WMTruncationCache));
 
 	list = WMCreateList(bPtr);
 	WMSetListAllowMultipleSelection(list, bPtr->flags.allowMultipleSelection);
@@ -1106,8 +1100,11 @@ static void destroyBrowser(WMBrowser * bPtr)
 	for (i = 0; i < bPtr->columnCount; i++) {
 		if (bPtr->titles[i])
 			wfree(bPtr->titles[i]);
+		WMFreeTruncationCache(&bPtr->titleCaches[i]);
 	}
 	wfree(bPtr->titles);
+	if (bPtr->titleCaches)
+		wfree(bPtr->titleCaches);
 
 	wfree(bPtr->pathSeparator);
 
@@ -1115,51 +1112,3 @@ static void destroyBrowser(WMBrowser * bPtr)
 
 	wfree(bPtr);
 }
-
-static char *createTruncatedString(WMFont * font, const char *text, int *textLen, int width)
-{
-	size_t slen;
-	int dLen;
-	char *textBuf;
-
-	dLen = WMWidthOfString(font, ".", 1);
-	slen = *textLen + 4;
-	textBuf = wmalloc(slen);
-
-	if (width >= 3 * dLen) {
-		int tmpTextLen = *textLen;
-
-		if (wstrlcpy(textBuf, text, slen) >= slen)
-			goto error;
-
-		while (tmpTextLen && (WMWidthOfString(font, textBuf, tmpTextLen) + 3 * dLen > width))
-			tmpTextLen--;
-
-		if (wstrlcpy(textBuf + tmpTextLen, "...", slen) >= slen)
-			goto error;
-
-		*textLen = tmpTextLen + 3;
-
-	} else if (width >= 2 * dLen) {
-		if (wstrlcpy(textBuf, "..", slen) >= slen)
-			goto error;
-
-		*textLen = 2;
-
-	} else if (width >= dLen) {
-		if (wstrlcpy(textBuf, ".", slen) >= slen)
-			goto error;
-
-		*textLen = 1;
-
-	} else {
-		*textBuf = '\0';
-		*textLen = 0;
-	}
-
-	return textBuf;
-
-error:
-	wfree(textBuf);
-	return NULL;
-}
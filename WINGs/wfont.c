@@ -1,5 +1,6 @@
 
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "wconfig.h"
 
@@ -210,6 +211,10 @@ void WMReleaseFont(WMFont * font)
 	font->refCount--;
 	if (font->refCount < 1) {
 		XftFontClose(font->screen->display, font->font);
+		if (font->advances)
+			wfree(font->advances);
+		if (font->wideAdvances)
+			WMFreeHashTable(font->wideAdvances);
 		if (font->name) {
 			WMHashRemove(font->screen->fontCache, font->name);
 			wfree(font->name);
@@ -283,13 +288,70 @@ WMFont *WMBoldSystemFontOfSize(WMScreen * scrPtr, int size)
 	return font;
 }
 
+#ifndef USE_PANGO
+/*
+ * The advances of the glyphs are cached in each font: in a table for
+ * ASCII and Latin-1, which is what most titles are made of, and in a hash
+ * for the other characters. Xft does no kerning or shaping, so the width
+ * of a string is the sum of the advances of its characters, which saves a
+ * trip through XftTextExtentsUtf8() for every measurement.
+ */
+static int getAdvance(WMFont * font, FcChar32 ch)
+{
+	Display *dpy = font->screen->display;
+	XGlyphInfo extents;
+	FT_UInt glyph;
+	void *data;
+
+	if (ch < 256) {
+		if (!font->advances)
+			font->advances = wmalloc(256 * sizeof(unsigned short));
+		else if (font->advances[ch])
+			return font->advances[ch] - 1;
+	} else if (font->wideAdvances) {
+		data = WMHashGet(font->wideAdvances, (void *)(uintptr_t) ch);
+		if (data)
+			return (int)(uintptr_t) data - 1;
+	}
+
+	glyph = XftCharIndex(dpy, font->font, ch);
+	XftGlyphExtents(dpy, font->font, &glyph, 1, &extents);
+
+	if (ch < 256) {
+		font->advances[ch] = extents.xOff + 1;
+	} else {
+		if (!font->wideAdvances)
+			font->wideAdvances = WMCreateHashTable(WMIntHashCallbacks);
+		WMHashInsert(font->wideAdvances, (void *)(uintptr_t) ch, (void *)(uintptr_t) (extents.xOff + 1));
+	}
+
+	return extents.xOff;
+}
+
+/* Returns the length of the next character, or 0 where Xft would stop */
+static int nextChar(const char *text, int length, FcChar32 *ch)
+{
+	int len;
+
+	if ((unsigned char)*text < 0x80) {
+		*ch = (unsigned char)*text;
+		return 1;
+	}
+
+	len = FcUtf8ToUcs4((const FcChar8 *)text, ch, length);
+
+	return len > 0 ? len : 0;
+}
+#endif
+
 int WMWidthOfString(WMFont * font, const char *text, int length)
 {
 #ifdef USE_PANGO
 	const char *previous_text;
 	int width;
 #else
-	XGlyphInfo extents;
+	FcChar32 ch;
+	int i, len, width;
 #endif
 
 	wassertrv(font != NULL && text != NULL, 0);
@@ -301,12 +363,200 @@ int WMWidthOfString(WMFont * font, const char *text, int length)
 
 	return width;
 #else
-	XftTextExtentsUtf8(font->screen->display, font->font, (XftChar8 *) text, length, &extents);
+	width = 0;
+	for (i = 0; i < length; i += len) {
+		len = nextChar(text + i, length - i, &ch);
+		if (len == 0)
+			break;
+		width += getAdvance(font, ch);
+	}
+
+	return width;
+#endif
+}
+
+int WMWidthsOfStringPrefixes(WMFont * font, const char *text, int length, int *widths)
+{
+#ifdef USE_PANGO
+	const char *previous_text;
+	PangoRectangle pos;
+	int i, width;
+#else
+	FcChar32 ch;
+	int i, j, len, width;
+#endif
+
+	wassertrv(font != NULL && text != NULL && widths != NULL, 0);
+
+	widths[0] = 0;
+#ifdef USE_PANGO
+	/* the text is shaped once, the prefixes are then only looked up */
+	previous_text = pango_layout_get_text(font->layout);
+	if ((previous_text == NULL) || (strncmp(text, previous_text, length) != 0) || previous_text[length] != '\0')
+		pango_layout_set_text(font->layout, text, length);
+	pango_layout_get_pixel_size(font->layout, &width, NULL);
+
+	for (i = 1; i < length; i++) {
+		if (((unsigned char)text[i] & 0xc0) == 0x80) {
+			widths[i] = widths[i - 1];
+		} else {
+			pango_layout_index_to_pos(font->layout, i, &pos);
+			widths[i] = PANGO_PIXELS(pos.x);
+		}
+	}
+	if (length > 0)
+		widths[length] = width;
+
+	return width;
+#else
+	width = 0;
+	for (i = 0; i < length; i += len) {
+		len = nextChar(text + i, length - i, &ch);
+		if (len == 0)
+			break;
+		/* a prefix ending inside a character does not include it */
+		for (j = 1; j < len; j++)
+			widths[i + j] = width;
+		width += getAdvance(font, ch);
+		widths[i + len] = width;
+	}
+	for (; i < length; i++)
+		widths[i + 1] = width;
 
-	return extents.xOff;	/* don't ask :P */
+	return width;
 #endif
 }
 
+#define IS_CONTINUATION(c)	(((unsigned char)(c) & 0xc0) == 0x80)
+
+/* longest prefix of text[0..high] that is at most limit wide */
+static int fittingPrefix(const char *text, const int *widths, int high, int limit)
+{
+	int low = 0, mid;
+
+	while (low < high) {
+		mid = low + (high - low + 1) / 2;
+		if (widths[mid] <= limit)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+	/* never cut a multibyte character in half */
+	while (low > 0 && IS_CONTINUATION(text[low]))
+		low--;
+
+	return low;
+}
+
+/* start of the longest suffix of text[low..length] that is at most limit wide */
+static int fittingSuffix(const char *text, const int *widths, int low, int length, int limit)
+{
+	int high = length, mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (widths[length] - widths[mid] <= limit)
+			high = mid;
+		else
+			low = mid + 1;
+	}
+	while (low < length && IS_CONTINUATION(text[low]))
+		low++;
+
+	return low;
+}
+
+static char *truncateString(WMFont * font, const char *text, int width, WMTruncationMode mode)
+{
+	int length, head, tail, dots, dotWidth;
+	int *widths;
+	const char *sep;
+	char *result;
+
+	length = strlen(text);
+	widths = wmalloc((length + 1) * sizeof(int));
+	if (WMWidthsOfStringPrefixes(font, text, length, widths) <= width) {
+		wfree(widths);
+		return wstrdup(text);
+	}
+
+	if (mode == WTTruncateMiddle) {
+		/* keep the first word if it fits, then as much of the end as possible */
+		head = 0;
+		tail = 0;
+		sep = strchr(text, ' ');
+		if (!sep)
+			sep = strchr(text, ':');
+		if (sep && widths[sep - text] <= width) {
+			head = sep - text;
+			tail = head + 1;
+			width -= widths[head];
+		}
+		dots = 3;
+		width -= WMWidthOfString(font, "...", 3);
+		tail = fittingSuffix(text, widths, tail, length, width);
+	} else {
+		/* use fewer dots when even three of them do not fit */
+		dotWidth = WMWidthOfString(font, ".", 1);
+		head = 0;
+		tail = length;
+		if (width >= 3 * dotWidth) {
+			dots = 3;
+			head = fittingPrefix(text, widths, length, width - 3 * dotWidth);
+		} else if (width >= 2 * dotWidth) {
+			dots = 2;
+		} else if (width >= dotWidth) {
+			dots = 1;
+		} else {
+			dots = 0;
+		}
+	}
+	wfree(widths);
+
+	result = wmalloc(head + dots + length - tail + 1);
+	memcpy(result, text, head);
+	memcpy(result + head, "...", dots);
+	strcpy(result + head + dots, text + tail);
+
+	return result;
+}
+
+char *WMTruncateString(WMFont * font, const char *text, int width, WMTruncationMode mode, WMTruncationCache * cache)
+{
+	char *result;
+
+	wassertrv(font != NULL && text != NULL, NULL);
+
+	if (cache && cache->text && cache->font == font && cache->width == width
+	    && cache->mode == mode && strcmp(cache->text, text) == 0)
+		return wstrdup(cache->result);
+
+	result = truncateString(font, text, width, mode);
+
+	if (cache) {
+		WMFreeTruncationCache(cache);
+		/* the font is retained so that its address can not be reused */
+		cache->font = WMRetainFont(font);
+		cache->text = wstrdup(text);
+		cache->result = wstrdup(result);
+		cache->width = width;
+		cache->mode = mode;
+	}
+
+	return result;
+}
+
+void WMFreeTruncationCache(WMTruncationCache * cache)
+{
+	if (cache->font)
+		WMReleaseFont(cache->font);
+	if (cache->text)
+		wfree(cache->text);
+	if (cache->result)
+		wfree(cache->result);
+	memset(cache, 0, sizeof(*cache));
+}
+
 void WMDrawString(WMScreen * scr, Drawable d, WMColor * color, WMFont * font, int x, int y, const char *text, int length)
 {
 	XftColor xftcolor;
@@ -31,6 +31,7 @@ typedef struct W_List {
 	WMScroller *vScroller;
 
 	Pixmap doubleBuffer;
+	GC scrollGC;		/* for the scroll blits, reports the damage */
 
 	struct {
 		unsigned int allowMultipleSelection:1;
@@ -41,6 +42,7 @@ typedef struct W_List {
 		unsigned int redrawPending:1;
 		unsigned int buttonPressed:1;
 		unsigned int buttonWasPressed:1;
+		unsigned int copyPending:1;	/* no GraphicsExpose/NoExpose yet */
 	} flags;
 } List;
 
@@ -51,11 +53,13 @@ typedef struct W_List {
 
 static void destroyList(List * lPtr);
 static void paintList(List * lPtr);
+static void paintScrolledList(List * lPtr, int oldTop);
 
 static void handleEvents(XEvent * event, void *data);
 static void handleActionEvents(XEvent * event, void *data);
 
 static void updateScroller(void *data);
+static void updateScrollerParameters(List * lPtr);
 static void scrollForwardSelecting(void *data);
 static void scrollBackwardSelecting(void *data);
 
@@ -88,6 +92,13 @@ static void updateDoubleBufferPixmap(WMList * lPtr)
 		XFreePixmap(scr->display, lPtr->doubleBuffer);
 	lPtr->doubleBuffer =
 	    XCreatePixmap(scr->display, view->window, view->size.width, lPtr->itemHeight, scr->depth);
+
+	if (!lPtr->scrollGC) {
+		XGCValues gcv;
+
+		gcv.graphics_exposures = True;
+		lPtr->scrollGC = XCreateGC(scr->display, view->window, GCGraphicsExposures, &gcv);
+	}
 }
 
 static void realizeObserver(void *self, WMNotification * not)
@@ -379,6 +390,7 @@ static void scrollByAmount(WMList * lPtr, int amount)
 	int itemCount = WMGetArrayItemCount(lPtr->items);
 
 	if ((amount < 0 && lPtr->topItem > 0) || (amount > 0 && (lPtr->topItem + lPtr->fullFitLines < itemCount))) {
+		int oldTop = lPtr->topItem;
 
 		lPtr->topItem += amount;
 		if (lPtr->topItem < 0)
@@ -386,7 +398,8 @@ static void scrollByAmount(WMList * lPtr, int amount)
 		if (lPtr->topItem + lPtr->fullFitLines > itemCount)
 			lPtr->topItem = itemCount - lPtr->fullFitLines;
 
-		updateScroller(lPtr);
+		paintScrolledList(lPtr, oldTop);
+		updateScrollerParameters(lPtr);
 	}
 }
 
@@ -425,7 +438,7 @@ static void vScrollCallBack(WMWidget * scroller, void *self)
 		lPtr->topItem = WMGetScrollerValue(lPtr->vScroller) * (float)(itemCount - lPtr->fullFitLines);
 
 		if (oldTopItem != lPtr->topItem)
-			paintList(lPtr);	/* use updateScroller(lPtr) here? -Dan */
+			paintScrolledList(lPtr, oldTopItem);
 		break;
 
 	case WSKnobSlot:
@@ -439,6 +452,13 @@ static void vScrollCallBack(WMWidget * scroller, void *self)
 		WMPostNotificationName(WMListDidScrollNotification, lPtr, NULL);
 }
 
+/* Tells whether the item has a row on screen, even a partial one */
+static Bool isItemShown(List * lPtr, int index)
+{
+	return lPtr->view->flags.mapped && index >= lPtr->topItem
+	    && index < lPtr->topItem + lPtr->fullFitLines + lPtr->flags.dontFitAll;
+}
+
 static void paintItem(List * lPtr, int index)
 {
 	WMView *view = lPtr->view;
@@ -492,6 +512,32 @@ static void paintItem(List * lPtr, int index)
 	}
 }
 
+/* Paints the rows shown at the positions first to last, counted from the top */
+static void paintRows(List * lPtr, int first, int last)
+{
+	W_Screen *scrPtr = lPtr->view->screen;
+	int count = WMGetArrayItemCount(lPtr->items);
+	int i, y;
+
+	if (first < 0)
+		first = 0;
+	if (last > lPtr->fullFitLines + lPtr->flags.dontFitAll - 1)
+		last = lPtr->fullFitLines + lPtr->flags.dontFitAll - 1;
+
+	for (i = first; i <= last; i++) {
+		if (lPtr->topItem + i >= count) {
+			/* past the end of the list */
+			y = 2 + i * lPtr->itemHeight;
+			XClearArea(scrPtr->display, lPtr->view->window, 19, y, lPtr->view->size.width - 21,
+				   lPtr->view->size.height - y - 1, False);
+			W_DrawRelief(scrPtr, lPtr->view->window, 0, 0,
+				     lPtr->view->size.width, lPtr->view->size.height, WRSunken);
+			break;
+		}
+		paintItem(lPtr, lPtr->topItem + i);
+	}
+}
+
 static void paintList(List * lPtr)
 {
 	W_Screen *scrPtr = lPtr->view->screen;
@@ -519,6 +565,63 @@ static void paintList(List * lPtr)
 	W_DrawRelief(scrPtr, lPtr->view->window, 0, 0, lPtr->view->size.width, lPtr->view->size.height, WRSunken);
 }
 
+/*
+ * Updates the window after topItem changed from oldTop. The rows that stay
+ * visible are moved with a single XCopyArea and only the ones that came
+ * into view are painted. Parts of the copy that were obscured come back as
+ * GraphicsExpose events; until the server answered, scrolling repaints all.
+ */
+static void paintScrolledList(List * lPtr, int oldTop)
+{
+	W_Screen *scrPtr = lPtr->view->screen;
+	int delta = lPtr->topItem - oldTop;
+	int full = lPtr->fullFitLines;
+	int height = lPtr->itemHeight;
+
+	if (!lPtr->view->flags.mapped || delta == 0)
+		return;
+
+	/* a pending idle update means the rows on screen are out of date */
+	if (!lPtr->scrollGC || lPtr->idleID || lPtr->flags.copyPending || delta >= full || -delta >= full) {
+		paintList(lPtr);
+		return;
+	}
+
+	if (delta > 0) {
+		XCopyArea(scrPtr->display, lPtr->view->window, lPtr->view->window, lPtr->scrollGC,
+			  19, 3 + delta * height, lPtr->view->size.width - 21, (full - delta) * height, 19, 3);
+		paintRows(lPtr, full - delta, full + lPtr->flags.dontFitAll - 1);
+	} else {
+		XCopyArea(scrPtr->display, lPtr->view->window, lPtr->view->window, lPtr->scrollGC,
+			  19, 3, lPtr->view->size.width - 21, (full + delta) * height, 19, 3 - delta * height);
+		paintRows(lPtr, 0, -delta - 1);
+		if (lPtr->flags.dontFitAll)
+			paintRows(lPtr, full, full);
+	}
+	lPtr->flags.copyPending = 1;
+}
+
+/* Repaints the rows in the damaged rectangle */
+static void paintDamage(List * lPtr, int y, int height, int count)
+{
+	W_Screen *scrPtr = lPtr->view->screen;
+
+	if (!lPtr->view->flags.mapped)
+		return;
+
+	if (WMGetArrayItemCount(lPtr->items) == 0) {
+		if (count == 0)
+			paintList(lPtr);
+		return;
+	}
+
+	paintRows(lPtr, (y - 3) / lPtr->itemHeight, (y + height - 4) / lPtr->itemHeight);
+
+	if (count == 0)
+		W_DrawRelief(scrPtr, lPtr->view->window, 0, 0,
+			     lPtr->view->size.width, lPtr->view->size.height, WRSunken);
+}
+
 #if 0
 static void scrollTo(List * lPtr, int newTop)
 {
@@ -530,14 +633,18 @@ static void updateScroller(void *data)
 {
 	List *lPtr = (List *) data;
 
-	float knobProportion, floatValue, tmp;
-	int count = WMGetArrayItemCount(lPtr->items);
-
 	if (lPtr->idleID)
 		WMDeleteIdleHandler(lPtr->idleID);
 	lPtr->idleID = NULL;
 
 	paintList(lPtr);
+	updateScrollerParameters(lPtr);
+}
+
+static void updateScrollerParameters(List * lPtr)
+{
+	float knobProportion, floatValue, tmp;
+	int count = WMGetArrayItemCount(lPtr->items);
 
 	if (count == 0 || count <= lPtr->fullFitLines)
 		WMSetScrollerParameters(lPtr->vScroller, 0, 1);
@@ -624,9 +731,18 @@ static void handleEvents(XEvent * event, void *data)
 
 	switch (event->type) {
 	case Expose:
-		if (event->xexpose.count != 0)
-			break;
-		paintList(lPtr);
+		paintDamage(lPtr, event->xexpose.y, event->xexpose.height, event->xexpose.count);
+		break;
+
+	case GraphicsExpose:
+		paintDamage(lPtr, event->xgraphicsexpose.y, event->xgraphicsexpose.height,
+			    event->xgraphicsexpose.count);
+		if (event->xgraphicsexpose.count == 0)
+			lPtr->flags.copyPending = 0;
+		break;
+
+	case NoExpose:
+		lPtr->flags.copyPending = 0;
 		break;
 
 	case DestroyNotify:
@@ -655,6 +771,12 @@ int WMFindRowOfListItemWithTitle(WMList * lPtr, const char *title)
 	return WMFindInArray(lPtr->items, matchTitle, (char *) title);
 }
 
+void WMRedisplayListItem(WMList * lPtr, int row)
+{
+	if (row >= 0 && row < WMGetArrayItemCount(lPtr->items) && isItemShown(lPtr, row))
+		paintItem(lPtr, row);
+}
+
 void WMSelectListItem(WMList * lPtr, int row)
 {
 	WMListItem *item;
@@ -682,7 +804,7 @@ void WMSelectListItem(WMList * lPtr, int row)
 	item->selected = 1;
 	WMAddToArray(lPtr->selectedItems, item);
 
-	if (lPtr->view->flags.mapped && row >= lPtr->topItem && row <= lPtr->topItem + lPtr->fullFitLines) {
+	if (isItemShown(lPtr, row)) {
 		paintItem(lPtr, row);
 	}
 
@@ -703,7 +825,7 @@ void WMUnselectListItem(WMList * lPtr, int row)
 	item->selected = 0;
 	WMRemoveFromArray(lPtr->selectedItems, item);
 
-	if (lPtr->view->flags.mapped && row >= lPtr->topItem && row <= lPtr->topItem + lPtr->fullFitLines) {
+	if (isItemShown(lPtr, row)) {
 		paintItem(lPtr, row);
 	}
 
@@ -731,8 +853,7 @@ void WMSelectListItemsInRange(WMList * lPtr, WMRange range)
 		if (!item->selected) {
 			item->selected = 1;
 			WMAddToArray(lPtr->selectedItems, item);
-			if (lPtr->view->flags.mapped && position >= lPtr->topItem
-			    && position <= lPtr->topItem + lPtr->fullFitLines) {
+			if (isItemShown(lPtr, position)) {
 				paintItem(lPtr, position);
 			}
 			notify = 1;
@@ -781,8 +902,7 @@ void WMSetListSelectionToRange(WMList * lPtr, WMRange range)
 		item = WMGetFromArray(lPtr->items, i);
 		if (item->selected) {
 			item->selected = 0;
-			if (lPtr->view->flags.mapped && i >= lPtr->topItem
-			    && i <= lPtr->topItem + lPtr->fullFitLines) {
+			if (isItemShown(lPtr, i)) {
 				paintItem(lPtr, i);
 			}
 			notify = 1;
@@ -792,8 +912,7 @@ void WMSetListSelectionToRange(WMList * lPtr, WMRange range)
 		item = WMGetFromArray(lPtr->items, position);
 		if (!item->selected) {
 			item->selected = 1;
-			if (lPtr->view->flags.mapped && position >= lPtr->topItem
-			    && position <= lPtr->topItem + lPtr->fullFitLines) {
+			if (isItemShown(lPtr, position)) {
 				paintItem(lPtr, position);
 			}
 			notify = 1;
@@ -805,8 +924,7 @@ void WMSetListSelectionToRange(WMList * lPtr, WMRange range)
 		item = WMGetFromArray(lPtr->items, i);
 		if (item->selected) {
 			item->selected = 0;
-			if (lPtr->view->flags.mapped && i >= lPtr->topItem
-			    && i <= lPtr->topItem + lPtr->fullFitLines) {
+			if (isItemShown(lPtr, i)) {
 				paintItem(lPtr, i);
 			}
 			notify = 1;
@@ -837,8 +955,7 @@ void WMSelectAllListItems(WMList * lPtr)
 		item = WMGetFromArray(lPtr->items, i);
 		if (!item->selected) {
 			item->selected = 1;
-			if (lPtr->view->flags.mapped && i >= lPtr->topItem
-			    && i <= lPtr->topItem + lPtr->fullFitLines) {
+			if (isItemShown(lPtr, i)) {
 				paintItem(lPtr, i);
 			}
 		}
@@ -866,8 +983,7 @@ static void unselectAllListItems(WMList * lPtr, WMListItem * exceptThis)
 		item = WMGetFromArray(lPtr->items, i);
 		if (item != exceptThis && item->selected) {
 			item->selected = 0;
-			if (lPtr->view->flags.mapped && i >= lPtr->topItem
-			    && i <= lPtr->topItem + lPtr->fullFitLines) {
+			if (isItemShown(lPtr, i)) {
 				paintItem(lPtr, i);
 			}
 		}
@@ -1132,6 +1248,9 @@ static void destroyList(List * lPtr)
 	if (lPtr->doubleBuffer)
 		XFreePixmap(lPtr->view->screen->display, lPtr->doubleBuffer);
 
+	if (lPtr->scrollGC)
+		XFreeGC(lPtr->view->screen->display, lPtr->scrollGC);
+
 	WMRemoveNotificationObserver(lPtr);
 
 	wfree(lPtr);
@@ -199,3 +199,76 @@ AC_DEFUN_ONCE([WM_XEXT_CHECK_XRANDR],
     [supported_xext], [LIBXRANDR], [], [-])dnl
 AC_SUBST([LIBXRANDR])dnl
 ]) dnl AC_DEFUN
+
+
+# WM_XEXT_CHECK_XRENDER
+# ---------------------
+#
+# Check for the X Render extension, used to draw the gradients on the server
+# Only the versions that have gradients (0.10 and later) are accepted
+# The check depends on variable 'enable_xrender' being either:
+#   yes  - detect, fail if not found
+#   no   - do not detect, disable support
+#   auto - detect, disable if not found
+#
+# When found, append appropriate stuff in LIBXRENDER, and append info to
+# the variable 'supported_xext'
+# When not found, append info to variable 'unsupported'
+AC_DEFUN_ONCE([WM_XEXT_CHECK_XRENDER],
+[WM_LIB_CHECK([XRender], [-lXrender], [XRenderCreateLinearGradient], [$XLIBS],
+    [wm_save_CFLAGS="$CFLAGS"
+     AS_IF([wm_fn_lib_try_compile "X11/extensions/Xrender.h" "Display *dpy;" "XRenderCreateLinearGradient(dpy, NULL, NULL, NULL, 0)" ""],
+        [],
+        [AC_MSG_ERROR([found $CACHEVAR but cannot compile using XRender header])])
+     CFLAGS="$wm_save_CFLAGS"],
+    [supported_xext], [LIBXRENDER], [], [-])dnl
+AC_SUBST([LIBXRENDER])dnl
+]) dnl AC_DEFUN
+
+
+# WM_XEXT_CHECK_XCB
+# -----------------
+#
+# Check for the Xlib/XCB bridge, used to send requests without waiting
+# for the replies one by one
+# The check depends on variable 'enable_xcb' being either:
+#   yes  - detect, fail if not found
+#   no   - do not detect, disable support
+#   auto - detect, disable if not found
+#
+# When found, append appropriate stuff in LIBXCB, and append info to
+# the variable 'supported_xext'
+# When not found, append info to variable 'unsupported'
+AC_DEFUN_ONCE([WM_XEXT_CHECK_XCB],
+[LIBXCB=""
+AS_IF([test "x$enable_xcb" = "xno"],
+    [unsupported="$unsupported XCB"],
+    [AC_CACHE_CHECK([for Xlib/XCB bridge library], [wm_cv_xext_xcb],
+        [wm_cv_xext_xcb=no
+         dnl
+         dnl We check that the library is available
+         wm_save_LIBS="$LIBS"
+         AS_IF([wm_fn_lib_try_link "XGetXCBConnection" "$XLFLAGS $XLIBS -lX11-xcb -lxcb"],
+             [wm_cv_xext_xcb="-lX11-xcb -lxcb"])
+         LIBS="$wm_save_LIBS"
+         AS_IF([test "x$enable_xcb$wm_cv_xext_xcb" = "xyesno"],
+             [AC_MSG_ERROR([explicit XCB support requested but no library found])])
+         dnl
+         dnl A library was found, check if header is available and compile
+         AS_IF([test "x$wm_cv_xext_xcb" != "xno"],
+             [wm_save_CFLAGS="$CFLAGS"
+              AS_IF([wm_fn_lib_try_compile "X11/Xlib-xcb.h" "Display *dpy;" "XGetXCBConnection(dpy)" ""],
+                  [],
+                  [AC_MSG_ERROR([found $wm_cv_xext_xcb but cannot compile with the header])])
+              CFLAGS="$wm_save_CFLAGS"])
+        ])
+     AS_IF([test "x$wm_cv_xext_xcb" = "xno"],
+        [unsupported="$unsupported XCB"
+         enable_xcb="no"],
+        [LIBXCB="$wm_cv_xext_xcb"
+         AC_DEFINE([USE_XCB], [1],
+             [defined when usable Xlib/XCB bridge library with header was found])
+         supported_xext="$supported_xext XCB"])
+    ])
+AC_SUBST([LIBXCB])dnl
+]) dnl AC_DEFUN
@@ -586,6 +586,8 @@ extern struct wmaker_global_variables {
 
 			Atom icon_size;
 			Atom icon_tile;
+
+			Atom stats;
 		} wmaker;
 
 	} atom;
@@ -620,6 +622,13 @@ extern struct wmaker_global_variables {
 		} randr;
 #endif
 
+#ifdef USE_XRENDER
+		struct {
+			Bool supported;		/* with the gradients */
+			Bool blend;		/* with the blend operators */
+		} xrender;
+#endif
+
 		/*
 		 * If no extension were activated, we would end up with an empty
 		 * structure, which old compilers may not appreciate, so let's
@@ -48,6 +48,7 @@
 #include "xinerama.h"
 #include "usermenu.h"
 #include "placement.h"
+#include "framegrid.h"
 #include "misc.h"
 #include "event.h"
 
@@ -259,6 +260,7 @@ void wShadeWindow(WWindow *wwin)
 
 	/* for the client it's just like iconification */
 	wFrameWindowResize(wwin->frame, wwin->frame->core->width, wwin->frame->top_width - 1);
+	wFrameGridUpdate(wwin);
 
 	wwin->client.y = wwin->frame_y - wwin->client.height + wwin->frame->top_width;
 	wWindowSynthConfigureNotify(wwin);
@@ -292,6 +294,7 @@ void wUnshadeWindow(WWindow *wwin)
 	wwin->flags.skip_next_animation = 0;
 	wFrameWindowResize(wwin->frame, wwin->frame->core->width,
 			   wwin->frame->top_width + wwin->client.height + wwin->frame->bottom_width);
+	wFrameGridUpdate(wwin);
 
 	wwin->client.y = wwin->frame_y + wwin->frame->top_width;
 	wWindowSynthConfigureNotify(wwin);
@@ -1261,6 +1264,7 @@ void wIconifyWindow(WWindow *wwin)
 			Window baz;
 
 			XRaiseWindow(dpy, wwin->frame->core->window);
+			NoteFrameRaised(wwin->frame->core);
 			XTranslateCoordinates(dpy, wwin->client_win, wwin->screen_ptr->root_win, 0, 0, &x, &y, &baz);
 
 			w = attribs.width;
@@ -2033,6 +2037,7 @@ void wSelectWindow(WWindow *wwin, Bool flag)
 		if (!scr->selected_windows)
 			scr->selected_windows = WMCreateArray(4);
 		WMAddToArray(scr->selected_windows, wwin);
+		wFrameGridUpdate(wwin);
 	} else {
 		wwin->flags.selected = 0;
 		if (wwin->flags.focused) {
@@ -2052,6 +2057,7 @@ void wSelectWindow(WWindow *wwin, Bool flag)
 
 		if (scr->selected_windows)
 			WMRemoveFromArray(scr->selected_windows, wwin);
+		wFrameGridUpdate(wwin);
 	}
 }
 
@@ -25,7 +25,6 @@
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <stdlib.h>
-#include <libgen.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
@@ -120,11 +119,8 @@ WAppIcon *wAppIconCreateForDock(WScreen *scr, const char *command, const char *w
 	if (command)
 		aicon->command = wstrdup(command);
 
-	if (wm_class)
-		aicon->wm_class = wstrdup(wm_class);
-
-	if (wm_instance)
-		aicon->wm_instance = wstrdup(wm_instance);
+	aicon->wm_class = WMInternString(wm_class);
+	aicon->wm_instance = WMInternString(wm_instance);
 
 	if (wPreferences.flags.clip_merged_in_dock && wm_class != NULL && strcmp(wm_class, "WMDock") == 0)
 		tile = TILE_CLIP;
@@ -299,11 +295,8 @@ static WAppIcon *wAppIconCreate(WWindow *leader_win)
 	aicon->prev = NULL;
 	aicon->next = NULL;
 
-	if (leader_win->wm_class)
-		aicon->wm_class = wstrdup(leader_win->wm_class);
-
-	if (leader_win->wm_instance)
-		aicon->wm_instance = wstrdup(leader_win->wm_instance);
+	aicon->wm_class = WMRetainInternedString(leader_win->wm_class);
+	aicon->wm_instance = WMRetainInternedString(leader_win->wm_instance);
 
 	aicon->icon = icon_create_for_wwindow(leader_win);
 #ifdef USE_DOCK_XDND
@@ -333,11 +326,8 @@ void wAppIconDestroy(WAppIcon * aicon)
 	if (aicon->dnd_command)
 		wfree(aicon->dnd_command);
 #endif
-	if (aicon->wm_instance)
-		wfree(aicon->wm_instance);
-
-	if (aicon->wm_class)
-		wfree(aicon->wm_class);
+	WMReleaseInternedString(aicon->wm_instance);
+	WMReleaseInternedString(aicon->wm_class);
 
 	remove_from_appicon_list(scr, aicon);
 
@@ -556,7 +546,7 @@ static void killCallback(WMenu * menu, WMenuEntry * entry)
 	WApplication *wapp = (WApplication *) entry->clientdata;
 	WFakeGroupLeader *fPtr;
 	char *buffer;
-	char *shortname;
+	const char *shortname;
 
 	if (!WCHECK_STATE(WSTATE_NORMAL))
 		return;
@@ -565,7 +555,10 @@ static void killCallback(WMenu * menu, WMenuEntry * entry)
 
 	assert(entry->clientdata != NULL);
 
-	shortname = basename(wapp->app_icon->wm_instance);
+	/* not basename(), which may modify the interned instance */
+	shortname = wapp->app_icon->wm_instance;
+	if (shortname && strrchr(shortname, '/'))
+		shortname = strrchr(shortname, '/') + 1;
 
 	buffer = wstrconcat(wapp->app_icon ? shortname : NULL,
 			    _(" will be forcibly closed.\n"
@@ -1117,6 +1110,7 @@ static void wApplicationSaveIconPathFor(const char *iconPath, const char *wm_ins
 		val = WMCreatePLString(iconPath);
 		WMPutInPLDictionary(adict, iconk, val);
 		WMReleasePropList(val);
+		wDefaultFlushWindowAttributes();
 	} else {
 		val = NULL;
 	}
@@ -43,8 +43,8 @@ typedef struct WAppIcon {
 #endif
 	char *paste_command;		/* command to run when
 					 * something is pasted */
-	char *wm_class;
-	char *wm_instance;
+	const char *wm_class;		/* interned */
+	const char *wm_instance;	/* interned */
 	pid_t pid;			 /* for apps launched from the dock */
 	Window main_window;
 	struct WDock *dock;		 /* In which dock is docked. */
@@ -738,7 +738,7 @@ void GetColormapWindows(WWindow * wwin)
 	wwin->cmap_windows = NULL;
 	wwin->cmap_window_no = 0;
 
-	if (!XGetWMColormapWindows(dpy, wwin->client_win, &(wwin->cmap_windows), &(wwin->cmap_window_no))
+	if (!PropGetColormapWindows(wwin->client_win, &(wwin->cmap_windows), &(wwin->cmap_window_no))
 	    || !wwin->cmap_windows) {
 		wwin->cmap_window_no = 0;
 		wwin->cmap_windows = NULL;
@@ -0,0 +1,352 @@
+/* coverage.c - how much of the screen is covered by windows
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "wconfig.h"
+
+#include <stdlib.h>
+#include <limits.h>
+
+#include <WINGs/WUtil.h>
+
+#include "coverage.h"
+
+/*
+ * The number of windows covering a point only changes on window edges,
+ * so the area is cut in a grid of cells along the edges of all windows
+ * and the summed-area table of that grid is built. Inside a cell the
+ * covered area grows linearly in each direction, which gives the exact
+ * sum for any rectangle from four lookups.
+ *
+ * The grid has up to (2N + 2)^2 cells for N windows and is built again
+ * for every placement, so past COVERAGE_MAX_RECTS windows the sums are
+ * made window by window instead, in constant memory.
+ */
+
+#define COVERAGE_MAX_RECTS	256
+
+typedef struct {
+	long long sum;		/* covered area above and left of the cell origin */
+	long long row;		/* covered width left of the cell, per line */
+	long long col;		/* covered height above the cell, per column */
+	int count;		/* number of windows covering the cell */
+} Cell;
+
+struct WCoverageMap {
+	int x1, y1, x2, y2;
+
+	int *rects;		/* x1, y1, x2, y2 of each window, clipped */
+	int rectCount;
+	int rectSize;
+
+	Bool built;
+	int *xs, *ys;		/* the cell edges */
+	int nx, ny;
+	int *xcell, *ycell;	/* the cell of each pixel column and line */
+	Cell *cells;
+};
+
+WCoverageMap *wCoverageMapCreate(int x1, int y1, int x2, int y2)
+{
+	WCoverageMap *map;
+
+	map = wmalloc(sizeof(WCoverageMap));
+	map->x1 = x1;
+	map->y1 = y1;
+	map->x2 = WMAX(x1, x2);
+	map->y2 = WMAX(y1, y2);
+
+	return map;
+}
+
+static void releaseTable(WCoverageMap *map)
+{
+	if (map->xs)
+		wfree(map->xs);
+	if (map->ys)
+		wfree(map->ys);
+	if (map->xcell)
+		wfree(map->xcell);
+	if (map->ycell)
+		wfree(map->ycell);
+	if (map->cells)
+		wfree(map->cells);
+	map->xs = map->ys = map->xcell = map->ycell = NULL;
+	map->cells = NULL;
+	map->built = False;
+}
+
+void wCoverageMapDestroy(WCoverageMap *map)
+{
+	releaseTable(map);
+	if (map->rects)
+		wfree(map->rects);
+	wfree(map);
+}
+
+void wCoverageMapAddRect(WCoverageMap *map, int x, int y, int width, int height)
+{
+	int *r;
+
+	/* only the part inside the area can be asked for */
+	if (x + width <= map->x1 || x >= map->x2 || y + height <= map->y1 || y >= map->y2
+	    || width <= 0 || height <= 0)
+		return;
+
+	if (map->rectCount == map->rectSize) {
+		map->rectSize = map->rectSize ? map->rectSize * 2 : 32;
+		map->rects = wrealloc(map->rects, map->rectSize * 4 * sizeof(int));
+	}
+	r = map->rects + 4 * map->rectCount++;
+	r[0] = WMAX(x, map->x1);
+	r[1] = WMAX(y, map->y1);
+	r[2] = WMIN(x + width, map->x2);
+	r[3] = WMIN(y + height, map->y2);
+
+	releaseTable(map);
+}
+
+static int compareInts(const void *a, const void *b)
+{
+	int i = *(const int *)a, j = *(const int *)b;
+
+	return (i > j) - (i < j);
+}
+
+/* sorts the edges along one axis and maps every coordinate to its cell */
+static int *collectEdges(WCoverageMap *map, int axis, int low, int high, int *count, int **cellOf)
+{
+	int *edges, *cell;
+	int i, j, n;
+
+	edges = wmalloc((2 * map->rectCount + 2) * sizeof(int));
+	n = 0;
+	edges[n++] = low;
+	edges[n++] = high;
+	for (i = 0; i < map->rectCount; i++) {
+		edges[n++] = map->rects[4 * i + axis];
+		edges[n++] = map->rects[4 * i + axis + 2];
+	}
+	qsort(edges, n, sizeof(int), compareInts);
+	for (i = 1, j = 1; i < n; i++) {
+		if (edges[i] != edges[j - 1])
+			edges[j++] = edges[i];
+	}
+	n = j;
+
+	cell = wmalloc((high - low + 1) * sizeof(int));
+	for (i = low, j = 0; i <= high; i++) {
+		while (j + 1 < n && edges[j + 1] <= i)
+			j++;
+		cell[i - low] = j;
+	}
+
+	*count = n;
+	*cellOf = cell;
+
+	return edges;
+}
+
+static int findEdge(const int *edges, int count, int value)
+{
+	int low = 0, high = count - 1, mid;
+
+	while (low < high) {
+		mid = (low + high) / 2;
+		if (edges[mid] < value)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+static void buildTable(WCoverageMap *map)
+{
+	int nx, ny, i, j;
+	Cell *c;
+
+	map->xs = collectEdges(map, 0, map->x1, map->x2, &map->nx, &map->xcell);
+	map->ys = collectEdges(map, 1, map->y1, map->y2, &map->ny, &map->ycell);
+	nx = map->nx;
+	ny = map->ny;
+	map->cells = wmalloc(nx * ny * sizeof(Cell));
+
+#define CELL(i, j)	(map->cells[(j) * nx + (i)])
+
+	/* mark the corners of every window, the prefix sums give the counts */
+	for (i = 0; i < map->rectCount; i++) {
+		int *r = map->rects + 4 * i;
+		int cx1 = findEdge(map->xs, nx, r[0]);
+		int cy1 = findEdge(map->ys, ny, r[1]);
+		int cx2 = findEdge(map->xs, nx, r[2]);
+		int cy2 = findEdge(map->ys, ny, r[3]);
+
+		CELL(cx1, cy1).count++;
+		CELL(cx2, cy1).count--;
+		CELL(cx1, cy2).count--;
+		CELL(cx2, cy2).count++;
+	}
+	for (j = 0; j < ny; j++) {
+		for (i = 0; i < nx; i++) {
+			c = &CELL(i, j);
+			if (i > 0)
+				c->count += CELL(i - 1, j).count;
+			if (j > 0)
+				c->count += CELL(i, j - 1).count;
+			if (i > 0 && j > 0)
+				c->count -= CELL(i - 1, j - 1).count;
+		}
+	}
+
+	for (j = 0; j < ny; j++) {
+		for (i = 0; i < nx; i++) {
+			c = &CELL(i, j);
+			if (i > 0) {
+				Cell *left = &CELL(i - 1, j);
+				long long w = map->xs[i] - map->xs[i - 1];
+
+				c->row = left->row + left->count * w;
+			}
+			if (j > 0) {
+				Cell *up = &CELL(i, j - 1);
+				long long h = map->ys[j] - map->ys[j - 1];
+
+				c->col = up->col + up->count * h;
+			}
+			if (i > 0) {
+				long long w = map->xs[i] - map->xs[i - 1];
+
+				c->sum = CELL(i - 1, j).sum + CELL(i - 1, j).col * w;
+			}
+		}
+	}
+#undef CELL
+
+	map->built = True;
+}
+
+/* covered area of [x1, x) x [y1, y) */
+static inline long long coveredArea(WCoverageMap *map, int x, int y)
+{
+	int i = map->xcell[x - map->x1];
+	int j = map->ycell[y - map->y1];
+	long long dx = x - map->xs[i];
+	long long dy = y - map->ys[j];
+	Cell *c = &map->cells[j * map->nx + i];
+
+	return c->sum + dx * c->col + dy * c->row + dx * dy * c->count;
+}
+
+/* the sum without the table */
+static long long scanRects(WCoverageMap *map, int x1, int y1, int x2, int y2)
+{
+	long long sum = 0;
+	int i;
+
+	for (i = 0; i < map->rectCount; i++) {
+		int *r = map->rects + 4 * i;
+		long long w = WMIN(x2, r[2]) - WMAX(x1, r[0]);
+		long long h = WMIN(y2, r[3]) - WMAX(y1, r[1]);
+
+		if (w > 0 && h > 0)
+			sum += w * h;
+	}
+
+	return sum;
+}
+
+long long wCoverageMapSum(WCoverageMap *map, int x, int y, int width, int height)
+{
+	int x2, y2;
+
+	/* nothing outside of the area was recorded */
+	x2 = WMIN(WMAX(x + width, map->x1), map->x2);
+	y2 = WMIN(WMAX(y + height, map->y1), map->y2);
+	x = WMIN(WMAX(x, map->x1), map->x2);
+	y = WMIN(WMAX(y, map->y1), map->y2);
+
+	if (map->rectCount > COVERAGE_MAX_RECTS)
+		return scanRects(map, x, y, x2, y2);
+
+	if (!map->built)
+		buildTable(map);
+
+	return coveredArea(map, x2, y2) - coveredArea(map, x, y2)
+	    - coveredArea(map, x2, y) + coveredArea(map, x, y);
+}
+
+void wCoverageMapFindPlace(WCoverageMap *map, unsigned int width, unsigned int height,
+			   int *x_ret, int *y_ret)
+{
+	int test_x = 0, test_y = map->y1;
+	int from_x, to_x, from_y, to_y;
+	long long min_isect, sum_isect;
+	int min_isect_x, min_isect_y;
+
+	min_isect = LLONG_MAX;
+	min_isect_x = map->x1;
+	min_isect_y = test_y;
+
+	/* probe a coarse grid first, then every position around the best one */
+	while (((test_y + height) < map->y2)) {
+		test_x = map->x1;
+		while ((test_x + width) < map->x2) {
+			sum_isect = wCoverageMapSum(map, test_x, test_y, width, height);
+
+			if (sum_isect < min_isect) {
+				min_isect = sum_isect;
+				min_isect_x = test_x;
+				min_isect_y = test_y;
+			}
+
+			test_x += PLACETEST_HSTEP;
+		}
+		test_y += PLACETEST_VSTEP;
+	}
+
+	from_x = min_isect_x - PLACETEST_HSTEP + 1;
+	from_x = WMAX(from_x, map->x1);
+	to_x = min_isect_x + PLACETEST_HSTEP;
+	if (to_x + width > map->x2)
+		to_x = map->x2 - width;
+
+	from_y = min_isect_y - PLACETEST_VSTEP + 1;
+	from_y = WMAX(from_y, map->y1);
+	to_y = min_isect_y + PLACETEST_VSTEP;
+	if (to_y + height > map->y2)
+		to_y = map->y2 - height;
+
+	for (test_x = from_x; test_x < to_x; test_x++) {
+		for (test_y = from_y; test_y < to_y; test_y++) {
+			sum_isect = wCoverageMapSum(map, test_x, test_y, width, height);
+
+			if (sum_isect < min_isect) {
+				min_isect = sum_isect;
+				min_isect_x = test_x;
+				min_isect_y = test_y;
+			}
+		}
+	}
+
+	*x_ret = min_isect_x;
+	*y_ret = min_isect_y;
+}
@@ -0,0 +1,49 @@
+/* coverage.h - how much of the screen is covered by windows
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef WMCOVERAGE_H
+#define WMCOVERAGE_H
+
+typedef struct WCoverageMap WCoverageMap;
+
+/* Creates an empty map of the area [x1, x2) x [y1, y2) */
+WCoverageMap *wCoverageMapCreate(int x1, int y1, int x2, int y2);
+
+void wCoverageMapDestroy(WCoverageMap *map);
+
+/* Adds a window to the map, the parts outside of the area are ignored */
+void wCoverageMapAddRect(WCoverageMap *map, int x, int y, int width, int height);
+
+/*
+ * Returns the sum of the areas of the intersections of the given
+ * rectangle with every window added to the map, in constant time up to
+ * a few hundred windows and in linear time past them.
+ */
+long long wCoverageMapSum(WCoverageMap *map, int x, int y, int width, int height);
+
+/*
+ * Finds where a width x height window overlaps the others the least,
+ * probing the area like the smart placement always did.
+ */
+void wCoverageMapFindPlace(WCoverageMap *map, unsigned int width, unsigned int height,
+			   int *x_ret, int *y_ret);
+
+#endif  /* WMCOVERAGE_H */
@@ -64,6 +64,8 @@
 #include "properties.h"
 #include "misc.h"
 #include "winmenu.h"
+#include "stats.h"
+#include "framecache.h"
 
 #define MAX_SHORTCUT_LENGTH 32
 
@@ -840,6 +842,50 @@ WDefaultEntry optionList[] = {
 	    &wPreferences.cycle_ignore_minimized, getBool, NULL, NULL, NULL}
 };
 
+/*
+ * Option values are kept as immutable property lists, so that the ones
+ * that did not change since the last time the domain was read are the
+ * very same objects and wReadDefaults() can compare them for free.
+ */
+static WMPropList *createImmutableDefault(const char *description)
+{
+	WMPropList *plist, *value;
+
+	plist = WMCreatePropListFromDescription(description);
+	if (!plist)
+		return NULL;
+
+	value = WMCreateImmutablePropList(plist);
+	WMReleasePropList(plist);
+
+	return value;
+}
+
+/*
+ * Makes the values in dict immutable. With depth 2 the values that are
+ * dictionaries stay mutable and their own values are made immutable.
+ */
+static void makeDomainValuesImmutable(WMPropList *dict, int depth)
+{
+	WMPropList *keys, *key, *value, *unique;
+	int i;
+
+	keys = WMGetPLDictionaryKeys(dict);
+	for (i = 0; i < WMGetPropListItemCount(keys); i++) {
+		key = WMGetFromPLArray(keys, i);
+		value = WMGetFromPLDictionary(dict, key);
+
+		if (depth > 1 && WMIsPLDictionary(value)) {
+			makeDomainValuesImmutable(value, depth - 1);
+		} else if (!WMIsPropListImmutable(value)) {
+			unique = WMCreateImmutablePropList(value);
+			WMPutInPLDictionary(dict, key, unique);
+			WMReleasePropList(unique);
+		}
+	}
+	WMReleasePropList(keys);
+}
+
 static void initDefaults(void)
 {
 	unsigned int i;
@@ -852,7 +898,7 @@ static void initDefaults(void)
 
 		entry->plkey = WMCreatePLString(entry->key);
 		if (entry->default_value)
-			entry->plvalue = WMCreatePropListFromDescription(entry->default_value);
+			entry->plvalue = createImmutableDefault(entry->default_value);
 		else
 			entry->plvalue = NULL;
 	}
@@ -862,12 +908,73 @@ static void initDefaults(void)
 
 		entry->plkey = WMCreatePLString(entry->key);
 		if (entry->default_value)
-			entry->plvalue = WMCreatePropListFromDescription(entry->default_value);
+			entry->plvalue = createImmutableDefault(entry->default_value);
 		else
 			entry->plvalue = NULL;
 	}
 }
 
+/*
+ * The merged contents of a domain are also saved in compiled form in a
+ * hidden file next to the user's text file. As long as none of the text
+ * files it was built from change, the next start loads that instead of
+ * parsing and merging them again.
+ */
+static char *compiledDomainPath(const char *path)
+{
+	const char *name = strrchr(path, '/');
+	char *cpath;
+	int dirlen;
+
+	name = name ? name + 1 : path;
+	dirlen = name - path;
+
+	cpath = wmalloc(dirlen + strlen(name) + 8);
+	memcpy(cpath, path, dirlen);
+	sprintf(cpath + dirlen, ".%s.cache", name);
+
+	return cpath;
+}
+
+/* globalPath is the global domain file merged into the user one, or NULL */
+WMPropList *wDefaultsReadCompiled(const char *path, const char *globalPath)
+{
+	const char *sources[3] = { path, globalPath, NULL };
+	WMPropList *dict;
+	char *cpath;
+
+	cpath = compiledDomainPath(path);
+	dict = WMReadPropListFromCompiledFile(cpath, sources);
+	wfree(cpath);
+
+	return dict;
+}
+
+/*
+ * before is the state of path when it was read, or NULL if it did not
+ * exist. Nothing is saved if it changed since then, as the compiled file
+ * would otherwise claim to be up to date with contents it does not have.
+ */
+void wDefaultsWriteCompiled(WMPropList *dict, const char *path, const char *globalPath, const struct stat *before)
+{
+	const char *sources[3] = { path, globalPath, NULL };
+	struct stat stbuf;
+	char *cpath;
+
+	if (stat(path, &stbuf) < 0) {
+		if (before)
+			return;
+	} else if (!before || stbuf.st_mtime != before->st_mtime ||
+		   stbuf.st_size != before->st_size || stbuf.st_ino != before->st_ino) {
+		return;
+	}
+
+	cpath = compiledDomainPath(path);
+	if (!WMWritePropListToCompiledFile(dict, cpath, sources))
+		unlink(cpath);
+	wfree(cpath);
+}
+
 static WMPropList *readGlobalDomain(const char *domainName, Bool requireDictionary)
 {
 	WMPropList *globalDict = NULL;
@@ -954,12 +1061,32 @@ void wDefaultsMergeGlobalMenus(WDDomain * menuDomain)
 	menuDomain->dictionary = menu;
 }
 
+/* the entries of WMWindowAttributes are changed in place, but not their values */
+static int immutableDepth(const char *domain)
+{
+	if (strcmp(domain, "WindowMaker") == 0)
+		return 1;
+	if (strcmp(domain, "WMWindowAttributes") == 0)
+		return 2;
+	return 0;
+}
+
+static void shareDomainValues(WDDomain *db)
+{
+	int depth = immutableDepth(db->domain_name);
+
+	if (depth > 0 && db->dictionary && WMIsPLDictionary(db->dictionary))
+		makeDomainValuesImmutable(db->dictionary, depth);
+}
+
 WDDomain *wDefaultsInitDomain(const char *domain, Bool requireDictionary)
 {
 	WDDomain *db;
 	struct stat stbuf;
 	static int inited = 0;
 	WMPropList *shared_dict = NULL;
+	char globalPath[PATH_MAX];
+	Bool userExists;
 
 	if (!inited) {
 		inited = 1;
@@ -969,8 +1096,19 @@ WDDomain *wDefaultsInitDomain(const char *domain, Bool requireDictionary)
 	db = wmalloc(sizeof(WDDomain));
 	db->domain_name = domain;
 	db->path = wdefaultspathfordomain(domain);
+	snprintf(globalPath, sizeof(globalPath), "%s/%s", DEFSDATADIR, domain);
 
-	if (stat(db->path, &stbuf) >= 0) {
+	userExists = (stat(db->path, &stbuf) >= 0);
+
+	db->dictionary = wDefaultsReadCompiled(db->path, globalPath);
+	if (db->dictionary) {
+		if (userExists)
+			db->timestamp = stbuf.st_mtime;
+		shareDomainValues(db);
+		return db;
+	}
+
+	if (userExists) {
 		db->dictionary = WMReadPropListFromFile(db->path);
 		if (db->dictionary) {
 			if (requireDictionary && !WMIsPLDictionary(db->dictionary)) {
@@ -1000,6 +1138,11 @@ WDDomain *wDefaultsInitDomain(const char *domain, Bool requireDictionary)
 			db->timestamp = stbuf.st_mtime;
 	}
 
+	if (db->dictionary)
+		wDefaultsWriteCompiled(db->dictionary, db->path, globalPath, userExists ? &stbuf : NULL);
+
+	shareDomainValues(db);
+
 	return db;
 }
 
@@ -1065,6 +1208,10 @@ void wDefaultsCheckDomains(void* arg)
 					shared_dict = NULL;
 				}
 
+				wDefaultsWriteCompiled(dict, w_global.domain.wmaker->path,
+						       DEFSDATADIR "/WindowMaker", &stbuf);
+				makeDomainValuesImmutable(dict, immutableDepth("WindowMaker"));
+
 				for (i = 0; i < w_global.screen_count; i++) {
 					scr = wScreenWithNumber(i);
 					if (scr)
@@ -1108,6 +1255,11 @@ void wDefaultsCheckDomains(void* arg)
 					WMReleasePropList(w_global.domain.window_attr->dictionary);
 
 				w_global.domain.window_attr->dictionary = dict;
+				wDefaultFlushWindowAttributes();
+				wDefaultsWriteCompiled(dict, w_global.domain.window_attr->path,
+						       DEFSDATADIR "/WMWindowAttributes", &stbuf);
+				makeDomainValuesImmutable(dict, immutableDepth("WMWindowAttributes"));
+
 				for (i = 0; i < w_global.screen_count; i++) {
 					scr = wScreenWithNumber(i);
 					if (scr) {
@@ -1248,6 +1400,10 @@ void wReadDefaults(WScreen * scr, WMPropList * new_dict)
 		}
 	}
 
+	/* the frames rendered with the old textures are not shared anymore */
+	if (needs_refresh & (REFRESH_WINDOW_TEXTURES | REFRESH_MENU_TITLE_TEXTURE))
+		wFrameCacheFlush(scr);
+
 	if (needs_refresh != 0 && !scr->flags.startup) {
 		int foo;
 
@@ -2641,11 +2797,13 @@ static int setIconTile(WScreen * scr, WDefaultEntry * entry, void *tdata, void *
 			wTextureDestroy(scr, *texture);
 		return 0;
 	}
-	RConvertImage(scr->rcontext, img, &pixmap);
+	if (RConvertImage(scr->rcontext, img, &pixmap))
+		wStatsAddPixmap(WSTATS_TEXTURE, pixmap, img->width, img->height, scr->w_depth);
 
 	if (scr->icon_tile) {
 		reset = 1;
 		RReleaseImage(scr->icon_tile);
+		wStatsRemovePixmap(scr->icon_tile_pixmap);
 		XFreePixmap(dpy, scr->icon_tile_pixmap);
 	}
 
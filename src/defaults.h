@@ -32,11 +32,19 @@ WDDomain * wDefaultsInitDomain(const char *domain, Bool requireDictionary);
 
 void wDefaultsMergeGlobalMenus(WDDomain *menuDomain);
 
+struct stat;
+
+WMPropList *wDefaultsReadCompiled(const char *path, const char *globalPath);
+void wDefaultsWriteCompiled(WMPropList *dict, const char *path, const char *globalPath,
+                            const struct stat *before);
+
 void wReadDefaults(WScreen *scr, WMPropList *new_dict);
 void wDefaultUpdateIcons(WScreen *scr);
 void wReadStaticDefaults(WMPropList *dict);
 void wDefaultsCheckDomains(void *arg);
 void wSaveDefaults(WScreen *scr);
+void wDefaultFlushWindowAttributes(void);
+
 void wDefaultFillAttributes(const char *instance, const char *class,
                             WWindowAttributes *attr, WWindowAttributes *mask,
                             Bool useGlobalDefault);
@@ -559,43 +559,226 @@ typedef struct IconPanel {
 #endif
 	short done;
 	short result;
-	short preview;
+
+	/* the icon directory being listed, read a few entries at a time */
+	char *iconDir;
+	DIR *scanDir;
+	WMHandlerID scanID;
+
+	WMHandlerID thumbnailID;
+	int thumbnailWidth;
+	int thumbnailHeight;
 } IconPanel;
 
-static void listPixmaps(WScreen *scr, WMList *lPtr, const char *path)
+/*
+ * Thumbnails of the icon chooser, kept across uses of the panel. The key
+ * holds the path, modification time, size and background of the image,
+ * so a changed file or a row drawn on another color is rendered anew.
+ */
+#define THUMBNAIL_CACHE_SIZE	128
+#define THUMBNAIL_PREFETCH	4	/* rows rendered ahead on each side of the view */
+
+typedef struct Thumbnail {
+	char *key;
+	WMPixmap *pixmap;	/* NULL if the image could not be loaded */
+} Thumbnail;
+
+static WMHashTable *thumbnailTable = NULL;
+static WMArray *thumbnailOrder = NULL;	/* oldest first */
+
+static char *getThumbnailKey(const char *file, const RColor *color, int width, int height)
 {
-	struct dirent *dentry;
-	DIR *dir;
-	char pbuf[PATH_MAX + 16];
-	char *apath;
-	IconPanel *panel = WMGetHangedData(lPtr);
+	struct stat st;
+	char *key;
+	int len;
 
-	panel->preview = False;
+	if (stat(file, &st) < 0)
+		return NULL;
 
-	apath = wexpandpath(path);
-	dir = opendir(apath);
+	len = strlen(file) + 64;
+	key = wmalloc(len);
+	snprintf(key, len, "%s:%ld:%dx%d:%02x%02x%02x", file, (long) st.st_mtime,
+		 width, height, color->red, color->green, color->blue);
 
-	if (!dir) {
-		wfree(apath);
-		snprintf(pbuf, sizeof(pbuf),
-		         _("Could not open directory \"%s\":\n%s"),
-		         path, strerror(errno));
-		wMessageDialog(scr, _("Error"), pbuf, _("OK"), NULL, NULL);
+	return key;
+}
+
+/* Takes over the key */
+static Thumbnail *createThumbnail(WMScreen *wmscr, char *key, const char *file,
+				  const RColor *color, int width, int height)
+{
+	Thumbnail *thumb;
+
+	if (!thumbnailTable) {
+		thumbnailTable = WMCreateHashTable(WMStringPointerHashCallbacks);
+		thumbnailOrder = WMCreateArray(THUMBNAIL_CACHE_SIZE);
+	}
+
+	if (WMGetArrayItemCount(thumbnailOrder) >= THUMBNAIL_CACHE_SIZE) {
+		thumb = WMGetFromArray(thumbnailOrder, 0);
+		WMDeleteFromArray(thumbnailOrder, 0);
+		WMHashRemove(thumbnailTable, thumb->key);
+		if (thumb->pixmap)
+			WMReleasePixmap(thumb->pixmap);
+		wfree(thumb->key);
+		wfree(thumb);
+	}
+
+	thumb = wmalloc(sizeof(Thumbnail));
+	thumb->key = key;
+	thumb->pixmap = WMCreateScaledBlendedPixmapFromFile(wmscr, file, color, width, height);
+	WMHashInsert(thumbnailTable, thumb->key, thumb);
+	WMAddToArray(thumbnailOrder, thumb);
+
+	return thumb;
+}
+
+static char *getIconFile(IconPanel *panel, const char *name)
+{
+	char *file;
+	int len;
+
+	len = strlen(panel->iconDir) + strlen(name) + 2;
+	file = wmalloc(len);
+	snprintf(file, len, "%s/%s", panel->iconDir, name);
+
+	return file;
+}
+
+static void getRowColor(IconPanel *panel, int state, RColor *color)
+{
+	WMColor *back = (state & WLDSSelected) ? panel->scr->white : panel->scr->gray;
+
+	color->red = WMRedComponentOfColor(back) >> 8;
+	color->green = WMGreenComponentOfColor(back) >> 8;
+	color->blue = WMBlueComponentOfColor(back) >> 8;
+	color->alpha = WMGetColorAlpha(back) >> 8;
+}
+
+/* Renders the thumbnail of a row unless it is cached, returns whether it did */
+static Bool renderThumbnail(IconPanel *panel, int row)
+{
+	WMListItem *item = WMGetListItem(panel->iconList, row);
+	char *file, *key;
+	RColor color;
+	Bool rendered = False;
+
+	getRowColor(panel, item->selected ? WLDSSelected : 0, &color);
+	file = getIconFile(panel, item->text);
+
+	key = getThumbnailKey(file, &color, panel->thumbnailWidth, panel->thumbnailHeight);
+	if (key) {
+		if (thumbnailTable && WMHashGet(thumbnailTable, key)) {
+			wfree(key);
+		} else {
+			createThumbnail(WMWidgetScreen(panel->win), key, file, &color,
+					panel->thumbnailWidth, panel->thumbnailHeight);
+			rendered = True;
+		}
+	}
+	wfree(file);
+
+	return rendered;
+}
+
+/*
+ * Renders one missing thumbnail each time the event queue is empty, first
+ * for the rows in view and then for the rows around them, nearest first.
+ */
+static void renderThumbnails(void *data)
+{
+	IconPanel *panel = (IconPanel *) data;
+	WMList *list = panel->iconList;
+	int count = WMGetListNumberOfRows(list);
+	int top = WMGetListPosition(list);
+	int shown = WMWidgetHeight(list) / WMGetListItemHeight(list) + 1;
+	int i, j, row;
+
+	panel->thumbnailID = NULL;
+
+	if (!panel->iconDir)
 		return;
+
+	for (i = 0; i < shown + 2 * THUMBNAIL_PREFETCH; i++) {
+		if (i < shown) {
+			row = top + i;
+		} else {
+			j = i - shown;
+			row = (j & 1) ? top - 1 - j / 2 : top + shown + j / 2;
+		}
+		if (row < 0 || row >= count)
+			continue;
+
+		if (renderThumbnail(panel, row)) {
+			/* this may already schedule the next call through drawIconProc() */
+			WMRedisplayListItem(list, row);
+			if (!panel->thumbnailID)
+				panel->thumbnailID = WMAddIdleHandler(renderThumbnails, panel);
+			return;
+		}
+	}
+}
+
+static void stopListingPixmaps(IconPanel *panel)
+{
+	if (panel->scanID) {
+		WMDeleteIdleHandler(panel->scanID);
+		panel->scanID = NULL;
 	}
+	if (panel->scanDir) {
+		closedir(panel->scanDir);
+		panel->scanDir = NULL;
+	}
+	if (panel->thumbnailID) {
+		WMDeleteIdleHandler(panel->thumbnailID);
+		panel->thumbnailID = NULL;
+	}
+}
+
+static void insertSortedListItem(WMList *lPtr, const char *text)
+{
+	int low = 0, high = WMGetListNumberOfRows(lPtr), mid;
 
-	/* list contents in the column */
-	while ((dentry = readdir(dir))) {
+	while (low < high) {
+		mid = (low + high) / 2;
+		if (strcmp(WMGetListItem(lPtr, mid)->text, text) <= 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	WMInsertListItem(lPtr, low, text);
+}
+
+#define SCAN_BATCH	64
+
+/* Adds the next few entries of the directory being listed, sorted */
+static void listPixmapsStep(void *data)
+{
+	IconPanel *panel = (IconPanel *) data;
+	struct dirent *dentry;
+	char pbuf[PATH_MAX + 16];
+	int i;
+
+	panel->scanID = NULL;
+
+	for (i = 0; i < SCAN_BATCH; i++) {
 		struct stat statb;
 
+		dentry = readdir(panel->scanDir);
+		if (!dentry) {
+			closedir(panel->scanDir);
+			panel->scanDir = NULL;
+			return;
+		}
+
 		if (strcmp(dentry->d_name, ".") == 0 || strcmp(dentry->d_name, "..") == 0)
 			continue;
 
-		if (wstrlcpy(pbuf, apath, sizeof(pbuf)) >= sizeof(pbuf) ||
+		if (wstrlcpy(pbuf, panel->iconDir, sizeof(pbuf)) >= sizeof(pbuf) ||
 		    wstrlcat(pbuf, "/", sizeof(pbuf)) >= sizeof(pbuf) ||
 		    wstrlcat(pbuf, dentry->d_name, sizeof(pbuf)) >= sizeof(pbuf)) {
 			wwarning(_("full path for file \"%s\" in \"%s\" is longer than %d bytes, skipped"),
-			         dentry->d_name, path, (int) (sizeof(pbuf) - 1) );
+			         dentry->d_name, panel->iconDir, (int) (sizeof(pbuf) - 1) );
 			continue;
 		}
 
@@ -604,14 +787,47 @@ static void listPixmaps(WScreen *scr, WMList *lPtr, const char *path)
 
 		if (statb.st_mode & (S_IRUSR | S_IRGRP | S_IROTH)
 		    && statb.st_mode & (S_IFREG | S_IFLNK)) {
-			WMAddListItem(lPtr, dentry->d_name);
+			insertSortedListItem(panel->iconList, dentry->d_name);
 		}
 	}
-	WMSortListItems(lPtr);
 
-	closedir(dir);
-	wfree(apath);
-	panel->preview = True;
+	panel->scanID = WMAddIdleHandler(listPixmapsStep, panel);
+}
+
+/*
+ * Lists the directory in the background, so that the panel stays
+ * responsive with directories of thousands of icons.
+ */
+static void listPixmaps(WScreen *scr, WMList *lPtr, const char *path)
+{
+	DIR *dir;
+	char pbuf[PATH_MAX + 16];
+	char *apath;
+	IconPanel *panel = WMGetHangedData(lPtr);
+
+	stopListingPixmaps(panel);
+	if (panel->iconDir) {
+		wfree(panel->iconDir);
+		panel->iconDir = NULL;
+	}
+
+	apath = wexpandpath(path);
+	dir = opendir(apath);
+
+	if (!dir) {
+		wfree(apath);
+		snprintf(pbuf, sizeof(pbuf),
+		         _("Could not open directory \"%s\":\n%s"),
+		         path, strerror(errno));
+		wMessageDialog(scr, _("Error"), pbuf, _("OK"), NULL, NULL);
+		return;
+	}
+
+	panel->iconDir = apath;
+	panel->scanDir = dir;
+
+	/* the first entries right away, the rest when there is nothing else to do */
+	listPixmapsStep(panel);
 }
 
 static void setViewedImage(IconPanel *panel, const char *file)
@@ -715,18 +931,19 @@ static void drawIconProc(WMList * lPtr, int index, Drawable d, char *text, int s
 	WScreen *scr = panel->scr;
 	GC gc = scr->draw_gc;
 	GC copygc = scr->copy_gc;
-	char *file, *dirfile;
+	char *file, *key;
+	Thumbnail *thumb = NULL;
 	WMPixmap *pixmap;
 	WMColor *back;
 	WMSize size;
 	WMScreen *wmscr = WMWidgetScreen(panel->win);
 	RColor color;
-	int x, y, width, height, len;
+	int x, y, width, height;
 
 	/* Parameter not used, but tell the compiler that it is ok */
 	(void) index;
 
-	if (!panel->preview)
+	if (!panel->iconDir)
 		return;
 
 	x = rect->pos.x;
@@ -735,25 +952,22 @@ static void drawIconProc(WMList * lPtr, int index, Drawable d, char *text, int s
 	height = rect->size.height;
 
 	back = (state & WLDSSelected) ? scr->white : scr->gray;
+	getRowColor(panel, state, &color);
 
-	dirfile = wexpandpath(WMGetListSelectedItem(panel->dirList)->text);
-	len = strlen(dirfile) + strlen(text) + 4;
-	file = wmalloc(len);
-	snprintf(file, len, "%s/%s", dirfile, text);
-	wfree(dirfile);
+	panel->thumbnailWidth = width - 2;
+	panel->thumbnailHeight = height - 2;
 
-	color.red = WMRedComponentOfColor(back) >> 8;
-	color.green = WMGreenComponentOfColor(back) >> 8;
-	color.blue = WMBlueComponentOfColor(back) >> 8;
-	color.alpha = WMGetColorAlpha(back) >> 8;
-
-	pixmap = WMCreateScaledBlendedPixmapFromFile(wmscr, file, &color, width - 2, height - 2);
+	/* images not rendered yet show as their name only, until the idle handler got to them */
+	file = getIconFile(panel, text);
+	key = getThumbnailKey(file, &color, width - 2, height - 2);
 	wfree(file);
-
-	if (!pixmap) {
-		/*WMRemoveListItem(lPtr, index); */
-		return;
+	if (key) {
+		if (thumbnailTable)
+			thumb = WMHashGet(thumbnailTable, key);
+		wfree(key);
 	}
+	if (!panel->thumbnailID)
+		panel->thumbnailID = WMAddIdleHandler(renderThumbnails, panel);
 
 	XFillRectangle(dpy, d, WMColorGC(back), x, y, width, height);
 
@@ -761,13 +975,16 @@ static void drawIconProc(WMList * lPtr, int index, Drawable d, char *text, int s
 	/*XDrawRectangle(dpy, d, WMColorGC(white), x+5, y+5, width-10, 54); */
 	XDrawLine(dpy, d, WMColorGC(scr->white), x, y + height - 1, x + width, y + height - 1);
 
-	size = WMGetPixmapSize(pixmap);
+	pixmap = thumb ? thumb->pixmap : NULL;
+	if (pixmap) {
+		size = WMGetPixmapSize(pixmap);
 
-	XSetClipMask(dpy, copygc, WMGetPixmapMaskXID(pixmap));
-	XSetClipOrigin(dpy, copygc, x + (width - size.width) / 2, y + 2);
-	XCopyArea(dpy, WMGetPixmapXID(pixmap), d, copygc, 0, 0,
-		  size.width > 100 ? 100 : size.width, size.height > 64 ? 64 : size.height,
-		  x + (width - size.width) / 2, y + 2);
+		XSetClipMask(dpy, copygc, WMGetPixmapMaskXID(pixmap));
+		XSetClipOrigin(dpy, copygc, x + (width - size.width) / 2, y + 2);
+		XCopyArea(dpy, WMGetPixmapXID(pixmap), d, copygc, 0, 0,
+			  size.width > 100 ? 100 : size.width, size.height > 64 ? 64 : size.height,
+			  x + (width - size.width) / 2, y + 2);
+	}
 
 	{
 		int i, j;
@@ -786,10 +1003,6 @@ static void drawIconProc(WMList * lPtr, int index, Drawable d, char *text, int s
 
 		WMDrawString(wmscr, d, scr->black, panel->normalfont, ofx, ofy, text, tlen);
 	}
-
-	WMReleasePixmap(pixmap);
-	/* I hope it is better to do not use cache / on my box it is fast nuff */
-	XFlush(dpy);
 }
 
 static void buttonCallback(void *self, void *clientData)
@@ -1092,6 +1305,10 @@ Bool wIconChooserDialog(WScreen *scr, char **file, const char *instance, const c
 
 	result = panel->result;
 
+	stopListingPixmaps(panel);
+	if (panel->iconDir)
+		wfree(panel->iconDir);
+
 	WMReleaseFont(panel->normalfont);
 
 	WMUnmapWidget(panel->win);
@@ -3203,15 +3203,15 @@ WAppIcon *wDockFindIconForWindow(WDock *dock, Window window)
 void wDockTrackWindowLaunch(WDock *dock, Window window)
 {
 	WAppIcon *icon;
-	char *wm_class, *wm_instance;
+	const char *wm_class, *wm_instance;
 	int i;
 	Bool firstPass = True;
 	Bool found = False;
 	char *command = NULL;
 
 	if (!PropGetWMClass(window, &wm_class, &wm_instance)) {
-		free(wm_class);
-		free(wm_instance);
+		WMReleaseInternedString(wm_class);
+		WMReleaseInternedString(wm_instance);
 		return;
 	}
 
@@ -3231,10 +3231,11 @@ void wDockTrackWindowLaunch(WDock *dock, Window window)
 		if ((icon->wm_instance || icon->wm_class)
 		    && (icon->launching || !icon->running)) {
 
-			if (icon->wm_instance && wm_instance && strcmp(icon->wm_instance, wm_instance) != 0)
+			/* the names are interned, so they can be compared directly */
+			if (icon->wm_instance && wm_instance && icon->wm_instance != wm_instance)
 				continue;
 
-			if (icon->wm_class && wm_class && strcmp(icon->wm_class, wm_class) != 0)
+			if (icon->wm_class && wm_class && icon->wm_class != wm_class)
 				continue;
 
 			if (firstPass && command && strcmp(icon->command, command) != 0)
@@ -3291,10 +3292,8 @@ void wDockTrackWindowLaunch(WDock *dock, Window window)
 	if (command)
 		wfree(command);
 
-	if (wm_class)
-		free(wm_class);
-	if (wm_instance)
-		free(wm_instance);
+	WMReleaseInternedString(wm_class);
+	WMReleaseInternedString(wm_instance);
 }
 
 void wClipUpdateForWorkspaceChange(WScreen *scr, int workspace)
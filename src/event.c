@@ -79,6 +79,7 @@
 #include "winmenu.h"
 #include "switchmenu.h"
 #include "wsmap.h"
+#include "stats.h"
 
 
 #define MOD_MASK wPreferences.modifier_mask
@@ -1003,6 +1004,7 @@ static void handleClientMessage(XEvent * event)
 		}
 	} else if (event->xclient.message_type == w_global.atom.wmaker.command) {
 
+		WScreen *scr;
 		char *command;
 		size_t len;
 
@@ -1013,6 +1015,10 @@ static void handleClientMessage(XEvent * event)
 		if (strncmp(command, "Reconfigure", sizeof("Reconfigure")) == 0) {
 			wwarning(_("Got Reconfigure command"));
 			wDefaultsCheckDomains(NULL);
+		} else if (strncmp(command, "DumpStats", sizeof("DumpStats")) == 0) {
+			scr = wScreenForRootWindow(event->xclient.window);
+			if (scr)
+				wStatsDump(scr);
 		} else {
 			wwarning(_("Got unknown command %s"), command);
 		}
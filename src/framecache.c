@@ -0,0 +1,209 @@
+/* framecache.c - pixmaps rendered for the window frames, shared
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "wconfig.h"
+
+#include <stdint.h>
+
+#include <X11/Xlib.h>
+
+#include "WindowMaker.h"
+#include "screen.h"
+#include "texture.h"
+#include "stats.h"
+#include "framecache.h"
+
+/*
+ * Windows of the same width with the same textures get the very same
+ * titlebar and resizebar, so the pixmaps are rendered once and shared by
+ * all of them. Pixmaps that are not used anymore are kept, as the next
+ * window is often of a size seen before, until the cache grows over
+ * FRAME_CACHE_BUDGET bytes; then the least recently released go first.
+ * The pixmaps in use always stay.
+ */
+
+#define FRAME_CACHE_BUDGET	(8 * 1024 * 1024)
+
+struct WFrameCache {
+	WMHashTable *table;		/* WFrameCacheKey -> WFramePixmaps */
+	WFramePixmaps *oldest, *newest;	/* the unused pixmaps */
+	size_t bytes;			/* of all the pixmaps, in use or not */
+};
+
+static unsigned hashKey(const void *data)
+{
+	const WFrameCacheKey *key = data;
+	unsigned hash;
+
+	hash = (unsigned)((uintptr_t)key->texture >> 3);
+	hash = hash * 31 + key->kind;
+	hash = hash * 31 + key->style;
+	hash = hash * 31 + key->width;
+	hash = hash * 31 + key->height;
+	hash = hash * 31 + key->bsize;
+	hash = hash * 31 + key->buttons;
+
+	return hash;
+}
+
+static Bool isSameKey(const void *a, const void *b)
+{
+	const WFrameCacheKey *ka = a, *kb = b;
+
+	return ka->texture == kb->texture && ka->kind == kb->kind && ka->style == kb->style
+	    && ka->width == kb->width && ka->height == kb->height && ka->bsize == kb->bsize
+	    && ka->buttons == kb->buttons;
+}
+
+static const WMHashTableCallbacks keyCallbacks = {
+	hashKey, isSameKey, NULL, NULL
+};
+
+WFrameCache *wFrameCacheCreate(void)
+{
+	WFrameCache *cache;
+
+	cache = wmalloc(sizeof(WFrameCache));
+	cache->table = WMCreateHashTable(keyCallbacks);
+
+	return cache;
+}
+
+static void unlinkUnused(WFrameCache *cache, WFramePixmaps *pixmaps)
+{
+	if (pixmaps->prev)
+		pixmaps->prev->next = pixmaps->next;
+	else
+		cache->oldest = pixmaps->next;
+	if (pixmaps->next)
+		pixmaps->next->prev = pixmaps->prev;
+	else
+		cache->newest = pixmaps->prev;
+	pixmaps->prev = pixmaps->next = NULL;
+}
+
+static void freePixmaps(WFrameCache *cache, WFramePixmaps *pixmaps)
+{
+	if (!pixmaps->flushed)
+		WMHashRemove(cache->table, &pixmaps->key);
+	cache->bytes -= pixmaps->bytes;
+
+	FREE_PIXMAP(pixmaps->title);
+	FREE_PIXMAP(pixmaps->lbutton);
+	FREE_PIXMAP(pixmaps->rbutton);
+	FREE_PIXMAP(pixmaps->languagebutton);
+	wfree(pixmaps);
+}
+
+static void trimCache(WFrameCache *cache)
+{
+	while (cache->bytes > FRAME_CACHE_BUDGET && cache->oldest) {
+		WFramePixmaps *pixmaps = cache->oldest;
+
+		unlinkUnused(cache, pixmaps);
+		freePixmaps(cache, pixmaps);
+	}
+}
+
+WFramePixmaps *wFrameCacheGet(WScreen *scr, const WFrameCacheKey *key)
+{
+	WFrameCache *cache = scr->frame_cache;
+	WFramePixmaps *pixmaps;
+
+	pixmaps = WMHashGet(cache->table, key);
+	wStatsAddFrameCacheLookup(pixmaps != NULL);
+	if (!pixmaps)
+		return NULL;
+
+	if (pixmaps->refCount == 0)
+		unlinkUnused(cache, pixmaps);
+	pixmaps->refCount++;
+
+	return pixmaps;
+}
+
+WFramePixmaps *wFrameCacheAdd(WScreen *scr, const WFrameCacheKey *key, Pixmap title,
+			      Pixmap lbutton, Pixmap rbutton, Pixmap languagebutton)
+{
+	WFrameCache *cache = scr->frame_cache;
+	WFramePixmaps *pixmaps;
+
+	pixmaps = wmalloc(sizeof(WFramePixmaps));
+	pixmaps->key = *key;
+	pixmaps->title = title;
+	pixmaps->lbutton = lbutton;
+	pixmaps->rbutton = rbutton;
+	pixmaps->languagebutton = languagebutton;
+	pixmaps->refCount = 1;
+
+	/* the buttons are cut out of the width of the titlebar */
+	pixmaps->bytes = (size_t) key->width * key->height
+	    * (scr->w_depth > 16 ? 4 : (scr->w_depth > 8 ? 2 : 1));
+	cache->bytes += pixmaps->bytes;
+
+	WMHashInsert(cache->table, &pixmaps->key, pixmaps);
+
+	trimCache(cache);
+
+	return pixmaps;
+}
+
+void wFrameCacheRelease(WScreen *scr, WFramePixmaps *pixmaps)
+{
+	WFrameCache *cache = scr->frame_cache;
+
+	if (--pixmaps->refCount > 0)
+		return;
+
+	if (pixmaps->flushed) {
+		freePixmaps(cache, pixmaps);
+		return;
+	}
+
+	pixmaps->prev = cache->newest;
+	pixmaps->next = NULL;
+	if (cache->newest)
+		cache->newest->next = pixmaps;
+	else
+		cache->oldest = pixmaps;
+	cache->newest = pixmaps;
+
+	trimCache(cache);
+}
+
+void wFrameCacheFlush(WScreen *scr)
+{
+	WFrameCache *cache = scr->frame_cache;
+	WMHashEnumerator e;
+	WFramePixmaps *pixmaps;
+
+	while (cache->oldest) {
+		pixmaps = cache->oldest;
+		unlinkUnused(cache, pixmaps);
+		freePixmaps(cache, pixmaps);
+	}
+
+	/* what is left is in use, maybe with textures that are gone */
+	e = WMEnumerateHashTable(cache->table);
+	while ((pixmaps = WMNextHashEnumeratorItem(&e)))
+		pixmaps->flushed = True;
+	WMResetHashTable(cache->table);
+}
@@ -0,0 +1,91 @@
+/* framecache.h - pixmaps rendered for the window frames, shared
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef WMFRAMECACHE_H
+#define WMFRAMECACHE_H
+
+#include "screen.h"
+
+typedef struct WFrameCache WFrameCache;
+
+typedef enum {
+	WFC_TITLEBAR,
+	WFC_RESIZEBAR
+} WFrameCacheKind;
+
+/* the buttons cut out of a titlebar */
+#define WFC_LEFT_BUTTON		(1 << 0)
+#define WFC_LANGUAGE_BUTTON	(1 << 1)
+#define WFC_RIGHT_BUTTON	(1 << 2)
+
+/* what the pixmaps were rendered for */
+typedef struct WFrameCacheKey {
+	union WTexture *texture;	/* there is one per state */
+	WFrameCacheKind kind;
+	int style;			/* the titlebar style */
+	int width, height;
+	int bsize;			/* the button size, or the resizebar corner width */
+	unsigned int buttons;		/* WFC_*_BUTTON */
+} WFrameCacheKey;
+
+typedef struct WFramePixmaps {
+	WFrameCacheKey key;
+
+	Pixmap title;			/* or the resizebar */
+	Pixmap lbutton;
+	Pixmap rbutton;
+	Pixmap languagebutton;
+
+	/* private */
+	size_t bytes;
+	int refCount;
+	Bool flushed;			/* only kept until released */
+	struct WFramePixmaps *prev, *next;	/* unused ones, oldest first */
+} WFramePixmaps;
+
+WFrameCache *wFrameCacheCreate(void);
+
+/*
+ * Returns the pixmaps rendered for the key with one more reference,
+ * or NULL if they have to be rendered and given to wFrameCacheAdd().
+ */
+WFramePixmaps *wFrameCacheGet(WScreen *scr, const WFrameCacheKey *key);
+
+/*
+ * Keeps freshly rendered pixmaps, which now belong to the cache, and
+ * returns them with one reference.
+ */
+WFramePixmaps *wFrameCacheAdd(WScreen *scr, const WFrameCacheKey *key, Pixmap title,
+			      Pixmap lbutton, Pixmap rbutton, Pixmap languagebutton);
+
+/*
+ * Drops a reference. The pixmaps nobody uses are kept for a while, and
+ * freed oldest first when the cache goes over its size.
+ */
+void wFrameCacheRelease(WScreen *scr, WFramePixmaps *pixmaps);
+
+/*
+ * Forgets everything rendered so far, to be called when the textures
+ * change. The pixmaps still in use are freed when they are released.
+ */
+void wFrameCacheFlush(WScreen *scr);
+
+#endif  /* WMFRAMECACHE_H */
@@ -0,0 +1,346 @@
+/* framegrid.c - spatial index of the window frames of a workspace
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "wconfig.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+
+#include "WindowMaker.h"
+#include "screen.h"
+#include "framewin.h"
+#include "window.h"
+#include "workspace.h"
+#include "framegrid.h"
+
+/*
+ * The screen is cut in square cells and every cell lists the frames that
+ * cross it, so looking for the windows around some rectangle only has to
+ * look at the cells it covers instead of every window. Frames that go
+ * off the screen are counted in the cells of the border.
+ *
+ * The windows are also kept sorted by each of their edges, for the edge
+ * resistance of interactive moves. A window that moves is taken out of
+ * the lists and put back in place, so they never have to be sorted again.
+ */
+
+#define GRID_CELL_SIZE	256
+
+struct WFrameGrid {
+	int columns, rows;
+	WMArray **cells;	/* created when something is put in them */
+	WMArray *windows;	/* every window in the grid */
+
+	WWindow **edges[WGE_COUNT];	/* the windows sorted by each edge */
+	int edgeCount;
+	int edgeSize;
+};
+
+/* tells which windows a query already returned */
+static unsigned int queryStamp = 0;
+
+
+WFrameGrid *wFrameGridCreate(WScreen *scr)
+{
+	WFrameGrid *grid;
+
+	grid = wmalloc(sizeof(WFrameGrid));
+	grid->columns = WMAX(1, (scr->scr_width + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE);
+	grid->rows = WMAX(1, (scr->scr_height + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE);
+	grid->cells = wmalloc(grid->columns * grid->rows * sizeof(WMArray *));
+	grid->windows = WMCreateArray(16);
+
+	return grid;
+}
+
+void wFrameGridDestroy(WFrameGrid *grid)
+{
+	WMArrayIterator iter;
+	WWindow *wwin;
+	int i;
+
+	WM_ITERATE_ARRAY(grid->windows, wwin, iter)
+		wwin->grid.grid = NULL;
+	WMFreeArray(grid->windows);
+
+	for (i = 0; i < WGE_COUNT; i++) {
+		if (grid->edges[i])
+			wfree(grid->edges[i]);
+	}
+	for (i = 0; i < grid->columns * grid->rows; i++) {
+		if (grid->cells[i])
+			WMFreeArray(grid->cells[i]);
+	}
+	wfree(grid->cells);
+	wfree(grid);
+}
+
+static int cellOf(int coord, int count)
+{
+	if (coord < 0)
+		return 0;
+	return WMIN(coord / GRID_CELL_SIZE, count - 1);
+}
+
+/* the rectangle the frame takes, border included */
+static void getFrameRect(WWindow *wwin, int *x, int *y, int *width, int *height)
+{
+	int border = 2 * wwin->screen_ptr->frame_border_width;
+
+	*x = wwin->frame_x;
+	*y = wwin->frame_y;
+	*width = wwin->frame->core->width + border;
+	*height = wwin->frame->core->height + border;
+}
+
+/* the same edges the move resistance uses */
+static void getFrameEdges(WWindow *wwin, int *edges)
+{
+	int border = 0;
+
+	if (wwin->flags.selected || HAS_BORDER(wwin))
+		border = 2 * wwin->screen_ptr->frame_border_width;
+
+	edges[WGE_TOP] = wwin->frame_y;
+	edges[WGE_LEFT] = wwin->frame_x;
+	edges[WGE_RIGHT] = wwin->frame_x + (int)wwin->frame->core->width - 1 + border;
+	edges[WGE_BOTTOM] = wwin->frame_y + (int)wwin->frame->core->height - 1 + border;
+}
+
+/* index of the first window in the list whose edge is not below value */
+static int findEdge(WFrameGrid *grid, int edge, int value)
+{
+	WWindow **list = grid->edges[edge];
+	int low = 0, high = grid->edgeCount, mid;
+
+	while (low < high) {
+		mid = (low + high) / 2;
+		if (list[mid]->grid.edges[edge] < value)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+static void removeEdges(WFrameGrid *grid, WWindow *wwin)
+{
+	int e, i;
+
+	for (e = 0; e < WGE_COUNT; e++) {
+		WWindow **list = grid->edges[e];
+
+		for (i = findEdge(grid, e, wwin->grid.edges[e]); list[i] != wwin; i++)
+			;
+		memmove(&list[i], &list[i + 1], (grid->edgeCount - i - 1) * sizeof(WWindow *));
+	}
+	grid->edgeCount--;
+}
+
+static void insertEdges(WFrameGrid *grid, WWindow *wwin)
+{
+	int e, i;
+
+	if (grid->edgeCount == grid->edgeSize) {
+		grid->edgeSize = grid->edgeSize ? grid->edgeSize * 2 : 16;
+		for (e = 0; e < WGE_COUNT; e++)
+			grid->edges[e] = wrealloc(grid->edges[e], grid->edgeSize * sizeof(WWindow *));
+	}
+
+	for (e = 0; e < WGE_COUNT; e++) {
+		WWindow **list = grid->edges[e];
+
+		/* after the windows with the same edge */
+		i = findEdge(grid, e, wwin->grid.edges[e] + 1);
+		memmove(&list[i + 1], &list[i], (grid->edgeCount - i) * sizeof(WWindow *));
+		list[i] = wwin;
+	}
+	grid->edgeCount++;
+}
+
+static void removeCells(WFrameGrid *grid, WWindow *wwin)
+{
+	int i, j;
+
+	for (j = wwin->grid.y1; j <= wwin->grid.y2; j++) {
+		for (i = wwin->grid.x1; i <= wwin->grid.x2; i++)
+			WMRemoveFromArray(grid->cells[j * grid->columns + i], wwin);
+	}
+}
+
+static void insertCells(WFrameGrid *grid, WWindow *wwin)
+{
+	int i, j;
+
+	for (j = wwin->grid.y1; j <= wwin->grid.y2; j++) {
+		for (i = wwin->grid.x1; i <= wwin->grid.x2; i++) {
+			WMArray **cell = &grid->cells[j * grid->columns + i];
+
+			if (!*cell)
+				*cell = WMCreateArray(8);
+			WMAddToArray(*cell, wwin);
+		}
+	}
+}
+
+void wFrameGridRemove(WWindow *wwin)
+{
+	WFrameGrid *grid = wwin->grid.grid;
+
+	if (!grid)
+		return;
+
+	removeCells(grid, wwin);
+	removeEdges(grid, wwin);
+	WMRemoveFromArray(grid->windows, wwin);
+	wwin->grid.grid = NULL;
+}
+
+void wFrameGridUpdate(WWindow *wwin)
+{
+	WScreen *scr = wwin->screen_ptr;
+	WFrameGrid *grid;
+	int x, y, width, height;
+	int x1, y1, x2, y2;
+	int edges[WGE_COUNT];
+
+	if (!wwin->frame || wwin->frame->workspace < 0 || wwin->frame->workspace >= scr->workspace_count
+	    || !scr->workspaces[wwin->frame->workspace]->grid) {
+		wFrameGridRemove(wwin);
+		return;
+	}
+
+	grid = scr->workspaces[wwin->frame->workspace]->grid;
+	getFrameRect(wwin, &x, &y, &width, &height);
+	x1 = cellOf(x, grid->columns);
+	y1 = cellOf(y, grid->rows);
+	x2 = cellOf(x + width - 1, grid->columns);
+	y2 = cellOf(y + height - 1, grid->rows);
+	getFrameEdges(wwin, edges);
+
+	if (wwin->grid.grid != grid) {
+		wFrameGridRemove(wwin);
+		WMAddToArray(grid->windows, wwin);
+		wwin->grid.grid = grid;
+	} else {
+		Bool sameCells = (wwin->grid.x1 == x1 && wwin->grid.y1 == y1
+				  && wwin->grid.x2 == x2 && wwin->grid.y2 == y2);
+		Bool sameEdges = (memcmp(wwin->grid.edges, edges, sizeof(edges)) == 0);
+
+		if (sameCells && sameEdges)
+			return;
+
+		if (sameCells) {
+			removeEdges(grid, wwin);
+			memcpy(wwin->grid.edges, edges, sizeof(edges));
+			insertEdges(grid, wwin);
+			return;
+		}
+		removeCells(grid, wwin);
+		removeEdges(grid, wwin);
+	}
+
+	wwin->grid.x1 = x1;
+	wwin->grid.y1 = y1;
+	wwin->grid.x2 = x2;
+	wwin->grid.y2 = y2;
+	memcpy(wwin->grid.edges, edges, sizeof(edges));
+
+	insertCells(grid, wwin);
+	insertEdges(grid, wwin);
+}
+
+void wFrameGridQuery(WScreen *scr, int workspace, int x, int y, int width, int height, WMArray *list)
+{
+	WFrameGrid *grid;
+	WMArrayIterator iter;
+	WWindow *wwin;
+	int x1, y1, x2, y2;
+	int i, j;
+
+	if (workspace < 0 || workspace >= scr->workspace_count || width <= 0 || height <= 0)
+		return;
+	grid = scr->workspaces[workspace]->grid;
+	if (!grid)
+		return;
+
+	if (++queryStamp == 0) {
+		/* wrapped around, forget the old stamps */
+		for (i = 0; i < scr->workspace_count; i++) {
+			if (scr->workspaces[i]->grid) {
+				WM_ITERATE_ARRAY(scr->workspaces[i]->grid->windows, wwin, iter)
+					wwin->grid.stamp = 0;
+			}
+		}
+		queryStamp = 1;
+	}
+
+	x1 = cellOf(x, grid->columns);
+	y1 = cellOf(y, grid->rows);
+	x2 = cellOf(x + width - 1, grid->columns);
+	y2 = cellOf(y + height - 1, grid->rows);
+
+	for (j = y1; j <= y2; j++) {
+		for (i = x1; i <= x2; i++) {
+			WMArray *cell = grid->cells[j * grid->columns + i];
+
+			if (!cell)
+				continue;
+
+			WM_ITERATE_ARRAY(cell, wwin, iter) {
+				int wx, wy, ww, wh;
+
+				if (wwin->grid.stamp == queryStamp)
+					continue;
+				wwin->grid.stamp = queryStamp;
+
+				getFrameRect(wwin, &wx, &wy, &ww, &wh);
+				if (wx < x + width && wx + ww > x && wy < y + height && wy + wh > y)
+					WMAddToArray(list, wwin);
+			}
+		}
+	}
+}
+
+WMArray *wFrameGridWindows(WScreen *scr, int workspace)
+{
+	if (workspace < 0 || workspace >= scr->workspace_count || !scr->workspaces[workspace]->grid)
+		return NULL;
+
+	return scr->workspaces[workspace]->grid->windows;
+}
+
+WWindow **wFrameGridEdgeList(WScreen *scr, int workspace, WFrameGridEdge edge, int *count)
+{
+	WFrameGrid *grid;
+
+	*count = 0;
+	if (workspace < 0 || workspace >= scr->workspace_count || !scr->workspaces[workspace]->grid)
+		return NULL;
+
+	grid = scr->workspaces[workspace]->grid;
+	*count = grid->edgeCount;
+
+	return grid->edges[edge];
+}
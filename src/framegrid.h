@@ -0,0 +1,71 @@
+/* framegrid.h - spatial index of the window frames of a workspace
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef WMFRAMEGRID_H
+#define WMFRAMEGRID_H
+
+#include "window.h"
+
+typedef struct WFrameGrid WFrameGrid;
+
+/* the edges the windows of a workspace are kept sorted by */
+typedef enum {
+	WGE_TOP,		/* the first line of the frame */
+	WGE_LEFT,		/* the first column of the frame */
+	WGE_RIGHT,		/* the last column, border included */
+	WGE_BOTTOM,		/* the last line, border included */
+
+	WGE_COUNT
+} WFrameGridEdge;
+
+WFrameGrid *wFrameGridCreate(WScreen *scr);
+
+/* Destroys the grid, the windows in it are left out of any grid */
+void wFrameGridDestroy(WFrameGrid *grid);
+
+/*
+ * Puts the frame of the window in the grid of its workspace, or moves it
+ * there if its geometry or workspace changed. Must be called whenever the
+ * frame is moved, resized, selected or sent to another workspace.
+ */
+void wFrameGridUpdate(WWindow *wwin);
+
+void wFrameGridRemove(WWindow *wwin);
+
+/*
+ * Adds to list the windows of the workspace whose frames, borders
+ * included, intersect the rectangle. Whether they are mapped, hidden
+ * or sunken is for the caller to check.
+ */
+void wFrameGridQuery(WScreen *scr, int workspace, int x, int y, int width, int height, WMArray *list);
+
+/* Returns all the windows of the workspace, the array must not be changed */
+WMArray *wFrameGridWindows(WScreen *scr, int workspace);
+
+/*
+ * Returns the windows of the workspace sorted by the position of the
+ * given edge, lowest first. The position of the edge of a window is in
+ * wwin->grid.edges[edge]. The list must not be changed and is only
+ * valid until the next window of the workspace moves.
+ */
+WWindow **wFrameGridEdgeList(WScreen *scr, int workspace, WFrameGridEdge edge, int *count);
+
+#endif  /* WMFRAMEGRID_H */
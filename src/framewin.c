@@ -42,6 +42,9 @@
 #include "stacking.h"
 #include "misc.h"
 #include "event.h"
+#include "stats.h"
+#include "framecache.h"
+#include "xrender.h"
 
 
 static void handleExpose(WObjDescriptor * desc, XEvent * event);
@@ -73,6 +76,30 @@ static void allocFrameBorderPixel(Colormap colormap, const char *color_name, uns
 		**pixel = xcol.pixel;
 }
 
+/* the titlebar pixmaps are shared with the other frames, see framecache.c */
+static void releaseTitlebarPixmaps(WFrameWindow *fwin, int state)
+{
+	if (fwin->title_pixmaps[state]) {
+		wFrameCacheRelease(fwin->screen_ptr, fwin->title_pixmaps[state]);
+		fwin->title_pixmaps[state] = NULL;
+	}
+	fwin->title_back[state] = None;
+	fwin->lbutton_back[state] = None;
+	fwin->rbutton_back[state] = None;
+#ifdef XKB_BUTTON_HINT
+	fwin->languagebutton_back[state] = None;
+#endif
+}
+
+static void releaseResizebarPixmaps(WFrameWindow *fwin)
+{
+	if (fwin->resizebar_pixmaps) {
+		wFrameCacheRelease(fwin->screen_ptr, fwin->resizebar_pixmaps);
+		fwin->resizebar_pixmaps = NULL;
+	}
+	fwin->resizebar_back[0] = None;
+}
+
 WFrameWindow *wFrameWindowCreate(WScreen * scr, int wlevel, int x, int y,
 				 int width, int height, int *clearance,
 				 int *title_min, int *title_max, int flags,
@@ -195,16 +222,8 @@ void wFrameWindowUpdateBorders(WFrameWindow * fwin, int flags)
 			updateTitlebar(fwin);
 		} else {
 			/* we had a titlebar, but now we don't need it anymore */
-			for (i = 0; i < (fwin->flags.single_texture ? 1 : 3); i++) {
-				FREE_PIXMAP(fwin->title_back[i]);
-				if (wPreferences.new_style == TS_NEW) {
-					FREE_PIXMAP(fwin->lbutton_back[i]);
-					FREE_PIXMAP(fwin->rbutton_back[i]);
-#ifdef XKB_BUTTON_HINT
-					FREE_PIXMAP(fwin->languagebutton_back[i]);
-#endif
-				}
-			}
+			for (i = 0; i < 3; i++)
+				releaseTitlebarPixmaps(fwin, i);
 			if (fwin->left_button)
 				wCoreDestroy(fwin->left_button);
 			fwin->left_button = NULL;
@@ -361,6 +380,7 @@ void wFrameWindowUpdateBorders(WFrameWindow * fwin, int flags)
 			fwin->bottom_width = 0;
 			wCoreDestroy(fwin->resizebar);
 			fwin->resizebar = NULL;
+			releaseResizebarPixmaps(fwin);
 		}
 	}
 
@@ -458,17 +478,11 @@ void wFrameWindowDestroy(WFrameWindow * fwin)
 
 	if (fwin->title)
 		wfree(fwin->title);
+	WMFreeTruncationCache(&fwin->title_cache);
 
-	for (i = 0; i < (fwin->flags.single_texture ? 1 : 3); i++) {
-		FREE_PIXMAP(fwin->title_back[i]);
-		if (wPreferences.new_style == TS_NEW) {
-			FREE_PIXMAP(fwin->lbutton_back[i]);
-#ifdef XKB_BUTTON_HINT
-			FREE_PIXMAP(fwin->languagebutton_back[i]);
-#endif
-			FREE_PIXMAP(fwin->rbutton_back[i]);
-		}
-	}
+	for (i = 0; i < 3; i++)
+		releaseTitlebarPixmaps(fwin, i);
+	releaseResizebarPixmaps(fwin);
 
 	wfree(fwin);
 }
@@ -631,6 +645,53 @@ void wFrameWindowShowButton(WFrameWindow * fwin, int flags)
 	}
 }
 
+#ifdef USE_XRENDER
+static Pixmap copyServerTexture(WScreen *scr, Picture texture, int x, int width, int height)
+{
+	Pixmap pixmap;
+
+	pixmap = wXRenderCopyTexture(scr, texture, x, 0, width, height, WREL_RAISED, NULL);
+	wStatsAddPixmap(WSTATS_FRAME, pixmap, width, height, scr->w_depth);
+
+	return pixmap;
+}
+
+/* the same as renderTexture(), with the texture drawn by the server */
+static void
+renderServerTexture(WScreen *scr, Picture texture, int width, int height,
+		    int bwidth, int left, int language, int right,
+		    Pixmap *title, Pixmap *lbutton, Pixmap *languagebutton, Pixmap *rbutton)
+{
+	int x, w;
+
+	if (wPreferences.new_style != TS_NEW) {
+		*title = copyServerTexture(scr, texture, 0, width, height);
+		return;
+	}
+
+	x = 0;
+	w = width;
+
+	if (left) {
+		*lbutton = copyServerTexture(scr, texture, 0, bwidth, height);
+		x += bwidth;
+		w -= bwidth;
+	}
+	if (language) {
+		*languagebutton = copyServerTexture(scr, texture, bwidth * left, bwidth, height);
+		x += bwidth;
+		w -= bwidth;
+	}
+	if (right) {
+		*rbutton = copyServerTexture(scr, texture, width - bwidth, bwidth, height);
+		w -= bwidth;
+	}
+
+	if (w > 0)
+		*title = copyServerTexture(scr, texture, x, w, height);
+}
+#endif
+
 static void
 #ifdef XKB_BUTTON_HINT
 renderTexture(WScreen * scr, WTexture * texture, int width, int height,
@@ -647,6 +708,9 @@ renderTexture(WScreen * scr, WTexture * texture, int width, int height,
 	RImage *timg;
 #endif
 	int x, w;
+#ifdef USE_XRENDER
+	Picture picture;
+#endif
 
 	*title = None;
 	*lbutton = None;
@@ -655,6 +719,21 @@ renderTexture(WScreen * scr, WTexture * texture, int width, int height,
 	*languagebutton = None;
 #endif
 
+#ifdef USE_XRENDER
+	picture = wXRenderCreateTexture(scr, texture, width, height);
+	if (picture != None) {
+#ifdef XKB_BUTTON_HINT
+		renderServerTexture(scr, picture, width, height, bwidth, left, language, right,
+				    title, lbutton, languagebutton, rbutton);
+#else
+		renderServerTexture(scr, picture, width, height, bwidth, left, 0, right,
+				    title, lbutton, NULL, rbutton);
+#endif
+		XRenderFreePicture(dpy, picture);
+		return;
+	}
+#endif
+
 	img = wTextureRenderImage(texture, width, height, WREL_FLAT);
 	if (!img) {
 		wwarning(_("could not render texture: %s"), RMessageForError(RErrorCode));
@@ -681,6 +760,8 @@ renderTexture(WScreen * scr, WTexture * texture, int width, int height,
 			RBevelImage(limg, RBEV_RAISED2);
 			if (!RConvertImage(scr->rcontext, limg, lbutton))
 				wwarning(_("error rendering image:%s"), RMessageForError(RErrorCode));
+			else
+				wStatsAddPixmap(WSTATS_FRAME, *lbutton, limg->width, limg->height, scr->w_depth);
 
 			x += limg->width;
 			w -= limg->width;
@@ -691,6 +772,8 @@ renderTexture(WScreen * scr, WTexture * texture, int width, int height,
 			RBevelImage(timg, RBEV_RAISED2);
 			if (!RConvertImage(scr->rcontext, timg, languagebutton))
 				wwarning(_("error rendering image:%s"), RMessageForError(RErrorCode));
+			else
+				wStatsAddPixmap(WSTATS_FRAME, *languagebutton, timg->width, timg->height, scr->w_depth);
 
 			x += timg->width;
 			w -= timg->width;
@@ -707,6 +790,8 @@ renderTexture(WScreen * scr, WTexture * texture, int width, int height,
 			RBevelImage(rimg, RBEV_RAISED2);
 			if (!RConvertImage(scr->rcontext, rimg, rbutton))
 				wwarning(_("error rendering image:%s"), RMessageForError(RErrorCode));
+			else
+				wStatsAddPixmap(WSTATS_FRAME, *rbutton, rimg->width, rimg->height, scr->w_depth);
 
 			w -= rimg->width;
 			RReleaseImage(rimg);
@@ -718,6 +803,8 @@ renderTexture(WScreen * scr, WTexture * texture, int width, int height,
 
 			if (!RConvertImage(scr->rcontext, mimg, title))
 				wwarning(_("error rendering image:%s"), RMessageForError(RErrorCode));
+			else
+				wStatsAddPixmap(WSTATS_FRAME, *title, mimg->width, mimg->height, scr->w_depth);
 
 			RReleaseImage(mimg);
 		} else {
@@ -725,17 +812,67 @@ renderTexture(WScreen * scr, WTexture * texture, int width, int height,
 
 			if (!RConvertImage(scr->rcontext, img, title))
 				wwarning(_("error rendering image:%s"), RMessageForError(RErrorCode));
+			else
+				wStatsAddPixmap(WSTATS_FRAME, *title, img->width, img->height, scr->w_depth);
 		}
 	} else {
 		RBevelImage(img, RBEV_RAISED2);
 
 		if (!RConvertImage(scr->rcontext, img, title))
 			wwarning(_("error rendering image:%s"), RMessageForError(RErrorCode));
+		else
+			wStatsAddPixmap(WSTATS_FRAME, *title, img->width, img->height, scr->w_depth);
 	}
 
 	RReleaseImage(img);
 }
 
+#ifdef USE_XRENDER
+/* the same as renderResizebarTexture(), with the texture drawn by the server */
+static Bool renderServerResizebar(WScreen *scr, WTexture *texture, int width, int height, int cwidth,
+				  Pixmap *pmap)
+{
+	Picture gradient, picture;
+	RColor light;
+	RColor dark;
+
+	gradient = wXRenderCreateTexture(scr, texture, width, height);
+	if (gradient == None)
+		return False;
+
+	*pmap = wXRenderCopyTexture(scr, gradient, 0, 0, width, height, WREL_FLAT, &picture);
+	XRenderFreePicture(dpy, gradient);
+
+	light.alpha = 0;
+	light.red = light.green = light.blue = 80;
+
+	dark.alpha = 0;
+	dark.red = dark.green = dark.blue = 40;
+
+	wXRenderOperateLine(picture, RSubtractOperation, 0, 0, width - 1, 0, &dark);
+	wXRenderOperateLine(picture, RAddOperation, 0, 1, width - 1, 1, &light);
+
+	wXRenderOperateLine(picture, RSubtractOperation, cwidth, 2, cwidth, height - 1, &dark);
+	wXRenderOperateLine(picture, RAddOperation, cwidth + 1, 2, cwidth + 1, height - 1, &light);
+
+	if (width > 1)
+		wXRenderOperateLine(picture, RSubtractOperation, width - cwidth - 2, 2,
+				    width - cwidth - 2, height - 1, &dark);
+	wXRenderOperateLine(picture, RAddOperation, width - cwidth - 1, 2, width - cwidth - 1, height - 1, &light);
+
+#ifdef SHADOW_RESIZEBAR
+	wXRenderOperateLine(picture, RAddOperation, 0, 1, 0, height - 1, &light);
+	wXRenderOperateLine(picture, RSubtractOperation, width - 1, 1, width - 1, height - 1, &dark);
+	wXRenderOperateLine(picture, RSubtractOperation, 0, height - 1, width - 1, height - 1, &dark);
+#endif				/* SHADOW_RESIZEBAR */
+
+	XRenderFreePicture(dpy, picture);
+	wStatsAddPixmap(WSTATS_FRAME, *pmap, width, height, scr->w_depth);
+
+	return True;
+}
+#endif
+
 static void
 renderResizebarTexture(WScreen * scr, WTexture * texture, int width, int height, int cwidth, Pixmap * pmap)
 {
@@ -745,6 +882,11 @@ renderResizebarTexture(WScreen * scr, WTexture * texture, int width, int height,
 
 	*pmap = None;
 
+#ifdef USE_XRENDER
+	if (renderServerResizebar(scr, texture, width, height, cwidth, pmap))
+		return;
+#endif
+
 	img = wTextureRenderImage(texture, width, height, WREL_FLAT);
 	if (!img) {
 		wwarning(_("could not render texture: %s"), RMessageForError(RErrorCode));
@@ -776,6 +918,8 @@ renderResizebarTexture(WScreen * scr, WTexture * texture, int width, int height,
 
 	if (!RConvertImage(scr->rcontext, img, pmap))
 		wwarning(_("error rendering image: %s"), RMessageForError(RErrorCode));
+	else
+		wStatsAddPixmap(WSTATS_FRAME, *pmap, img->width, img->height, scr->w_depth);
 
 	RReleaseImage(img);
 }
@@ -839,20 +983,14 @@ static void updateTexture(WFrameWindow * fwin)
 
 static void remakeTexture(WFrameWindow * fwin, int state)
 {
+	WScreen *scr = fwin->screen_ptr;
+	WFrameCacheKey key;
+	WFramePixmaps *pixmaps;
 	Pixmap pmap, lpmap, rpmap;
-#ifdef XKB_BUTTON_HINT
-	Pixmap tpmap;
-#endif
+	Pixmap tpmap = None;
 
 	if (fwin->title_texture[state] && fwin->titlebar) {
-		FREE_PIXMAP(fwin->title_back[state]);
-		if (wPreferences.new_style == TS_NEW) {
-			FREE_PIXMAP(fwin->lbutton_back[state]);
-			FREE_PIXMAP(fwin->rbutton_back[state]);
-#ifdef XKB_BUTTON_HINT
-			FREE_PIXMAP(fwin->languagebutton_back[state]);
-#endif
-		}
+		releaseTitlebarPixmaps(fwin, state);
 
 		if (fwin->title_texture[state]->any.type != WTEX_SOLID) {
 			int left, right;
@@ -872,41 +1010,74 @@ static void remakeTexture(WFrameWindow * fwin, int state)
 
 			width = fwin->core->width + 1;
 
+			key.texture = fwin->title_texture[state];
+			key.kind = WFC_TITLEBAR;
+			key.style = wPreferences.new_style;
+			key.width = width;
+			key.height = fwin->titlebar->height;
+			key.bsize = fwin->titlebar->height;
+			key.buttons = 0;
+			/* only the new style has the buttons in the texture */
+			if (wPreferences.new_style == TS_NEW) {
+				if (left)
+					key.buttons |= WFC_LEFT_BUTTON;
 #ifdef XKB_BUTTON_HINT
-			renderTexture(fwin->screen_ptr, fwin->title_texture[state],
-				      width, fwin->titlebar->height,
-				      fwin->titlebar->height, fwin->titlebar->height,
-				      left, language, right, &pmap, &lpmap, &tpmap, &rpmap);
-#else
-			renderTexture(fwin->screen_ptr, fwin->title_texture[state],
-				      width, fwin->titlebar->height,
-				      fwin->titlebar->height, fwin->titlebar->height,
-				      left, right, &pmap, &lpmap, &rpmap);
+				if (language)
+					key.buttons |= WFC_LANGUAGE_BUTTON;
 #endif
+				if (right)
+					key.buttons |= WFC_RIGHT_BUTTON;
+			}
 
-			fwin->title_back[state] = pmap;
-			if (wPreferences.new_style == TS_NEW) {
-				fwin->lbutton_back[state] = lpmap;
-				fwin->rbutton_back[state] = rpmap;
+			pixmaps = wFrameCacheGet(scr, &key);
+			if (!pixmaps) {
 #ifdef XKB_BUTTON_HINT
-				fwin->languagebutton_back[state] = tpmap;
+				renderTexture(scr, fwin->title_texture[state],
+					      width, fwin->titlebar->height,
+					      fwin->titlebar->height, fwin->titlebar->height,
+					      left, language, right, &pmap, &lpmap, &tpmap, &rpmap);
+#else
+				renderTexture(scr, fwin->title_texture[state],
+					      width, fwin->titlebar->height,
+					      fwin->titlebar->height, fwin->titlebar->height,
+					      left, right, &pmap, &lpmap, &rpmap);
 #endif
+				pixmaps = wFrameCacheAdd(scr, &key, pmap, lpmap, rpmap, tpmap);
 			}
+
+			fwin->title_pixmaps[state] = pixmaps;
+			fwin->title_back[state] = pixmaps->title;
+			fwin->lbutton_back[state] = pixmaps->lbutton;
+			fwin->rbutton_back[state] = pixmaps->rbutton;
+#ifdef XKB_BUTTON_HINT
+			fwin->languagebutton_back[state] = pixmaps->languagebutton;
+#endif
 		}
 	}
 	if (fwin->resizebar_texture && fwin->resizebar_texture[0]
 	    && fwin->resizebar && state == 0) {
 
-		FREE_PIXMAP(fwin->resizebar_back[0]);
+		releaseResizebarPixmaps(fwin);
 
 		if (fwin->resizebar_texture[0]->any.type != WTEX_SOLID) {
+			key.texture = fwin->resizebar_texture[0];
+			key.kind = WFC_RESIZEBAR;
+			key.style = 0;
+			key.width = fwin->resizebar->width;
+			key.height = fwin->resizebar->height;
+			key.bsize = fwin->resizebar_corner_width;
+			key.buttons = 0;
+
+			pixmaps = wFrameCacheGet(scr, &key);
+			if (!pixmaps) {
+				renderResizebarTexture(scr, fwin->resizebar_texture[0],
+						       fwin->resizebar->width,
+						       fwin->resizebar->height, fwin->resizebar_corner_width, &pmap);
+				pixmaps = wFrameCacheAdd(scr, &key, pmap, None, None, None);
+			}
 
-			renderResizebarTexture(fwin->screen_ptr,
-					       fwin->resizebar_texture[0],
-					       fwin->resizebar->width,
-					       fwin->resizebar->height, fwin->resizebar_corner_width, &pmap);
-
-			fwin->resizebar_back[0] = pmap;
+			fwin->resizebar_pixmaps = pixmaps;
+			fwin->resizebar_back[0] = pixmaps->title;
 		}
 
 		/* this part should be in updateTexture() */
@@ -920,17 +1091,49 @@ static void remakeTexture(WFrameWindow * fwin, int state)
 	}
 }
 
+/* the color of the textures in place of their images, see wFrameWindowSetDraft() */
+static void paintFlat(WFrameWindow *fwin)
+{
+	if (fwin->titlebar) {
+		XSetWindowBackground(dpy, fwin->titlebar->window,
+				     fwin->title_texture[fwin->flags.state]->any.color.pixel);
+		if (!fwin->flags.repaint_only_resizebar)
+			XClearWindow(dpy, fwin->titlebar->window);
+	}
+	if (fwin->resizebar) {
+		XSetWindowBackground(dpy, fwin->resizebar->window, fwin->resizebar_texture[0]->any.color.pixel);
+		if (!fwin->flags.repaint_only_titlebar)
+			XClearWindow(dpy, fwin->resizebar->window);
+	}
+}
+
 void wFrameWindowPaint(WFrameWindow * fwin)
 {
 	WScreen *scr = fwin->screen_ptr;
+	Bool flat;
 	int state;
 
+	/*
+	 * The windows found at startup are managed with the server grabbed,
+	 * their textures are rendered once it is released.
+	 */
+	if (fwin->flags.is_client_window_frame && scr->flags.startup) {
+		fwin->flags.paint_deferred = 1;
+		return;
+	}
+	fwin->flags.paint_deferred = 0;
+
 	state = fwin->flags.state;
 
 	if (fwin->flags.is_client_window_frame)
 		fwin->flags.justification = wPreferences.title_justification;
 
-	if (fwin->flags.need_texture_remake) {
+	/* the pixmaps are of the old size, they are rendered at the end */
+	flat = fwin->flags.draft && fwin->flags.need_texture_remake;
+	if (flat)
+		paintFlat(fwin);
+
+	if (fwin->flags.need_texture_remake && !flat) {
 		int i;
 
 		fwin->flags.need_texture_remake = 0;
@@ -952,7 +1155,7 @@ void wFrameWindowPaint(WFrameWindow * fwin)
 		}
 	}
 
-	if (fwin->flags.need_texture_change) {
+	if (fwin->flags.need_texture_change && !flat) {
 		fwin->flags.need_texture_change = 0;
 
 		updateTexture(fwin);
@@ -1030,7 +1233,8 @@ void wFrameWindowPaint(WFrameWindow * fwin)
 			Drawable buf;
 			char *title;
 
-			title = ShrinkString(*fwin->font, fwin->title, fwin->titlebar->width - lofs - rofs);
+			title = WMTruncateString(*fwin->font, fwin->title, fwin->titlebar->width - lofs - rofs,
+						 WTTruncateMiddle, &fwin->title_cache);
 			titlelen = strlen(title);
 			w = WMWidthOfString(*fwin->font, title, titlelen);
 
@@ -1071,11 +1275,11 @@ void wFrameWindowPaint(WFrameWindow * fwin)
 
 			XSetClipMask(dpy, scr->copy_gc, None);
 
-			if (fwin->title_texture[state]->any.type != WTEX_SOLID) {
+			if (fwin->title_texture[state]->any.type != WTEX_SOLID && !flat) {
 				XCopyArea(dpy, fwin->title_back[state], buf, scr->copy_gc,
 					  x - 1, y, w + 2, h, 0, 0);
 			} else {
-				XSetForeground(dpy, scr->copy_gc, fwin->title_texture[state]->solid.normal.pixel);
+				XSetForeground(dpy, scr->copy_gc, fwin->title_texture[state]->any.color.pixel);
 				XFillRectangle(dpy, buf, scr->copy_gc, 0, 0, w + 2, h);
 			}
 
@@ -1101,6 +1305,16 @@ void wFrameWindowPaint(WFrameWindow * fwin)
 	}
 }
 
+void wFrameWindowSetDraft(WFrameWindow *fwin, Bool draft)
+{
+	if (fwin->flags.draft == (draft ? 1 : 0))
+		return;
+
+	fwin->flags.draft = (draft ? 1 : 0);
+	if (!draft && fwin->flags.need_texture_remake)
+		wFrameWindowPaint(fwin);
+}
+
 static void reconfigure(WFrameWindow * fwin, int x, int y, int width, int height, Bool dontMove)
 {
 	int k = (wPreferences.new_style == TS_NEW ? 4 : 3);
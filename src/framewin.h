@@ -76,6 +76,8 @@ typedef struct WFrameWindow {
 #ifdef XKB_BUTTON_HINT
     Pixmap languagebutton_back[3];
 #endif
+    struct WFramePixmaps *title_pixmaps[3]; /* where the pixmaps above come from */
+    struct WFramePixmaps *resizebar_pixmaps;
 
     WPixmap *lbutton_image;
     WPixmap *rbutton_image;
@@ -89,6 +91,7 @@ typedef struct WFrameWindow {
     WMFont **font;
 
     char *title;		       /* window name (title) */
+    WMTruncationCache title_cache;     /* title shrunk to the titlebar */
 
 #ifdef KEEP_XKB_LOCK_STATUS
     int languagemode;
@@ -147,6 +150,9 @@ typedef struct WFrameWindow {
         unsigned int is_client_window_frame:1;
 
         unsigned int incomplete_title:1;
+
+        unsigned int paint_deferred:1; /* not painted during the startup */
+        unsigned int draft:1;          /* don't render textures for new sizes */
     } flags;
     int depth;
     Visual *visual;
@@ -180,6 +186,13 @@ void wFrameWindowResize(WFrameWindow *fwin, int width, int height);
 
 void wFrameWindowShowButton(WFrameWindow *fwin, int flags);
 
+/*
+ * While in draft mode the textures are not rendered again when the
+ * frame changes size, the titlebar and resizebar are painted with their
+ * color instead. Leaving it paints the frame as it should be.
+ */
+void wFrameWindowSetDraft(WFrameWindow *fwin, Bool draft);
+
 void wFrameWindowHideButton(WFrameWindow *fwin, int flags);
 
 int wFrameWindowChangeTitle(WFrameWindow *fwin, const char *new_title);
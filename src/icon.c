@@ -47,6 +47,7 @@
 #include "startup.h"
 #include "event.h"
 #include "winmenu.h"
+#include "stats.h"
 
 /**** Global varianebles ****/
 
@@ -222,11 +223,15 @@ void wIconDestroy(WIcon *icon)
 	if (icon->icon_name)
 		XFree(icon->icon_name);
 
-	if (icon->pixmap)
+	if (icon->pixmap) {
+		wStatsRemovePixmap(icon->pixmap);
 		XFreePixmap(dpy, icon->pixmap);
+	}
 
-	if (icon->mini_preview)
+	if (icon->mini_preview) {
+		wStatsRemovePixmap(icon->mini_preview);
 		XFreePixmap(dpy, icon->mini_preview);
+	}
 
 	unset_icon_image(icon);
 
@@ -309,6 +314,8 @@ static void icon_update_pixmap(WIcon *icon, RImage *image)
 
 	if (!RConvertImage(scr->rcontext, tile, &pixmap))
 		wwarning(_("error rendering image:%s"), RMessageForError(RErrorCode));
+	else
+		wStatsAddPixmap(WSTATS_ICON, pixmap, tile->width, tile->height, scr->w_depth);
 
 	RReleaseImage(tile);
 
@@ -626,9 +633,13 @@ void set_icon_minipreview(WIcon *icon, RImage *image)
 	                                  wPreferences.minipreview_size - 2 * MINIPREVIEW_BORDER);
 
 	if (RConvertImage(scr->rcontext, scaled_mini_preview, &tmp)) {
-		if (icon->mini_preview != None)
+		if (icon->mini_preview != None) {
+			wStatsRemovePixmap(icon->mini_preview);
 			XFreePixmap(dpy, icon->mini_preview);
+		}
 		icon->mini_preview = tmp;
+		wStatsAddPixmap(WSTATS_ICON, tmp, scaled_mini_preview->width,
+				scaled_mini_preview->height, scr->w_depth);
 	}
 	RReleaseImage(scaled_mini_preview);
 }
@@ -665,8 +676,10 @@ void wIconUpdate(WIcon *icon)
 
 void update_icon_pixmap(WIcon *icon)
 {
-	if (icon->pixmap != None)
+	if (icon->pixmap != None) {
+		wStatsRemovePixmap(icon->pixmap);
 		XFreePixmap(dpy, icon->pixmap);
+	}
 
 	icon->pixmap = None;
  
@@ -44,6 +44,8 @@
 #include "dialog.h"
 #include "rootmenu.h"
 #include "switchmenu.h"
+#include "stats.h"
+#include "xrender.h"
 
 
 #define MOD_MASK wPreferences.modifier_mask
@@ -385,6 +387,59 @@ void wMenuRemoveItem(WMenu * menu, int index)
 	menu->brother->entry_no--;
 }
 
+#ifdef USE_XRENDER
+/* the same as renderTexture(), with the texture drawn by the server */
+static Pixmap renderServerTexture(WMenu *menu)
+{
+	WScreen *scr = menu->menu->screen_ptr;
+	Picture gradient, picture;
+	Pixmap pix;
+	int i, width, height;
+	RColor light;
+	RColor dark;
+	RColor mid;
+
+	width = menu->menu->width;
+	if (wPreferences.menu_style == MS_NORMAL)
+		height = menu->entry_height;
+	else
+		height = menu->menu->height + 1;
+
+	gradient = wXRenderCreateTexture(scr, scr->menu_item_texture, width, height);
+	if (gradient == None)
+		return None;
+
+	pix = wXRenderCopyTexture(scr, gradient, 0, 0, width, height, WREL_MENUENTRY, &picture);
+	XRenderFreePicture(dpy, gradient);
+
+	if (wPreferences.menu_style == MS_SINGLE_TEXTURE) {
+		light.alpha = 0;
+		light.red = light.green = light.blue = 80;
+
+		dark.alpha = 255;
+		dark.red = dark.green = dark.blue = 0;
+
+		mid.alpha = 0;
+		mid.red = mid.green = mid.blue = 40;
+
+		for (i = 1; i < menu->entry_no; i++) {
+			wXRenderOperateLine(picture, RSubtractOperation, 0, i * menu->entry_height - 2,
+					    width - 1, i * menu->entry_height - 2, &mid);
+
+			wXRenderDrawLine(picture, 0, i * menu->entry_height - 1,
+					 width - 1, i * menu->entry_height - 1, &dark);
+
+			wXRenderOperateLine(picture, RAddOperation, 0, i * menu->entry_height,
+					    width - 1, i * menu->entry_height, &light);
+		}
+	}
+	XRenderFreePicture(dpy, picture);
+	wStatsAddPixmap(WSTATS_MENU, pix, width, height, scr->w_depth);
+
+	return pix;
+}
+#endif
+
 static Pixmap renderTexture(WMenu * menu)
 {
 	RImage *img;
@@ -396,6 +451,12 @@ static Pixmap renderTexture(WMenu * menu)
 	WScreen *scr = menu->menu->screen_ptr;
 	WTexture *texture = scr->menu_item_texture;
 
+#ifdef USE_XRENDER
+	pix = renderServerTexture(menu);
+	if (pix != None)
+		return pix;
+#endif
+
 	if (wPreferences.menu_style == MS_NORMAL) {
 		img = wTextureRenderImage(texture, menu->menu->width, menu->entry_height, WREL_MENUENTRY);
 	} else {
@@ -428,9 +489,10 @@ static Pixmap renderTexture(WMenu * menu)
 				     menu->menu->width - 1, i * menu->entry_height, &light);
 		}
 	}
-	if (!RConvertImage(scr->rcontext, img, &pix)) {
+	if (!RConvertImage(scr->rcontext, img, &pix))
 		wwarning(_("error rendering image:%s"), RMessageForError(RErrorCode));
-	}
+	else
+		wStatsAddPixmap(WSTATS_MENU, pix, img->width, img->height, scr->w_depth);
 	RReleaseImage(img);
 
 	return pix;
@@ -53,6 +53,7 @@
 #include "xmodifier.h"
 #include "main.h"
 #include "event.h"
+#include "properties.h"
 
 
 #define ICON_SIZE wPreferences.icon_size
@@ -67,7 +68,7 @@ Bool wFetchName(Display *dpy, Window win, char **winname)
 	char **list;
 	int num;
 
-	if (XGetWMName(dpy, win, &text_prop)) {
+	if (PropGetTextProperty(win, XA_WM_NAME, &text_prop)) {
 		if (text_prop.value && text_prop.nitems > 0) {
 			if (text_prop.encoding == XA_STRING) {
 				*winname = wstrdup((char *)text_prop.value);
@@ -259,61 +260,7 @@ void slide_windows(Window wins[], int n, int from_x, int from_y, int to_x, int t
 
 char *ShrinkString(WMFont *font, const char *string, int width)
 {
-	int w, w1 = 0;
-	int p;
-	char *pos;
-	char *text;
-	int p1, p2, t;
-
-	p = strlen(string);
-	w = WMWidthOfString(font, string, p);
-	text = wmalloc(strlen(string) + 8);
-	strcpy(text, string);
-	if (w <= width)
-		return text;
-
-	pos = strchr(text, ' ');
-	if (!pos)
-		pos = strchr(text, ':');
-
-	if (pos) {
-		*pos = 0;
-		p = strlen(text);
-		w1 = WMWidthOfString(font, text, p);
-		if (w1 > width) {
-			p = 0;
-			*pos = ' ';
-			*text = 0;
-		} else {
-			*pos = 0;
-			width -= w1;
-			p++;
-		}
-		string += p;
-		p = strlen(string);
-	} else {
-		*text = 0;
-	}
-	strcat(text, "...");
-	width -= WMWidthOfString(font, "...", 3);
-
-	p1 = 0;
-	p2 = p;
-	t = (p2 - p1) / 2;
-	while (p2 > p1 && p1 != t) {
-		w = WMWidthOfString(font, &string[p - t], t);
-		if (w > width) {
-			p2 = t;
-			t = p1 + (p2 - p1) / 2;
-		} else if (w < width) {
-			p1 = t;
-			t = p1 + (p2 - p1) / 2;
-		} else
-			p2 = p1 = t;
-	}
-	strcat(text, &string[p - p1]);
-
-	return text;
+	return WMTruncateString(font, string, width, WTTruncateMiddle, NULL);
 }
 
 char *FindImage(const char *paths, const char *file)
@@ -1031,7 +978,7 @@ Bool UpdateDomainFile(WDDomain * domain)
 		}
 	}
 
-	result = WMWritePropListToFile(dict, domain->path);
+	result = WMWritePropListToFileIfChanged(dict, domain->path);
 
 	if (freeDict) {
 		WMReleasePropList(dict);
@@ -164,8 +164,10 @@ static int getMWMHints(Window window, MWMHints *mwmhints)
 	unsigned long *data;
 	int count;
 
-	if (!_XA_MOTIF_WM_HINTS)
+	if (!_XA_MOTIF_WM_HINTS) {
 		_XA_MOTIF_WM_HINTS = XInternAtom(dpy, "_MOTIF_WM_HINTS", False);
+		PropAddPrefetchAtom(_XA_MOTIF_WM_HINTS);
+	}
 
 	data = (unsigned long *)PropGetCheckProperty(window, _XA_MOTIF_WM_HINTS,
 						     _XA_MOTIF_WM_HINTS, 32, 0, &count);
@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "WindowMaker.h"
 #include "framewin.h"
@@ -37,6 +38,8 @@
 #include "actions.h"
 #include "workspace.h"
 #include "placement.h"
+#include "framegrid.h"
+#include "stats.h"
 
 #include "geomview.h"
 #include "screen.h"
@@ -571,6 +574,7 @@ typedef struct {
 	WWindow **rightList;	/* right border */
 	WWindow **bottomList;	/* bottom border */
 	int count;
+	int size;		/* room in the lists */
 
 	/* index of window in the above lists indicating the relative position
 	 * of the window with the others */
@@ -607,56 +611,26 @@ typedef struct {
 #define WBOTTOM(w) ((w)->frame_y + (int)(w)->frame->core->height - 1 + \
     (HAS_BORDER_WITH_SELECT(w) ? 2*(w)->screen_ptr->frame_border_width : 0))
 
-static int compareWTop(const void *a, const void *b)
-{
-	WWindow *wwin1 = *(WWindow **) a;
-	WWindow *wwin2 = *(WWindow **) b;
-
-	if (WTOP(wwin1) > WTOP(wwin2))
-		return -1;
-	else if (WTOP(wwin1) < WTOP(wwin2))
-		return 1;
-	else
-		return 0;
-}
-
-static int compareWLeft(const void *a, const void *b)
+/*
+ * Number of windows at the start of a list, which goes from the border of
+ * the screen inwards, whose edge is still before value.
+ */
+static int countBefore(WWindow **list, int count, WFrameGridEdge edge, int value, Bool descending)
 {
-	WWindow *wwin1 = *(WWindow **) a;
-	WWindow *wwin2 = *(WWindow **) b;
+	int low = 0, high = count, mid;
 
-	if (WLEFT(wwin1) > WLEFT(wwin2))
-		return -1;
-	else if (WLEFT(wwin1) < WLEFT(wwin2))
-		return 1;
-	else
-		return 0;
-}
+	while (low < high) {
+		int pos;
 
-static int compareWRight(const void *a, const void *b)
-{
-	WWindow *wwin1 = *(WWindow **) a;
-	WWindow *wwin2 = *(WWindow **) b;
+		mid = (low + high) / 2;
+		pos = list[mid]->grid.edges[edge];
+		if (descending ? pos > value : pos < value)
+			low = mid + 1;
+		else
+			high = mid;
+	}
 
-	if (WRIGHT(wwin1) < WRIGHT(wwin2))
-		return -1;
-	else if (WRIGHT(wwin1) > WRIGHT(wwin2))
-		return 1;
-	else
-		return 0;
-}
-
-static int compareWBottom(const void *a, const void *b)
-{
-	WWindow *wwin1 = *(WWindow **) a;
-	WWindow *wwin2 = *(WWindow **) b;
-
-	if (WBOTTOM(wwin1) < WBOTTOM(wwin2))
-		return -1;
-	else if (WBOTTOM(wwin1) > WBOTTOM(wwin2))
-		return 1;
-	else
-		return 0;
+	return low;
 }
 
 static void updateResistance(MoveData *data, int newX, int newY)
@@ -702,33 +676,19 @@ static void updateResistance(MoveData *data, int newX, int newY)
 	if (!ok)
 		return;
 
-	/* TODO: optimize this */
-	if (data->realY < WBOTTOM(data->bottomList[0])) {
-		data->bottomIndex = 0;
-	}
-	if (data->realX < WRIGHT(data->rightList[0])) {
-		data->rightIndex = 0;
-	}
-	if ((data->realX + data->winWidth) > WLEFT(data->leftList[0])) {
-		data->leftIndex = 0;
-	}
-	if ((data->realY + data->winHeight) > WTOP(data->topList[0])) {
-		data->topIndex = 0;
-	}
-	for (i = 0; i < data->count; i++) {
-		if (data->realY > WBOTTOM(data->bottomList[i])) {
-			data->bottomIndex = i + 1;
-		}
-		if (data->realX > WRIGHT(data->rightList[i])) {
-			data->rightIndex = i + 1;
-		}
-		if ((data->realX + data->winWidth) < WLEFT(data->leftList[i])) {
-			data->leftIndex = i + 1;
-		}
-		if ((data->realY + data->winHeight) < WTOP(data->topList[i])) {
-			data->topIndex = i + 1;
-		}
-	}
+	/* the lists are sorted, so only the windows around the new position are looked at */
+	i = countBefore(data->bottomList, data->count, WGE_BOTTOM, data->realY, False);
+	if (i > 0 || data->realY < WBOTTOM(data->bottomList[0]))
+		data->bottomIndex = i;
+	i = countBefore(data->rightList, data->count, WGE_RIGHT, data->realX, False);
+	if (i > 0 || data->realX < WRIGHT(data->rightList[0]))
+		data->rightIndex = i;
+	i = countBefore(data->leftList, data->count, WGE_LEFT, data->realX + data->winWidth, True);
+	if (i > 0 || (data->realX + data->winWidth) > WLEFT(data->leftList[0]))
+		data->leftIndex = i;
+	i = countBefore(data->topList, data->count, WGE_TOP, data->realY + data->winHeight, True);
+	if (i > 0 || (data->realY + data->winHeight) > WTOP(data->topList[0]))
+		data->topIndex = i;
 }
 
 static void freeMoveData(MoveData * data)
@@ -743,94 +703,58 @@ static void freeMoveData(MoveData * data)
 		wfree(data->bottomList);
 }
 
-static void updateMoveData(WWindow * wwin, MoveData * data)
+/* the windows the moved window resists to */
+static int fillMoveList(WWindow **list, WWindow **sorted, int count, WWindow *wwin, Bool reverse)
 {
-	WScreen *scr = wwin->screen_ptr;
 	WWindow *tmp;
-	int i;
+	int i, n = 0;
 
-	data->count = 0;
-	tmp = scr->focused_window;
-	while (tmp) {
-		if (tmp != wwin && scr->current_workspace == tmp->frame->workspace
-		    && !tmp->flags.miniaturized
-		    && !tmp->flags.hidden && !tmp->flags.obscured && !WFLAGP(tmp, sunken)) {
-			data->topList[data->count] = tmp;
-			data->leftList[data->count] = tmp;
-			data->rightList[data->count] = tmp;
-			data->bottomList[data->count] = tmp;
-			data->count++;
-		}
-		tmp = tmp->prev;
+	for (i = 0; i < count; i++) {
+		tmp = sorted[reverse ? count - i - 1 : i];
+		if (tmp != wwin && !tmp->flags.miniaturized
+		    && !tmp->flags.hidden && !tmp->flags.obscured && !WFLAGP(tmp, sunken))
+			list[n++] = tmp;
 	}
 
-	if (data->count == 0) {
-		data->topIndex = 0;
-		data->leftIndex = 0;
-		data->rightIndex = 0;
-		data->bottomIndex = 0;
-		return;
+	return n;
+}
+
+static void updateMoveData(WWindow * wwin, MoveData * data)
+{
+	WScreen *scr = wwin->screen_ptr;
+	WWindow **sorted[WGE_COUNT];
+	int count, i;
+
+	/* the workspace keeps its windows sorted by each edge */
+	for (i = 0; i < WGE_COUNT; i++)
+		sorted[i] = wFrameGridEdgeList(scr, scr->current_workspace, i, &count);
+
+	if (count > data->size) {
+		data->size = count;
+		data->topList = wrealloc(data->topList, sizeof(WWindow *) * data->size);
+		data->leftList = wrealloc(data->leftList, sizeof(WWindow *) * data->size);
+		data->rightList = wrealloc(data->rightList, sizeof(WWindow *) * data->size);
+		data->bottomList = wrealloc(data->bottomList, sizeof(WWindow *) * data->size);
 	}
 
 	/* order from closest to the border of the screen to farthest */
-
-	qsort(data->topList, data->count, sizeof(data->topList[0]), compareWTop);
-	qsort(data->leftList, data->count, sizeof(data->leftList[0]), compareWLeft);
-	qsort(data->rightList, data->count, sizeof(data->rightList[0]), compareWRight);
-	qsort(data->bottomList, data->count, sizeof(data->bottomList[0]), compareWBottom);
+	data->count = fillMoveList(data->topList, sorted[WGE_TOP], count, wwin, True);
+	fillMoveList(data->leftList, sorted[WGE_LEFT], count, wwin, True);
+	fillMoveList(data->rightList, sorted[WGE_RIGHT], count, wwin, False);
+	fillMoveList(data->bottomList, sorted[WGE_BOTTOM], count, wwin, False);
 
 	/* figure the position of the window relative to the others */
-
-	data->topIndex = -1;
-	data->leftIndex = -1;
-	data->rightIndex = -1;
-	data->bottomIndex = -1;
-
-	if (WTOP(wwin) < WBOTTOM(data->bottomList[0])) {
-		data->bottomIndex = 0;
-	}
-	if (WLEFT(wwin) < WRIGHT(data->rightList[0])) {
-		data->rightIndex = 0;
-	}
-	if (WRIGHT(wwin) > WLEFT(data->leftList[0])) {
-		data->leftIndex = 0;
-	}
-	if (WBOTTOM(wwin) > WTOP(data->topList[0])) {
-		data->topIndex = 0;
-	}
-	for (i = 0; i < data->count; i++) {
-		if (WTOP(wwin) >= WBOTTOM(data->bottomList[i])) {
-			data->bottomIndex = i + 1;
-		}
-		if (WLEFT(wwin) >= WRIGHT(data->rightList[i])) {
-			data->rightIndex = i + 1;
-		}
-		if (WRIGHT(wwin) <= WLEFT(data->leftList[i])) {
-			data->leftIndex = i + 1;
-		}
-		if (WBOTTOM(wwin) <= WTOP(data->topList[i])) {
-			data->topIndex = i + 1;
-		}
-	}
+	data->bottomIndex = countBefore(data->bottomList, data->count, WGE_BOTTOM, WTOP(wwin) + 1, False);
+	data->rightIndex = countBefore(data->rightList, data->count, WGE_RIGHT, WLEFT(wwin) + 1, False);
+	data->leftIndex = countBefore(data->leftList, data->count, WGE_LEFT, WRIGHT(wwin) - 1, True);
+	data->topIndex = countBefore(data->topList, data->count, WGE_TOP, WBOTTOM(wwin) - 1, True);
 }
 
 static void initMoveData(WWindow * wwin, MoveData * data)
 {
-	int i;
-	WWindow *tmp;
-
 	memset(data, 0, sizeof(MoveData));
 
-	for (i = 0, tmp = wwin->screen_ptr->focused_window; tmp != NULL; tmp = tmp->prev, i++) ;
-
-	if (i > 1) {
-		data->topList = wmalloc(sizeof(WWindow *) * i);
-		data->leftList = wmalloc(sizeof(WWindow *) * i);
-		data->rightList = wmalloc(sizeof(WWindow *) * i);
-		data->bottomList = wmalloc(sizeof(WWindow *) * i);
-
-		updateMoveData(wwin, data);
-	}
+	updateMoveData(wwin, data);
 
 	data->realX = wwin->frame_x;
 	data->realY = wwin->frame_y;
@@ -1702,6 +1626,7 @@ int wMouseMoveWindow(WWindow * wwin, XEvent * ev)
 	/* This needs not to change while moving, else bad things can happen */
 	int opaqueMove = wPreferences.opaque_move;
 	MoveData moveData;
+	struct timeval start, end;
 	int head = ((wPreferences.auto_arrange_icons && wXineramaHeads(scr) > 1)
 		    ? wGetHeadForWindow(wwin)
 		    : scr->xine_info.primary_head);
@@ -1806,10 +1731,14 @@ int wMouseMoveWindow(WWindow * wwin, XEvent * ev)
 				if (moveData.snap)
 					draw_snap_frame(wwin, moveData.snap);
 
+				gettimeofday(&start, NULL);
 				updateWindowPosition(wwin, &moveData,
 						     scr->selected_windows == NULL
 						     && wPreferences.edge_resistance > 0,
 						     opaqueMove, event.xmotion.x_root, event.xmotion.y_root);
+				gettimeofday(&end, NULL);
+				wStatsAddMoveTime((end.tv_sec - start.tv_sec) * 1000000L
+						  + end.tv_usec - start.tv_usec);
 
 				/* redraw snap frame */
 				if (moveData.snap)
@@ -2046,6 +1975,17 @@ static int getResizeDirection(WWindow * wwin, int x, int y, int dy, int flags)
 	return dir;
 }
 
+/* renders the frame once the pointer rests during an opaque resize */
+static WMHandlerID resizeDraftTimer = NULL;
+
+static void finishResizeDraft(void *data)
+{
+	WWindow *wwin = data;
+
+	resizeDraftTimer = NULL;
+	wFrameWindowSetDraft(wwin->frame, False);
+}
+
 void wMouseResizeWindow(WWindow * wwin, XEvent * ev)
 {
 	XEvent event;
@@ -2240,6 +2180,13 @@ void wMouseResizeWindow(WWindow * wwin, XEvent * ev)
 					/* Now, continue drawing */
 					XUngrabServer(dpy);
 					moveGeometryDisplayCentered(scr, fx + fw / 2, fy + fh / 2);
+
+					/* the textures wait for the pointer to rest */
+					if (resizeDraftTimer)
+						WMDeleteTimerHandler(resizeDraftTimer);
+					wFrameWindowSetDraft(wwin->frame, True);
+					resizeDraftTimer = WMAddTimerHandler(RESIZE_DRAFT_DELAY, finishResizeDraft, wwin);
+
 					wWindowConfigure(wwin, fx, fy, fw, fh - vert_border);
 					showGeometry(wwin, fx, fy, fx + fw, fy + fh, res);
 				};
@@ -2271,6 +2218,12 @@ void wMouseResizeWindow(WWindow * wwin, XEvent * ev)
 
 				wWindowConfigure(wwin, fx, fy, fw, fh - vert_border);
 				wWindowSynthConfigureNotify(wwin);
+
+				if (resizeDraftTimer) {
+					WMDeleteTimerHandler(resizeDraftTimer);
+					resizeDraftTimer = NULL;
+				}
+				wFrameWindowSetDraft(wwin->frame, False);
 			}
 			return;
 
@@ -2310,21 +2263,25 @@ void wUnselectWindows(WScreen * scr)
 
 static void selectWindowsInside(WScreen * scr, int x1, int y1, int x2, int y2)
 {
+	WMArrayIterator iter;
+	WMArray *windows;
 	WWindow *tmpw;
 
+	/* only the windows touching the rectangle can be inside of it */
+	windows = WMCreateArray(16);
+	wFrameGridQuery(scr, scr->current_workspace, x1, y1, x2 - x1, y2 - y1, windows);
+
 	/* select the windows and put them in the selected window list */
-	tmpw = scr->focused_window;
-	while (tmpw != NULL) {
+	WM_ITERATE_ARRAY(windows, tmpw, iter) {
 		if (!(tmpw->flags.miniaturized || tmpw->flags.hidden)) {
-			if ((tmpw->frame->workspace == scr->current_workspace || IS_OMNIPRESENT(tmpw))
-			    && (tmpw->frame_x >= x1) && (tmpw->frame_y >= y1)
+			if ((tmpw->frame_x >= x1) && (tmpw->frame_y >= y1)
 			    && (tmpw->frame->core->width + tmpw->frame_x <= x2)
 			    && (tmpw->frame->core->height + tmpw->frame_y <= y2)) {
 				wSelectWindow(tmpw, True);
 			}
 		}
-		tmpw = tmpw->prev;
 	}
+	WMFreeArray(windows);
 }
 
 void wSelectWindows(WScreen * scr, XEvent * ev)
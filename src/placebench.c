@@ -0,0 +1,175 @@
+/*
+ * Smart placement benchmark.
+ *
+ * Scatters the given number of random windows over a screen of the given
+ * size, then looks for the least covered place of a new window both with
+ * the coverage map used by the window manager and with the scan that
+ * sums the intersections with every window for each candidate position.
+ * Both must choose the same position; the time taken by each is reported.
+ *
+ * usage: placebench [windows [width height [placements]]]
+ */
+
+#include "wconfig.h"
+
+#include <sys/time.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <WINGs/WUtil.h>
+
+#include "coverage.h"
+
+typedef struct {
+	int x, y, width, height;
+} Rect;
+
+static int intersectionLength(int p1, int l1, int p2, int l2)
+{
+	if (p1 > p2) {
+		int tmp;
+
+		tmp = p1; p1 = p2; p2 = tmp;
+		tmp = l1; l1 = l2; l2 = tmp;
+	}
+
+	if (p1 + l1 < p2)
+		return 0;
+	else if (p2 + l2 < p1 + l1)
+		return l2;
+	else
+		return p1 + l1 - p2;
+}
+
+static long long sumOfCoveredAreas(const Rect *rects, int count, int x, int y, int w, int h)
+{
+	long long sum = 0;
+	int i;
+
+	for (i = 0; i < count; i++)
+		sum += (long long)intersectionLength(rects[i].x, rects[i].width, x, w)
+		    * intersectionLength(rects[i].y, rects[i].height, y, h);
+
+	return sum;
+}
+
+/* the placement as it was done before the coverage map */
+static void scanPlace(const Rect *rects, int count, int sx, int sy, int x2, int y2,
+		      unsigned int width, unsigned int height, int *x_ret, int *y_ret)
+{
+	int test_x, test_y = sy;
+	int from_x, to_x, from_y, to_y;
+	long long min_isect = LLONG_MAX, sum_isect;
+	int min_isect_x = sx, min_isect_y = sy;
+
+	while (((test_y + height) < y2)) {
+		test_x = sx;
+		while ((test_x + width) < x2) {
+			sum_isect = sumOfCoveredAreas(rects, count, test_x, test_y, width, height);
+			if (sum_isect < min_isect) {
+				min_isect = sum_isect;
+				min_isect_x = test_x;
+				min_isect_y = test_y;
+			}
+			test_x += PLACETEST_HSTEP;
+		}
+		test_y += PLACETEST_VSTEP;
+	}
+
+	from_x = WMAX(min_isect_x - PLACETEST_HSTEP + 1, sx);
+	to_x = min_isect_x + PLACETEST_HSTEP;
+	if (to_x + width > x2)
+		to_x = x2 - width;
+	from_y = WMAX(min_isect_y - PLACETEST_VSTEP + 1, sy);
+	to_y = min_isect_y + PLACETEST_VSTEP;
+	if (to_y + height > y2)
+		to_y = y2 - height;
+
+	for (test_x = from_x; test_x < to_x; test_x++) {
+		for (test_y = from_y; test_y < to_y; test_y++) {
+			sum_isect = sumOfCoveredAreas(rects, count, test_x, test_y, width, height);
+			if (sum_isect < min_isect) {
+				min_isect = sum_isect;
+				min_isect_x = test_x;
+				min_isect_y = test_y;
+			}
+		}
+	}
+
+	*x_ret = min_isect_x;
+	*y_ret = min_isect_y;
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int main(int argc, char **argv)
+{
+	int windows = 150, swidth = 7680, sheight = 2160, placements = 5;
+	double mapTime = 0, scanTime = 0, start;
+	Rect *rects;
+	int i, p;
+
+	if (argc > 1)
+		windows = atoi(argv[1]);
+	if (argc > 3) {
+		swidth = atoi(argv[2]);
+		sheight = atoi(argv[3]);
+	}
+	if (argc > 4)
+		placements = atoi(argv[4]);
+	if (windows < 0 || swidth < 1 || sheight < 1 || placements < 1) {
+		fprintf(stderr, "usage: %s [windows [width height [placements]]]\n", argv[0]);
+		return 1;
+	}
+
+	rects = wmalloc((windows + 1) * sizeof(Rect));
+	srand(1);
+
+	for (p = 0; p < placements; p++) {
+		unsigned int width = 200 + rand() % (swidth / 4 + 1);
+		unsigned int height = 150 + rand() % (sheight / 3 + 1);
+		int mx, my, sx, sy;
+		WCoverageMap *map;
+
+		/* some windows hang off the screen, like they do in real life */
+		for (i = 0; i < windows; i++) {
+			rects[i].width = 100 + rand() % (swidth / 3 + 1);
+			rects[i].height = 80 + rand() % (sheight / 2 + 1);
+			rects[i].x = rand() % (swidth + 200) - 100 - rects[i].width / 4;
+			rects[i].y = rand() % (sheight + 200) - 100 - rects[i].height / 4;
+		}
+
+		start = now();
+		map = wCoverageMapCreate(0, 0, swidth, sheight);
+		for (i = 0; i < windows; i++)
+			wCoverageMapAddRect(map, rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+		wCoverageMapFindPlace(map, width, height, &mx, &my);
+		wCoverageMapDestroy(map);
+		mapTime += now() - start;
+
+		start = now();
+		scanPlace(rects, windows, 0, 0, swidth, sheight, width, height, &sx, &sy);
+		scanTime += now() - start;
+
+		if (mx != sx || my != sy) {
+			fprintf(stderr, "%s: placement %d of %ux%u differs: %d,%d instead of %d,%d\n",
+				argv[0], p, width, height, mx, my, sx, sy);
+			return 1;
+		}
+	}
+
+	printf("%d windows on %dx%d, %d placements\n", windows, swidth, sheight, placements);
+	printf("coverage map: %.3f ms/placement\n", mapTime * 1000.0 / placements);
+	printf("scan: %.3f ms/placement\n", scanTime * 1000.0 / placements);
+
+	wfree(rects);
+
+	return 0;
+}
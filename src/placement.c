@@ -38,6 +38,8 @@
 #include "dock.h"
 #include "xinerama.h"
 #include "placement.h"
+#include "coverage.h"
+#include "framegrid.h"
 
 
 #define X_ORIGIN WMAX(usableArea.x1,\
@@ -258,34 +260,37 @@ int calcIntersectionArea(int x1, int y1, int w1, int h1, int x2, int y2, int w2,
 	    * calcIntersectionLength(y1, h1, y2, h2);
 }
 
-static int calcSumOfCoveredAreas(WWindow *wwin, int x, int y, int w, int h)
+/* Records the windows the smart placement tries not to cover */
+static WCoverageMap *createCoverageMap(WWindow *wwin, WArea usableArea)
 {
-	int sum_isect = 0;
+	WScreen *scr = wwin->screen_ptr;
+	WCoverageMap *map;
 	WWindow *test_window;
-	int tw, tx, ty, th;
+	WMArrayIterator iter;
+	WMArray *windows;
+
+	map = wCoverageMapCreate(X_ORIGIN, Y_ORIGIN, usableArea.x2, usableArea.y2);
 
-	test_window = wwin->screen_ptr->focused_window;
-	for (; test_window != NULL && test_window->prev != NULL;)
-		test_window = test_window->prev;
+	windows = WMCreateArray(16);
+	wFrameGridQuery(scr, scr->current_workspace, X_ORIGIN, Y_ORIGIN,
+			usableArea.x2 - X_ORIGIN, usableArea.y2 - Y_ORIGIN, windows);
 
-	for (; test_window != NULL; test_window = test_window->next) {
+	WM_ITERATE_ARRAY(windows, test_window, iter) {
 		if (test_window->frame->core->stacking->window_level < WMNormalLevel) {
 			continue;
 		}
 
-		tw = test_window->frame->core->width;
-		th = test_window->frame->core->height;
-		tx = test_window->frame_x;
-		ty = test_window->frame_y;
-
 		if (test_window->flags.mapped || (test_window->flags.shaded &&
 		     test_window->frame->workspace == wwin->screen_ptr->current_workspace &&
 		     !(test_window->flags.miniaturized || test_window->flags.hidden))) {
-			sum_isect += calcIntersectionArea(tx, ty, tw, th, x, y, w, h);
+			wCoverageMapAddRect(map, test_window->frame_x, test_window->frame_y,
+					    test_window->frame->core->width,
+					    test_window->frame->core->height);
 		}
 	}
+	WMFreeArray(windows);
 
-	return sum_isect;
+	return map;
 }
 
 static void set_width_height(WWindow *wwin, unsigned int *width, unsigned int *height)
@@ -334,82 +339,36 @@ window_overlaps(WWindow *win, int x, int y, int w, int h, Bool ignore_sunken)
 static Bool
 screen_has_space(WScreen *scr, int x, int y, int w, int h, Bool ignore_sunken)
 {
-	WWindow *focused = scr->focused_window, *i;
+	WMArray *windows;
+	WMArrayIterator iter;
+	WWindow *i;
+	Bool space = True;
 
-	for (i = focused; i; i = i->next) {
-		if (window_overlaps(i, x, y, w, h, ignore_sunken)) {
-			return False;
-		}
-	}
+	windows = WMCreateArray(8);
+	wFrameGridQuery(scr, scr->current_workspace, x, y, w, h, windows);
 
-	for (i = focused; i; i = i->prev) {
+	WM_ITERATE_ARRAY(windows, i, iter) {
 		if (window_overlaps(i, x, y, w, h, ignore_sunken)) {
-			return False;
+			space = False;
+			break;
 		}
 	}
+	WMFreeArray(windows);
 
-	return True;
+	return space;
 }
 
 static void
 smartPlaceWindow(WWindow *wwin, int *x_ret, int *y_ret, unsigned int width,
 		 unsigned int height, WArea usableArea)
 {
-	int test_x = 0, test_y = Y_ORIGIN;
-	int from_x, to_x, from_y, to_y;
-	int sx;
-	int min_isect, min_isect_x, min_isect_y;
-	int sum_isect;
+	WCoverageMap *map;
 
 	set_width_height(wwin, &width, &height);
 
-	sx = X_ORIGIN;
-	min_isect = INT_MAX;
-	min_isect_x = sx;
-	min_isect_y = test_y;
-
-	while (((test_y + height) < usableArea.y2)) {
-		test_x = sx;
-		while ((test_x + width) < usableArea.x2) {
-			sum_isect = calcSumOfCoveredAreas(wwin, test_x, test_y, width, height);
-
-			if (sum_isect < min_isect) {
-				min_isect = sum_isect;
-				min_isect_x = test_x;
-				min_isect_y = test_y;
-			}
-
-			test_x += PLACETEST_HSTEP;
-		}
-		test_y += PLACETEST_VSTEP;
-	}
-
-	from_x = min_isect_x - PLACETEST_HSTEP + 1;
-	from_x = WMAX(from_x, X_ORIGIN);
-	to_x = min_isect_x + PLACETEST_HSTEP;
-	if (to_x + width > usableArea.x2)
-		to_x = usableArea.x2 - width;
-
-	from_y = min_isect_y - PLACETEST_VSTEP + 1;
-	from_y = WMAX(from_y, Y_ORIGIN);
-	to_y = min_isect_y + PLACETEST_VSTEP;
-	if (to_y + height > usableArea.y2)
-		to_y = usableArea.y2 - height;
-
-	for (test_x = from_x; test_x < to_x; test_x++) {
-		for (test_y = from_y; test_y < to_y; test_y++) {
-			sum_isect = calcSumOfCoveredAreas(wwin, test_x, test_y, width, height);
-
-			if (sum_isect < min_isect) {
-				min_isect = sum_isect;
-				min_isect_x = test_x;
-				min_isect_y = test_y;
-			}
-		}
-	}
-
-	*x_ret = min_isect_x;
-	*y_ret = min_isect_y;
+	map = createCoverageMap(wwin, usableArea);
+	wCoverageMapFindPlace(map, width, height, x_ret, y_ret);
+	wCoverageMapDestroy(map);
 }
 
 static Bool
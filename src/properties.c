@@ -23,8 +23,12 @@
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/Xatom.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#ifdef USE_XCB
+#include <X11/Xlib-xcb.h>
+#endif
 
 #include "WindowMaker.h"
 #include "window.h"
@@ -32,13 +36,426 @@
 #include "properties.h"
 
 
+/* sizes of the ICCCM properties, in 32 bits items */
+#define WM_HINTS_ITEMS		9
+#define OLD_WM_HINTS_ITEMS	8
+#define WM_SIZE_HINTS_ITEMS	18
+#define OLD_WM_SIZE_HINTS_ITEMS	15
+
+/* enough for any property */
+#define WHOLE_PROPERTY		0x1fffffffL
+
+/*
+ * Managing a window reads a couple dozen of its properties, one after the
+ * other. When they are prefetched, the requests for all of them are sent
+ * at once and the answers are taken as they are needed, so that the whole
+ * lot costs about one round trip to the server instead of one each.
+ * Without XCB the requests can not be pipelined, but properties read more
+ * than once are still only fetched once.
+ */
+typedef struct PrefetchedProperty {
+	Atom atom;
+	Bool fetched;		/* the reply was taken */
+	int status;		/* Success, or the error of the request */
+	Atom type;
+	int format;
+	unsigned long nitems;
+	unsigned char *value;	/* like XGetWindowProperty() returns it */
+#ifdef USE_XCB
+	xcb_get_property_cookie_t cookie;
+#endif
+} PrefetchedProperty;
+
+static struct {
+	Atom *atoms;		/* the properties to prefetch */
+	int atomCount;
+	int atomSize;
+
+	Window window;		/* the window they are prefetched for */
+	PrefetchedProperty *properties;
+	int count;
+} prefetch = { NULL, 0, 0, None, NULL, 0 };
+
+
+void PropAddPrefetchAtom(Atom atom)
+{
+	int i;
+
+	for (i = 0; i < prefetch.atomCount; i++) {
+		if (prefetch.atoms[i] == atom)
+			return;
+	}
+
+	if (prefetch.atomCount == prefetch.atomSize) {
+		prefetch.atomSize = prefetch.atomSize ? prefetch.atomSize * 2 : 32;
+		prefetch.atoms = wrealloc(prefetch.atoms, prefetch.atomSize * sizeof(Atom));
+	}
+	prefetch.atoms[prefetch.atomCount++] = atom;
+}
+
+void PropPrefetchProperties(Window window)
+{
+	static Bool initialized = False;
+#ifdef USE_XCB
+	xcb_connection_t *connection = XGetXCBConnection(dpy);
+#endif
+	int i;
+
+	if (!initialized) {
+		initialized = True;
+
+		PropAddPrefetchAtom(XA_WM_NAME);
+		PropAddPrefetchAtom(XA_WM_CLASS);
+		PropAddPrefetchAtom(XA_WM_HINTS);
+		PropAddPrefetchAtom(XA_WM_NORMAL_HINTS);
+		PropAddPrefetchAtom(XA_WM_TRANSIENT_FOR);
+		PropAddPrefetchAtom(w_global.atom.wm.state);
+		PropAddPrefetchAtom(w_global.atom.wm.protocols);
+		PropAddPrefetchAtom(w_global.atom.wm.client_leader);
+		PropAddPrefetchAtom(w_global.atom.wm.colormap_windows);
+		PropAddPrefetchAtom(w_global.atom.gnustep.wm_attr);
+		PropAddPrefetchAtom(w_global.atom.desktop.gtk_object_path);
+	}
+
+	PropPrefetchDone();
+
+	prefetch.window = window;
+	prefetch.count = prefetch.atomCount;
+	prefetch.properties = wmalloc(prefetch.count * sizeof(PrefetchedProperty));
+
+	for (i = 0; i < prefetch.count; i++) {
+		prefetch.properties[i].atom = prefetch.atoms[i];
+#ifdef USE_XCB
+		prefetch.properties[i].cookie = xcb_get_property(connection, 0, window, prefetch.atoms[i],
+								 XCB_GET_PROPERTY_TYPE_ANY, 0, WHOLE_PROPERTY);
+#endif
+	}
+}
+
+void PropPrefetchDone(void)
+{
+#ifdef USE_XCB
+	xcb_connection_t *connection = XGetXCBConnection(dpy);
+#endif
+	int i;
+
+	for (i = 0; i < prefetch.count; i++) {
+		PrefetchedProperty *prop = &prefetch.properties[i];
+
+		if (prop->value)
+			XFree(prop->value);
+#ifdef USE_XCB
+		if (!prop->fetched)
+			xcb_discard_reply(connection, prop->cookie.sequence);
+#endif
+	}
+	if (prefetch.properties)
+		wfree(prefetch.properties);
+
+	prefetch.properties = NULL;
+	prefetch.count = 0;
+	prefetch.window = None;
+}
+
+#ifdef USE_XCB
+static void takeReply(PrefetchedProperty *prop)
+{
+	xcb_get_property_reply_t *reply;
+	xcb_generic_error_t *error = NULL;
+	unsigned char *value;
+	unsigned long i;
+
+	reply = xcb_get_property_reply(XGetXCBConnection(dpy), prop->cookie, &error);
+	if (!reply) {
+		prop->status = error ? error->error_code : BadImplementation;
+		free(error);
+		return;
+	}
+
+	prop->type = reply->type;
+	prop->format = reply->format;
+	prop->nitems = reply->value_len;
+	value = xcb_get_property_value(reply);
+
+	/* like Xlib does: 32 bits items become longs, always terminated */
+	if (reply->type != None) {
+		switch (reply->format) {
+		case 32:
+			prop->value = malloc(prop->nitems * sizeof(long) + 1);
+			if (prop->value) {
+				for (i = 0; i < prop->nitems; i++)
+					((long *)prop->value)[i] = ((int32_t *)value)[i];
+			}
+			break;
+		case 16:
+			prop->value = malloc(prop->nitems * sizeof(short) + 1);
+			if (prop->value) {
+				for (i = 0; i < prop->nitems; i++)
+					((short *)prop->value)[i] = ((int16_t *)value)[i];
+			}
+			break;
+		default:
+			prop->value = malloc(prop->nitems + 1);
+			if (prop->value) {
+				memcpy(prop->value, value, prop->nitems);
+				prop->value[prop->nitems] = 0;
+			}
+			break;
+		}
+		if (!prop->value)
+			prop->status = BadAlloc;
+	}
+
+	free(reply);
+}
+#endif
+
+static PrefetchedProperty *getPrefetched(Window window, Atom atom)
+{
+	PrefetchedProperty *prop = NULL;
+	int i;
+
+	if (window == None || window != prefetch.window)
+		return NULL;
+
+	for (i = 0; i < prefetch.count; i++) {
+		if (prefetch.properties[i].atom == atom) {
+			prop = &prefetch.properties[i];
+			break;
+		}
+	}
+	if (!prop || prop->fetched)
+		return prop;
+
+	prop->fetched = True;
+	prop->status = Success;
+#ifdef USE_XCB
+	takeReply(prop);
+#else
+	{
+		unsigned long bytes_after;
+
+		prop->status = XGetWindowProperty(dpy, window, atom, 0, WHOLE_PROPERTY, False,
+						  AnyPropertyType, &prop->type, &prop->format,
+						  &prop->nitems, &bytes_after, &prop->value);
+	}
+#endif
+
+	return prop;
+}
+
+/*
+ * Same as XGetWindowProperty(), served from the prefetched properties
+ * when it can.
+ */
+int PropGetWindowProperty(Window window, Atom property, long offset, long length, Atom req_type,
+			  Atom *actual_type, int *actual_format, unsigned long *nitems,
+			  unsigned long *bytes_after, unsigned char **value)
+{
+	PrefetchedProperty *prop;
+	unsigned long size, left, count, start = 0;
+	int itemSize, wireSize;
+
+	prop = getPrefetched(window, property);
+	if (!prop)
+		return XGetWindowProperty(dpy, window, property, offset, length, False, req_type,
+					  actual_type, actual_format, nitems, bytes_after, value);
+
+	*value = NULL;
+	*actual_type = None;
+	*actual_format = 0;
+	*nitems = 0;
+	*bytes_after = 0;
+
+	if (prop->status != Success)
+		return prop->status;
+	if (prop->type == None)
+		return Success;
+
+	*actual_type = prop->type;
+	*actual_format = prop->format;
+
+	/* offset and length are in 32 bits units of the data on the wire */
+	wireSize = prop->format / 8;
+	itemSize = (prop->format == 32 ? sizeof(long) : (prop->format == 16 ? sizeof(short) : 1));
+	size = prop->nitems * wireSize;
+
+	if (req_type != AnyPropertyType && req_type != prop->type) {
+		*bytes_after = size;
+		count = 0;
+	} else {
+		if (offset < 0 || 4 * (unsigned long)offset > size)
+			return BadValue;
+
+		start = 4 * (unsigned long)offset;
+		left = size - start;
+		count = (length < 0 || (unsigned long)length >= (left + 3) / 4) ? left : 4 * (unsigned long)length;
+		*bytes_after = left - count;
+		count /= wireSize;
+		start /= wireSize;
+		*nitems = count;
+	}
+
+	/* Xlib always returns a buffer when the property exists */
+	*value = malloc(count * itemSize + 1);
+	if (!*value)
+		return BadAlloc;
+	if (count > 0)
+		memcpy(*value, prop->value + start * itemSize, count * itemSize);
+	(*value)[count * itemSize] = 0;
+
+	return Success;
+}
+
+
+/* the hints from the items of a WM_HINTS property */
+static XWMHints *makeWMHints(const long *data, unsigned long nitems)
+{
+	XWMHints *hints;
+
+	hints = XAllocWMHints();
+	if (hints) {
+		hints->flags = data[0];
+		hints->input = (data[1] ? True : False);
+		hints->initial_state = data[2];
+		hints->icon_pixmap = data[3];
+		hints->icon_window = data[4];
+		hints->icon_x = data[5];
+		hints->icon_y = data[6];
+		hints->icon_mask = data[7];
+		hints->window_group = (nitems >= WM_HINTS_ITEMS ? data[8] : 0);
+	}
+
+	return hints;
+}
+
+/* Same as XGetWMHints() */
+XWMHints *PropGetWMHints(Window window)
+{
+	Atom type;
+	int format;
+	unsigned long nitems, bytes_after;
+	long *data;
+	XWMHints *hints;
+
+	if (PropGetWindowProperty(window, XA_WM_HINTS, 0, WM_HINTS_ITEMS, XA_WM_HINTS, &type, &format,
+				  &nitems, &bytes_after, (unsigned char **)&data) != Success)
+		return NULL;
+
+	if (type != XA_WM_HINTS || format != 32 || nitems < OLD_WM_HINTS_ITEMS) {
+		if (data)
+			XFree(data);
+		return NULL;
+	}
+
+	hints = makeWMHints(data, nitems);
+	XFree(data);
+
+	return hints;
+}
+
+XWMHints **PropGetWMHintsList(const Window *windows, int count)
+{
+	XWMHints **hints;
+#ifdef USE_XCB
+	xcb_connection_t *connection = XGetXCBConnection(dpy);
+	xcb_get_property_cookie_t *cookies;
+#endif
+	int i;
+
+	hints = wmalloc(count * sizeof(XWMHints *));
+
+#ifdef USE_XCB
+	/* send all the requests, then wait for the replies in turn */
+	cookies = wmalloc(count * sizeof(xcb_get_property_cookie_t));
+	for (i = 0; i < count; i++) {
+		if (windows[i] != None)
+			cookies[i] = xcb_get_property(connection, 0, windows[i], XA_WM_HINTS, XA_WM_HINTS,
+						      0, WM_HINTS_ITEMS);
+	}
+
+	for (i = 0; i < count; i++) {
+		xcb_get_property_reply_t *reply;
+		xcb_generic_error_t *error = NULL;
+		long data[WM_HINTS_ITEMS];
+		unsigned long nitems, j;
+
+		if (windows[i] == None)
+			continue;
+
+		/* windows that went away give an error, like no hints */
+		reply = xcb_get_property_reply(connection, cookies[i], &error);
+		free(error);
+		if (!reply)
+			continue;
+
+		nitems = reply->value_len;
+		if (reply->type == XA_WM_HINTS && reply->format == 32 && nitems >= OLD_WM_HINTS_ITEMS) {
+			int32_t *value = xcb_get_property_value(reply);
+
+			nitems = WMIN(nitems, WM_HINTS_ITEMS);
+			for (j = 0; j < nitems; j++)
+				data[j] = value[j];
+			hints[i] = makeWMHints(data, nitems);
+		}
+		free(reply);
+	}
+	wfree(cookies);
+#else
+	for (i = 0; i < count; i++) {
+		if (windows[i] != None)
+			hints[i] = PropGetWMHints(windows[i]);
+	}
+#endif
+
+	return hints;
+}
+
 int PropGetNormalHints(Window window, XSizeHints * size_hints, int *pre_iccm)
 {
+	Atom type;
+	int format;
+	unsigned long nitems, bytes_after;
+	long *data;
 	long supplied_hints;
 
-	if (!XGetWMNormalHints(dpy, window, size_hints, &supplied_hints)) {
+	/* as XGetWMNormalHints() does it */
+	if (PropGetWindowProperty(window, XA_WM_NORMAL_HINTS, 0, WM_SIZE_HINTS_ITEMS, XA_WM_SIZE_HINTS,
+				  &type, &format, &nitems, &bytes_after, (unsigned char **)&data) != Success)
+		return False;
+
+	if (type != XA_WM_SIZE_HINTS || format != 32 || nitems < OLD_WM_SIZE_HINTS_ITEMS) {
+		if (data)
+			XFree(data);
 		return False;
 	}
+
+	size_hints->flags = data[0];
+	size_hints->x = data[1];
+	size_hints->y = data[2];
+	size_hints->width = data[3];
+	size_hints->height = data[4];
+	size_hints->min_width = data[5];
+	size_hints->min_height = data[6];
+	size_hints->max_width = data[7];
+	size_hints->max_height = data[8];
+	size_hints->width_inc = data[9];
+	size_hints->height_inc = data[10];
+	size_hints->min_aspect.x = data[11];
+	size_hints->min_aspect.y = data[12];
+	size_hints->max_aspect.x = data[13];
+	size_hints->max_aspect.y = data[14];
+
+	supplied_hints = USPosition | USSize | PPosition | PSize | PMinSize | PMaxSize | PResizeInc | PAspect;
+	if (nitems >= WM_SIZE_HINTS_ITEMS) {
+		size_hints->base_width = data[15];
+		size_hints->base_height = data[16];
+		size_hints->win_gravity = data[17];
+		supplied_hints |= PBaseSize | PWinGravity;
+	}
+	size_hints->flags &= supplied_hints;
+	XFree(data);
+
 	if (supplied_hints == (USPosition | USSize | PPosition | PSize | PMinSize | PMaxSize
 			       | PResizeInc | PAspect)) {
 		*pre_iccm = 1;
@@ -48,23 +465,34 @@ int PropGetNormalHints(Window window, XSizeHints * size_hints, int *pre_iccm)
 	return True;
 }
 
-int PropGetWMClass(Window window, char **wm_class, char **wm_instance)
+/* the names are interned, release them with WMReleaseInternedString() */
+int PropGetWMClass(Window window, const char **wm_class, const char **wm_instance)
 {
-	XClassHint *class_hint;
-
-	class_hint = XAllocClassHint();
-	if (XGetClassHint(dpy, window, class_hint) == 0) {
-		*wm_class = strdup("default");
-		*wm_instance = strdup("default");
-		XFree(class_hint);
+	Atom type;
+	int format;
+	unsigned long nitems, bytes_after;
+	char *data = NULL;
+	size_t length;
+
+	/* as XGetClassHint() does it */
+	if (PropGetWindowProperty(window, XA_WM_CLASS, 0, BUFSIZ, XA_STRING, &type, &format,
+				  &nitems, &bytes_after, (unsigned char **)&data) != Success
+	    || type != XA_STRING || format != 8) {
+		if (data)
+			XFree(data);
+		*wm_class = WMInternString("default");
+		*wm_instance = WMInternString("default");
 		return False;
 	}
-	*wm_instance = strdup(class_hint->res_name);
-	*wm_class = strdup(class_hint->res_class);
 
-	XFree(class_hint->res_name);
-	XFree(class_hint->res_class);
-	XFree(class_hint);
+	/* the instance and the class, each terminated */
+	length = strlen(data);
+	if (length == nitems)
+		length--;
+	*wm_instance = WMInternString(data);
+	*wm_class = WMInternString(data + length + 1);
+
+	XFree(data);
 
 	return True;
 }
@@ -75,9 +503,10 @@ void PropGetProtocols(Window window, WProtocols * prots)
 	int count, i;
 
 	memset(prots, 0, sizeof(WProtocols));
-	if (!XGetWMProtocols(dpy, window, &protocols, &count)) {
+	protocols = (Atom *)PropGetCheckProperty(window, w_global.atom.wm.protocols, XA_ATOM, 32, 0, &count);
+	if (!protocols)
 		return;
-	}
+
 	for (i = 0; i < count; i++) {
 		if (protocols[i] == w_global.atom.wm.take_focus)
 			prots->TAKE_FOCUS = 1;
@@ -105,9 +534,9 @@ unsigned char *PropGetCheckProperty(Window window, Atom hint, Atom type, int for
 	else
 		tmp = count;
 
-	if (XGetWindowProperty(dpy, window, hint, 0, tmp, False, type,
-			       &type_ret, &fmt_ret, &nitems_ret, &bytes_after_ret,
-			       (unsigned char **)&data) != Success || !data)
+	if (PropGetWindowProperty(window, hint, 0, tmp, type,
+				  &type_ret, &fmt_ret, &nitems_ret, &bytes_after_ret,
+				  (unsigned char **)&data) != Success || !data)
 		return NULL;
 
 	if ((type != AnyPropertyType && type != type_ret)
@@ -216,6 +645,56 @@ void PropSetIconTileHint(WScreen * scr, RImage * image)
 
 }
 
+/* Same as XGetTransientForHint() */
+int PropGetTransientFor(Window window, Window *owner)
+{
+	Window *win;
+
+	*owner = None;
+	win = (Window *) PropGetCheckProperty(window, XA_WM_TRANSIENT_FOR, XA_WINDOW, 32, 1, NULL);
+	if (!win)
+		return False;
+
+	*owner = *win;
+	XFree(win);
+
+	return True;
+}
+
+/* Same as XGetTextProperty() */
+int PropGetTextProperty(Window window, Atom property, XTextProperty *text)
+{
+	Atom type;
+	int format;
+	unsigned long nitems, bytes_after;
+	unsigned char *data;
+
+	if (PropGetWindowProperty(window, property, 0, 1000000L, AnyPropertyType, &type, &format,
+				  &nitems, &bytes_after, &data) != Success || type == None) {
+		text->value = NULL;
+		text->encoding = None;
+		text->format = 0;
+		text->nitems = 0;
+		return False;
+	}
+
+	text->value = data;
+	text->encoding = type;
+	text->format = format;
+	text->nitems = nitems;
+
+	return True;
+}
+
+/* Same as XGetWMColormapWindows() */
+int PropGetColormapWindows(Window window, Window **windows, int *count)
+{
+	*windows = (Window *) PropGetCheckProperty(window, w_global.atom.wm.colormap_windows,
+						   XA_WINDOW, 32, 0, count);
+
+	return *windows != NULL;
+}
+
 Window PropGetClientLeader(Window window)
 {
 	Window *win;
@@ -24,14 +24,41 @@
 
 #include "GNUstep.h"
 
+/*
+ * Sends the requests for the properties a window is managed with, the
+ * functions below take the answers from there until PropPrefetchDone()
+ */
+void PropPrefetchProperties(Window window);
+void PropPrefetchDone(void);
+
+/* Adds a property to the ones PropPrefetchProperties() asks for */
+void PropAddPrefetchAtom(Atom atom);
+
+int PropGetWindowProperty(Window window, Atom property, long offset, long length, Atom req_type,
+                          Atom *actual_type, int *actual_format, unsigned long *nitems,
+                          unsigned long *bytes_after, unsigned char **value);
+
 unsigned char* PropGetCheckProperty(Window window, Atom hint, Atom type,
                                     int format, int count, int *retCount);
 
 int PropGetWindowState(Window window);
 
+XWMHints *PropGetWMHints(Window window);
+
+/*
+ * Same as PropGetWMHints() for a list of windows, the requests for all
+ * of them are sent at once. Returns a list of the same size, with NULL
+ * for the windows that are None or have no hints. The hints are released
+ * with XFree() and the list with wfree().
+ */
+XWMHints **PropGetWMHintsList(const Window *windows, int count);
+
 int PropGetNormalHints(Window window, XSizeHints *size_hints, int *pre_iccm);
+int PropGetTransientFor(Window window, Window *owner);
+int PropGetTextProperty(Window window, Atom property, XTextProperty *text);
+int PropGetColormapWindows(Window window, Window **windows, int *count);
 void PropGetProtocols(Window window, WProtocols *prots);
-int PropGetWMClass(Window window, char **wm_class, char **wm_instance);
+int PropGetWMClass(Window window, const char **wm_class, const char **wm_instance);
 int PropGetGNUstepWMAttr(Window window, GNUstepWMAttributes **attr);
 
 void PropSetWMakerProtocols(Window root);
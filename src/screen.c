@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
@@ -54,6 +55,7 @@
 #include "geomview.h"
 #include "wmspec.h"
 #include "rootmenu.h"
+#include "framecache.h"
 
 #include "xinerama.h"
 
@@ -603,6 +605,7 @@ WScreen *wScreenInit(int screen_number)
 	scr = wmalloc(sizeof(WScreen));
 
 	scr->stacking_list = WMCreateTreeBag();
+	scr->frame_cache = wFrameCacheCreate();
 
 	/* initialize globals */
 	scr->screen = screen_number;
@@ -870,6 +873,22 @@ void wScreenUpdateUsableArea(WScreen *scr)
 		wArrangeIcons(scr, True);
 }
 
+static WMPropList *readSessionState(const char *path)
+{
+	WMPropList *state;
+	struct stat stbuf;
+
+	state = wDefaultsReadCompiled(path, NULL);
+	if (state || stat(path, &stbuf) < 0)
+		return state;
+
+	state = WMReadPropListFromFile(path);
+	if (state)
+		wDefaultsWriteCompiled(state, path, NULL, &stbuf);
+
+	return state;
+}
+
 void wScreenRestoreState(WScreen * scr)
 {
 	WMPropList *state;
@@ -887,11 +906,11 @@ void wScreenRestoreState(WScreen * scr)
 		snprintf(buf, sizeof(buf), "WMState.%i", scr->screen);
 		path = wdefaultspathfordomain(buf);
 	}
-	scr->session_state = WMReadPropListFromFile(path);
+	scr->session_state = readSessionState(path);
 	wfree(path);
 	if (!scr->session_state && w_global.screen_count > 1) {
 		path = wdefaultspathfordomain("WMState");
-		scr->session_state = WMReadPropListFromFile(path);
+		scr->session_state = readSessionState(path);
 		wfree(path);
 	}
 
@@ -929,6 +948,7 @@ void wScreenSaveState(WScreen * scr)
 	WWindow *wwin;
 	char *str;
 	WMPropList *old_state, *foo;
+	struct stat stbuf;
 
 	make_keys();
 
@@ -998,8 +1018,10 @@ void wScreenSaveState(WScreen * scr)
 		snprintf(buf, sizeof(buf), "WMState.%i", scr->screen);
 		str = wdefaultspathfordomain(buf);
 	}
-	if (!WMWritePropListToFile(scr->session_state, str)) {
+	if (!WMWritePropListToFileIfChanged(scr->session_state, str)) {
 		werror(_("could not save session state in %s"), str);
+	} else if (stat(str, &stbuf) == 0) {
+		wDefaultsWriteCompiled(scr->session_state, str, NULL, &stbuf);
 	}
 	wfree(str);
 	WMReleasePropList(old_state);
@@ -115,6 +115,12 @@ typedef struct _WScreen {
 
     int window_count;		       /* number of windows in window_list */
 
+    struct _WCoreWindow **stacking_order;  /* the stacking the server has,
+                                        * topmost first, as last committed
+                                        */
+    int stacking_order_count;
+    int stacking_order_size;
+
     int workspace_count;	       /* number of workspaces */
 
     struct WWorkspace **workspaces;    /* workspace array */
@@ -183,6 +189,8 @@ typedef struct _WScreen {
     union WTexture *window_title_texture[3];  /* win textures (foc, unfoc, pfoc) */
     union WTexture *resizebar_texture[3];/* window resizebar texture (tex, -, -) */
 
+    struct WFrameCache *frame_cache;   /* pixmaps rendered for the frames */
+
     union WTexture *menu_item_texture; /* menu item texture */
 
     struct WTexSolid *menu_item_auxtexture; /* additional texture to draw menu
@@ -172,7 +172,8 @@ static WMPropList *makeWindowState(WWindow * wwin, WApplication * wapp)
 	Window win;
 	int i;
 	unsigned mask;
-	char *class, *instance, *command = NULL, buffer[512];
+	const char *class, *instance;
+	char *command = NULL, buffer[512];
 	WMPropList *win_state, *cmd, *name, *workspace;
 	WMPropList *shaded, *miniaturized, *hidden, *geometry;
 	WMPropList *dock, *shortcut;
@@ -231,7 +232,7 @@ static WMPropList *makeWindowState(WWindow * wwin, WApplication * wapp)
 		WMReleasePropList(shortcut);
 		if (wapp && wapp->app_icon && wapp->app_icon->dock) {
 			int i;
-			char *name = NULL;
+			const char *name = NULL;
 			if (wapp->app_icon->dock == scr->dock)
 				name = "Dock";
 
@@ -261,10 +262,8 @@ static WMPropList *makeWindowState(WWindow * wwin, WApplication * wapp)
 		win_state = NULL;
 	}
 
-	if (instance)
-		free(instance);
-	if (class)
-		free(class);
+	WMReleaseInternedString(instance);
+	WMReleaseInternedString(class);
 	if (command)
 		wfree(command);
 
@@ -442,7 +441,8 @@ static inline int is_same(const char *x, const char *y)
 void wSessionRestoreState(WScreen *scr)
 {
 	WSavedState *state;
-	char *instance, *class, *command;
+	char *name_instance, *name_class, *command;
+	const char *instance, *class;
 	WMPropList *win_info, *apps, *cmd, *value;
 	pid_t pid;
 	int i, count;
@@ -478,10 +478,18 @@ void wSessionRestoreState(WScreen *scr)
 		if (!value)
 			continue;
 
-		ParseWindowName(value, &instance, &class, "session");
-		if (!instance && !class)
+		ParseWindowName(value, &name_instance, &name_class, "session");
+		if (!name_instance && !name_class)
 			continue;
 
+		/* interned, so they can be compared with the dock icons directly */
+		instance = WMInternString(name_instance);
+		class = WMInternString(name_class);
+		if (name_instance)
+			wfree(name_instance);
+		if (name_class)
+			wfree(name_class);
+
 		state = getWindowState(scr, win_info);
 
 		dock = NULL;
@@ -525,8 +533,8 @@ void wSessionRestoreState(WScreen *scr)
 		if (dock != NULL) {
 			for (j = 0; j < dock->max_icons; j++) {
 				btn = dock->icon_array[j];
-				if (btn && is_same(instance, btn->wm_instance) &&
-				    is_same(class, btn->wm_class) &&
+				if (btn && instance == btn->wm_instance &&
+				    class == btn->wm_class &&
 				    is_same(command, btn->command) &&
 				    !btn->launching) {
 					found = 1;
@@ -543,10 +551,8 @@ void wSessionRestoreState(WScreen *scr)
 			wfree(state);
 		}
 
-		if (instance)
-			wfree(instance);
-		if (class)
-			wfree(class);
+		WMReleaseInternedString(instance);
+		WMReleaseInternedString(class);
 	}
 	/* clean up */
 	WMPLSetCaseSensitive(False);
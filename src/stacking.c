@@ -43,6 +43,82 @@ static void notifyStackChange(WCoreWindow * frame, char *detail)
 	WMPostNotificationName(WMNChangedStacking, wwin, detail);
 }
 
+/*
+ * The screen remembers the order the frames have on the server, so that
+ * committing the stacking lists only has to move the frames that are out
+ * of place. Every frame restacked on the server must be noted here.
+ */
+
+static Bool inStackingOrder(WScreen *scr, WCoreWindow *frame)
+{
+	int i = frame->stacking->order;
+
+	return i >= 0 && i < scr->stacking_order_count && scr->stacking_order[i] == frame;
+}
+
+static void renumberStackingOrder(WScreen *scr, int from)
+{
+	int i;
+
+	for (i = from; i < scr->stacking_order_count; i++)
+		scr->stacking_order[i]->stacking->order = i;
+}
+
+static void removeFromStackingOrder(WScreen *scr, WCoreWindow *frame)
+{
+	int i;
+
+	if (!inStackingOrder(scr, frame))
+		return;
+
+	i = frame->stacking->order;
+	scr->stacking_order_count--;
+	memmove(&scr->stacking_order[i], &scr->stacking_order[i + 1],
+		(scr->stacking_order_count - i) * sizeof(WCoreWindow *));
+	renumberStackingOrder(scr, i);
+}
+
+static void insertInStackingOrder(WScreen *scr, WCoreWindow *frame, int index)
+{
+	if (scr->stacking_order_count == scr->stacking_order_size) {
+		scr->stacking_order_size = scr->stacking_order_size ? scr->stacking_order_size * 2 : 32;
+		scr->stacking_order = wrealloc(scr->stacking_order,
+					       scr->stacking_order_size * sizeof(WCoreWindow *));
+	}
+	memmove(&scr->stacking_order[index + 1], &scr->stacking_order[index],
+		(scr->stacking_order_count - index) * sizeof(WCoreWindow *));
+	scr->stacking_order[index] = frame;
+	scr->stacking_order_count++;
+	renumberStackingOrder(scr, index);
+}
+
+/* frame was put right under "under" on the server, or over everything if it is NULL */
+static void noteRestacked(WCoreWindow *frame, WCoreWindow *under)
+{
+	WScreen *scr = frame->screen_ptr;
+
+	removeFromStackingOrder(scr, frame);
+	if (under == NULL)
+		insertInStackingOrder(scr, frame, 0);
+	else if (inStackingOrder(scr, under))
+		insertInStackingOrder(scr, frame, under->stacking->order + 1);
+	else
+		scr->stacking_order_count = 0;	/* lost track, the next commit does it all */
+}
+
+static void noteLowered(WCoreWindow *frame)
+{
+	WScreen *scr = frame->screen_ptr;
+
+	removeFromStackingOrder(scr, frame);
+	insertInStackingOrder(scr, frame, scr->stacking_order_count);
+}
+
+void NoteFrameRaised(WCoreWindow *frame)
+{
+	noteRestacked(frame, NULL);
+}
+
 /*
  *----------------------------------------------------------------------
  * RemakeStackList--
@@ -71,6 +147,7 @@ void RemakeStackList(WScreen * scr)
 		return;
 	} else {
 		WMEmptyBag(scr->stacking_list);
+		scr->stacking_order_count = 0;
 
 		/* verify list integrity */
 		c = 0;
@@ -89,6 +166,9 @@ void RemakeStackList(WScreen * scr)
 			frame->stacking->under = tmp;
 			frame->stacking->above = NULL;
 			WMSetInBag(scr->stacking_list, level, frame);
+
+			/* the tree is bottom first */
+			insertInStackingOrder(scr, frame, 0);
 		}
 		XFree(windows);
 		scr->window_count = c;
@@ -97,12 +177,71 @@ void RemakeStackList(WScreen * scr)
 	CommitStacking(scr);
 }
 
+/*
+ * Marks in keep the longest run of frames that are already in the same
+ * order on the server, those do not have to be restacked. The frames that
+ * the server does not know the place of are never kept. Returns how many
+ * frames were kept.
+ */
+static int findUnmovedFrames(WScreen *scr, WCoreWindow **frames, int count, Bool *keep)
+{
+	int *tails, *prev;
+	int i, length, low, high, mid;
+
+	tails = wmalloc(count * sizeof(int));
+	prev = wmalloc(count * sizeof(int));
+
+	/* longest increasing subsequence of the old places */
+	length = 0;
+	for (i = 0; i < count; i++) {
+		int place;
+
+		keep[i] = False;
+		if (!inStackingOrder(scr, frames[i]))
+			continue;
+		place = frames[i]->stacking->order;
+
+		low = 0;
+		high = length;
+		while (low < high) {
+			mid = (low + high) / 2;
+			if (frames[tails[mid]]->stacking->order < place)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+		prev[i] = low > 0 ? tails[low - 1] : -1;
+		tails[low] = i;
+		if (low == length)
+			length++;
+	}
+
+	for (i = length > 0 ? tails[length - 1] : -1; i >= 0; i = prev[i])
+		keep[i] = True;
+
+	wfree(tails);
+	wfree(prev);
+
+	return length;
+}
+
+static void restackFrame(WCoreWindow *frame, WCoreWindow *sibling, int mode)
+{
+	XWindowChanges changes;
+
+	changes.sibling = sibling->window;
+	changes.stack_mode = mode;
+	XConfigureWindow(dpy, frame->window, CWSibling | CWStackMode, &changes);
+}
+
 /*
  *----------------------------------------------------------------------
  * CommitStacking--
  * 	Reorders the actual window stacking, so that it has the stacking
  * order in the internal window stacking lists. It does the opposite
  * of RemakeStackList().
+ * 	Only the frames that are out of place since the last commit
+ * are restacked and notified about.
  *
  * Side effects:
  * 	Windows may be restacked.
@@ -110,24 +249,64 @@ void RemakeStackList(WScreen * scr)
  */
 void CommitStacking(WScreen * scr)
 {
-	WCoreWindow *tmp;
-	int nwindows, i;
-	Window *windows;
+	WCoreWindow *tmp, **frames;
+	int nwindows, nkept, first, i;
+	Bool *keep;
 	WMBagIterator iter;
 
 	nwindows = scr->window_count;
-	windows = wmalloc(sizeof(Window) * nwindows);
+	frames = wmalloc(sizeof(WCoreWindow *) * nwindows);
+	keep = wmalloc(sizeof(Bool) * nwindows);
 
 	i = 0;
 	WM_ETARETI_BAG(scr->stacking_list, tmp, iter) {
 		while (tmp) {
-			windows[i++] = tmp->window;
+			frames[i++] = tmp;
 			tmp = tmp->stacking->under;
 		}
 	}
-	XRestackWindows(dpy, windows, i);
-	wfree(windows);
-	WMPostNotificationName(WMNResetStacking, scr, NULL);
+	nwindows = i;
+
+	nkept = findUnmovedFrames(scr, frames, nwindows, keep);
+
+	if (nkept == 0) {
+		Window *windows = wmalloc(sizeof(Window) * nwindows);
+
+		for (i = 0; i < nwindows; i++)
+			windows[i] = frames[i]->window;
+		XRestackWindows(dpy, windows, nwindows);
+		wfree(windows);
+	} else {
+		/* stack the frames over the first kept one from it up, the others under their neighbour */
+		for (first = 0; !keep[first]; first++)
+			;
+		for (i = first - 1; i >= 0; i--)
+			restackFrame(frames[i], frames[i + 1], Above);
+		for (i = first + 1; i < nwindows; i++) {
+			if (!keep[i])
+				restackFrame(frames[i], frames[i - 1], Below);
+		}
+	}
+
+	if (scr->stacking_order_size < nwindows) {
+		scr->stacking_order_size = nwindows;
+		scr->stacking_order = wrealloc(scr->stacking_order, nwindows * sizeof(WCoreWindow *));
+	}
+	memcpy(scr->stacking_order, frames, nwindows * sizeof(WCoreWindow *));
+	scr->stacking_order_count = nwindows;
+	renumberStackingOrder(scr, 0);
+
+	if (nkept == 0) {
+		WMPostNotificationName(WMNResetStacking, scr, NULL);
+	} else {
+		for (i = 0; i < nwindows; i++) {
+			if (!keep[i])
+				notifyStackChange(frames[i], "restack");
+		}
+	}
+
+	wfree(frames);
+	wfree(keep);
 }
 
 /*
@@ -149,6 +328,7 @@ static void moveFrameToUnder(WCoreWindow * under, WCoreWindow * frame)
 	wins[0] = under->window;
 	wins[1] = frame->window;
 	XRestackWindows(dpy, wins, 2);
+	noteRestacked(frame, under);
 }
 
 /*
@@ -185,6 +365,7 @@ void CommitStackingForWindow(WCoreWindow * frame)
 		} else {
 			/* no window above us */
 			XRaiseWindow(dpy, frame->window);
+			noteRestacked(frame, NULL);
 		}
 	} else {
 		moveFrameToUnder(frame->stacking->above, frame);
@@ -263,6 +444,7 @@ void wRaiseFrame(WCoreWindow * frame)
 			/* no window above us */
 			above = NULL;
 			XRaiseWindow(dpy, frame->window);
+			noteRestacked(frame, NULL);
 		}
 	} else {
 		moveFrameToUnder(frame->stacking->above, frame);
@@ -373,6 +555,7 @@ void wLowerFrame(WCoreWindow * frame)
 		} else {
 			/* no window below us */
 			XLowerWindow(dpy, frame->window);
+			noteLowered(frame);
 		}
 	} else {
 		moveFrameToUnder(frame->stacking->above, frame);
@@ -500,6 +683,7 @@ void MoveInStackListAbove(WCoreWindow * next, WCoreWindow * frame)
 		}
 		if (above == NULL) {
 			XRaiseWindow(dpy, frame->window);
+			noteRestacked(frame, NULL);
 		} else {
 			moveFrameToUnder(above, frame);
 		}
@@ -571,6 +755,7 @@ void RemoveFromStackList(WCoreWindow * frame)
 		WMSetInBag(frame->screen_ptr->stacking_list, index, frame->stacking->under);
 
 	frame->screen_ptr->window_count--;
+	removeFromStackingOrder(frame->screen_ptr, frame);
 
 	WMPostNotificationName(WMNResetStacking, frame->screen_ptr, NULL);
 }
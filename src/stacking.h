@@ -32,4 +32,7 @@ void RemakeStackList(WScreen *scr);
 void CommitStacking(WScreen *scr);
 void CommitStackingForFrame(WCoreWindow *frame);
 void CommitStackingForWindow(WCoreWindow * frame);
+
+/* Must be called after raising a frame over all the others without the functions above */
+void NoteFrameRaised(WCoreWindow *frame);
 #endif
@@ -25,6 +25,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdint.h>
 #include <errno.h>
 #include <signal.h>
 #include <sys/wait.h>
@@ -47,6 +48,9 @@
 #ifdef USE_RANDR
 #include <X11/extensions/Xrandr.h>
 #endif
+#ifdef USE_XRENDER
+#include <X11/extensions/Xrender.h>
+#endif
 
 #include "WindowMaker.h"
 #include "GNUstep.h"
@@ -396,7 +400,9 @@ static char *atomNames[] = {
 
 	"_GTK_APPLICATION_OBJECT_PATH",
 
-	"WM_IGNORE_FOCUS_EVENTS"
+	"WM_IGNORE_FOCUS_EVENTS",
+
+	"_WINDOWMAKER_STATS"
 };
 
 /*
@@ -473,6 +479,8 @@ void StartUp(Bool defaultScreenOnly)
 
 	w_global.atom.wm.ignore_focus_events = atom[21];
 
+	w_global.atom.wmaker.stats = atom[22];
+
 #ifdef USE_DOCK_XDND
 	wXDNDInitializeAtoms();
 #endif
@@ -600,6 +608,18 @@ void StartUp(Bool defaultScreenOnly)
 	w_global.xext.randr.supported = XRRQueryExtension(dpy, &w_global.xext.randr.event_base, &j);
 #endif
 
+#ifdef USE_XRENDER
+	{
+		int major, minor;
+
+		/* the gradients came with version 0.10, the blend operators with 0.11 */
+		if (XRenderQueryExtension(dpy, &j, &j) && XRenderQueryVersion(dpy, &major, &minor)) {
+			w_global.xext.xrender.supported = (major > 0 || minor >= 10);
+			w_global.xext.xrender.blend = (major > 0 || minor >= 11);
+		}
+	}
+#endif
+
 #ifdef KEEP_XKB_LOCK_STATUS
 	w_global.xext.xkb.supported = XkbQueryExtension(dpy, NULL, &w_global.xext.xkb.event_base, NULL, NULL, NULL);
 	if (wPreferences.modelock && !w_global.xext.xkb.supported) {
@@ -715,13 +735,12 @@ void StartUp(Bool defaultScreenOnly)
 
 }
 
-static Bool windowInList(Window window, Window * list, int count)
+/* positions maps every child to its index in the list + 1 */
+static Bool windowInList(Window window, WMHashTable *positions, Window *list)
 {
-	for (; count >= 0; count--) {
-		if (window == list[count])
-			return True;
-	}
-	return False;
+	uintptr_t i = (uintptr_t) WMHashGet(positions, (void *) window);
+
+	return (i > 0 && list[i - 1] != None);
 }
 
 /*
@@ -740,7 +759,8 @@ static void manageAllWindows(WScreen * scr, int crashRecovery)
 	Window root, parent;
 	Window *children;
 	unsigned int nchildren;
-	unsigned int i, j;
+	unsigned int i;
+	WMHashTable *positions;
 	WWindow *wwin;
 
 	XGrabServer(dpy);
@@ -748,27 +768,29 @@ static void manageAllWindows(WScreen * scr, int crashRecovery)
 
 	scr->flags.startup = 1;
 
+	positions = WMCreateHashTable(WMIntHashCallbacks);
+	for (i = 0; i < nchildren; i++)
+		WMHashInsert(positions, (void *) children[i], (void *) (uintptr_t) (i + 1));
+
 	/* first remove all icon windows */
-	for (i = 0; i < nchildren; i++) {
-		XWMHints *wmhints;
+	if (nchildren > 0) {
+		XWMHints **wmhints;
 
-		if (children[i] == None)
-			continue;
+		/* the hints of all the windows come in one go */
+		wmhints = PropGetWMHintsList(children, nchildren);
+		for (i = 0; i < nchildren; i++) {
+			if (!wmhints[i])
+				continue;
 
-		wmhints = XGetWMHints(dpy, children[i]);
-		if (wmhints && (wmhints->flags & IconWindowHint)) {
-			for (j = 0; j < nchildren; j++) {
-				if (children[j] == wmhints->icon_window) {
-					XFree(wmhints);
-					wmhints = NULL;
-					children[j] = None;
-					break;
-				}
+			if (children[i] != None && (wmhints[i]->flags & IconWindowHint)) {
+				uintptr_t icon = (uintptr_t) WMHashGet(positions, (void *) wmhints[i]->icon_window);
+
+				if (icon > 0)
+					children[icon - 1] = None;
 			}
+			XFree(wmhints[i]);
 		}
-		if (wmhints) {
-			XFree(wmhints);
-		}
+		wfree(wmhints);
 	}
 
 	for (i = 0; i < nchildren; i++) {
@@ -786,7 +808,7 @@ static void manageAllWindows(WScreen * scr, int crashRecovery)
 			if (wwin->flags.miniaturized
 			    && (wwin->transient_for == None
 				|| wwin->transient_for == scr->root_win
-				|| !windowInList(wwin->transient_for, children, nchildren))) {
+				|| !windowInList(wwin->transient_for, positions, children))) {
 
 				wwin->flags.skip_next_animation = 1;
 				wwin->flags.miniaturized = 0;
@@ -823,10 +845,17 @@ static void manageAllWindows(WScreen * scr, int crashRecovery)
 		wwin = wwin->prev;
 	}
 
+	WMFreeHashTable(positions);
 	XFree(children);
 	scr->flags.startup = 0;
 	scr->flags.startup2 = 1;
 
+	/* the frames were not painted while the server was grabbed */
+	for (wwin = scr->focused_window; wwin; wwin = wwin->prev) {
+		if (wwin->frame && wwin->frame->flags.paint_deferred)
+			wFrameWindowPaint(wwin->frame);
+	}
+
 	while (XPending(dpy)) {
 		XEvent ev;
 		WMNextEvent(dpy, &ev);
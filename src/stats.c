@@ -0,0 +1,195 @@
+/* stats.c - resource usage statistics
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "wconfig.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+
+#include "WindowMaker.h"
+#include "screen.h"
+#include "stats.h"
+
+/*
+ * Pixmaps live in the X server, so they do not show up in the heap
+ * usage of wmaker even though it owns them. The ones it keeps around
+ * are registered here when they are created and forgotten when freed.
+ */
+
+typedef struct PixmapRecord {
+	WStatsPixmapKind kind;
+	size_t bytes;
+} PixmapRecord;
+
+static const char *const kindNames[WSTATS_PIXMAP_KINDS] = {
+	"frames",
+	"icons",
+	"menus",
+	"textures"
+};
+
+static struct {
+	unsigned long count;
+	size_t bytes;
+} pixmapUsage[WSTATS_PIXMAP_KINDS];
+
+static struct {
+	unsigned long events;
+	unsigned long long total;
+	unsigned long max;
+} moveTime;
+
+static struct {
+	unsigned long requests;
+	unsigned long writes;
+	unsigned long unchanged;
+} propertyUpdates;
+
+static struct {
+	unsigned long lookups;
+	unsigned long found;
+} frameCache;
+
+static WMHashTable *pixmapTable = NULL;	/* Pixmap -> PixmapRecord */
+static WMSlab *recordSlab = NULL;
+
+#define PIXMAP_KEY(pixmap) ((void *)(uintptr_t) (pixmap))
+
+void wStatsAddPixmap(WStatsPixmapKind kind, Pixmap pixmap, int width, int height, int depth)
+{
+	PixmapRecord *record;
+
+	if (pixmap == None)
+		return;
+
+	if (!pixmapTable) {
+		pixmapTable = WMCreateHashTable(WMIntHashCallbacks);
+		recordSlab = WMCreateSlab("PixmapRecord", sizeof(PixmapRecord));
+	}
+
+	/* the id was reused, so the pixmap was freed without telling us */
+	wStatsRemovePixmap(pixmap);
+
+	record = WMSlabAlloc(recordSlab);
+	record->kind = kind;
+	/* the server pads pixels to 1, 2 or 4 bytes */
+	record->bytes = (size_t) width * height * (depth > 16 ? 4 : (depth > 8 ? 2 : 1));
+	WMHashInsert(pixmapTable, PIXMAP_KEY(pixmap), record);
+
+	pixmapUsage[kind].count++;
+	pixmapUsage[kind].bytes += record->bytes;
+}
+
+void wStatsRemovePixmap(Pixmap pixmap)
+{
+	PixmapRecord *record;
+
+	if (!pixmapTable || pixmap == None)
+		return;
+
+	record = WMHashGet(pixmapTable, PIXMAP_KEY(pixmap));
+	if (!record)
+		return;
+
+	pixmapUsage[record->kind].count--;
+	pixmapUsage[record->kind].bytes -= record->bytes;
+	WMHashRemove(pixmapTable, PIXMAP_KEY(pixmap));
+	WMSlabFree(recordSlab, record);
+}
+
+void wStatsAddMoveTime(unsigned long usec)
+{
+	moveTime.events++;
+	moveTime.total += usec;
+	if (usec > moveTime.max)
+		moveTime.max = usec;
+}
+
+void wStatsAddPropertyRequest(void)
+{
+	propertyUpdates.requests++;
+}
+
+void wStatsAddPropertyWrite(Bool changed)
+{
+	if (changed)
+		propertyUpdates.writes++;
+	else
+		propertyUpdates.unchanged++;
+}
+
+void wStatsAddFrameCacheLookup(Bool found)
+{
+	frameCache.lookups++;
+	if (found)
+		frameCache.found++;
+}
+
+void wStatsDump(WScreen *scr)
+{
+	WMFindFileStatistics files;
+	char line[128];
+	char *text;
+	int i;
+
+	text = WMGetMemoryStatisticsDescription(20);
+
+	text = wstrappend(text, "pixmaps:\n");
+	for (i = 0; i < WSTATS_PIXMAP_KINDS; i++) {
+		snprintf(line, sizeof(line), "  %-28s %10zu bytes %8lu pixmaps\n",
+			 kindNames[i], pixmapUsage[i].bytes, pixmapUsage[i].count);
+		text = wstrappend(text, line);
+	}
+
+	WMGetFindFileStatistics(&files);
+	snprintf(line, sizeof(line), "file searches: %lu, %lu found, %lu of %lu directory checks cached\n",
+		 files.lookups, files.found, files.cached, files.cached + files.uncached);
+	text = wstrappend(text, line);
+	snprintf(line, sizeof(line), "  %u directories, %lu listings read, %lu change events\n",
+		 files.directories, files.directoryReads, files.events);
+	text = wstrappend(text, line);
+
+	snprintf(line, sizeof(line), "window moves: %lu motion events, %lu us average, %lu us max\n",
+		 moveTime.events, moveTime.events ? (unsigned long)(moveTime.total / moveTime.events) : 0,
+		 moveTime.max);
+	text = wstrappend(text, line);
+
+	snprintf(line, sizeof(line), "root properties: %lu updates, %lu written, %lu merged, %lu unchanged\n",
+		 propertyUpdates.requests, propertyUpdates.writes,
+		 propertyUpdates.requests - propertyUpdates.writes - propertyUpdates.unchanged,
+		 propertyUpdates.unchanged);
+	text = wstrappend(text, line);
+
+	snprintf(line, sizeof(line), "frame pixmaps: %lu of %lu renders shared\n",
+		 frameCache.found, frameCache.lookups);
+	text = wstrappend(text, line);
+
+	wmessage(_("resource usage:\n%s"), text);
+
+	XChangeProperty(dpy, scr->root_win, w_global.atom.wmaker.stats, XA_STRING, 8,
+			PropModeReplace, (unsigned char *)text, strlen(text));
+
+	wfree(text);
+}
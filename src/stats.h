@@ -0,0 +1,51 @@
+/* stats.h - resource usage statistics
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef WMSTATS_H
+#define WMSTATS_H
+
+/* the server side pixmaps that are accounted for */
+typedef enum {
+	WSTATS_FRAME,		/* titlebar, button and resizebar backgrounds */
+	WSTATS_ICON,		/* icon images and mini-previews */
+	WSTATS_MENU,		/* menu backgrounds */
+	WSTATS_TEXTURE,		/* textures rendered for the whole screen */
+
+	WSTATS_PIXMAP_KINDS
+} WStatsPixmapKind;
+
+void wStatsAddPixmap(WStatsPixmapKind kind, Pixmap pixmap, int width, int height, int depth);
+void wStatsRemovePixmap(Pixmap pixmap);
+
+/* accounts for the time taken to follow one pointer motion of a window move */
+void wStatsAddMoveTime(unsigned long usec);
+
+/* accounts for the root window properties asked to be updated and written */
+void wStatsAddPropertyRequest(void);
+void wStatsAddPropertyWrite(Bool changed);
+
+/* accounts for the frame pixmaps looked for in the cache, and found or not */
+void wStatsAddFrameCacheLookup(Bool found);
+
+/* logs the heap and pixmap usage and stores it in _WINDOWMAKER_STATS */
+void wStatsDump(WScreen *scr);
+
+#endif /* WMSTATS_H */
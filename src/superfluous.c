@@ -200,8 +200,10 @@ static void doAppBounce(void *arg)
 
 reinit:
 	if (data->wapp->refcount > 1) {
-		if (wPreferences.raise_appicons_when_bouncing)
+		if (wPreferences.raise_appicons_when_bouncing) {
 			XRaiseWindow(dpy, aicon->icon->core->window);
+			NoteFrameRaised(aicon->icon->core);
+		}
 
 		const double ticks = BOUNCE_HZ * BOUNCE_LENGTH;
 		const double s = sqrt(BOUNCE_HEIGHT)/(ticks/2);
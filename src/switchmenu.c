@@ -47,6 +47,7 @@
 static int initialized = 0;
 static void observer(void *self, WMNotification * notif);
 static void wsobserver(void *self, WMNotification * notif);
+static void stateObserver(void *self, WMNotification * notif);
 
 /*
  * FocusWindow
@@ -79,12 +80,20 @@ void InitializeSwitchMenu(void)
 		WMAddNotificationObserver(observer, NULL, WMNUnmanaged, NULL);
 		WMAddNotificationObserver(observer, NULL, WMNChangedWorkspace, NULL);
 		WMAddNotificationObserver(observer, NULL, WMNChangedState, NULL);
-		WMAddNotificationObserver(observer, NULL, WMNChangedFocus, NULL);
 		WMAddNotificationObserver(observer, NULL, WMNChangedStacking, NULL);
 		WMAddNotificationObserver(observer, NULL, WMNChangedName, NULL);
 
 		WMAddNotificationObserver(wsobserver, NULL, WMNWorkspaceChanged, NULL);
 		WMAddNotificationObserver(wsobserver, NULL, WMNWorkspaceNameChanged, NULL);
+
+		/*
+		 * Indicator changes come in bursts (hide others, workspace switch),
+		 * refresh them all at once when the event loop gets back control
+		 */
+		WMAddNotificationObserverWithStyle(stateObserver, NULL, WMNChangedState, NULL,
+						   WMPostASAP, WNCOnName);
+		WMAddNotificationObserverWithStyle(stateObserver, NULL, WMNChangedFocus, NULL,
+						   WMPostASAP, WNCOnName);
 	}
 }
 
@@ -170,6 +179,23 @@ static int menuIndexForWindow(WMenu * menu, WWindow * wwin, int old_pos)
 	return idx;
 }
 
+static void updateEntryState(WMenuEntry *entry, WWindow *wwin)
+{
+	if (wwin->flags.hidden) {
+		entry->flags.indicator_type = MI_HIDDEN;
+		entry->flags.indicator_on = 1;
+	} else if (wwin->flags.miniaturized) {
+		entry->flags.indicator_type = MI_MINIWINDOW;
+		entry->flags.indicator_on = 1;
+	} else if (wwin->flags.shaded && !wwin->flags.focused) {
+		entry->flags.indicator_type = MI_SHADED;
+		entry->flags.indicator_on = 1;
+	} else {
+		entry->flags.indicator_on = wwin->flags.focused;
+		entry->flags.indicator_type = MI_DIAMOND;
+	}
+}
+
 /*
  * Update switch menu
  */
@@ -309,19 +335,7 @@ void UpdateSwitchMenu(WScreen * scr, WWindow * wwin, int action)
 					break;
 
 				case ACTION_CHANGE_STATE:
-					if (wwin->flags.hidden) {
-						entry->flags.indicator_type = MI_HIDDEN;
-						entry->flags.indicator_on = 1;
-					} else if (wwin->flags.miniaturized) {
-						entry->flags.indicator_type = MI_MINIWINDOW;
-						entry->flags.indicator_on = 1;
-					} else if (wwin->flags.shaded && !wwin->flags.focused) {
-						entry->flags.indicator_type = MI_SHADED;
-						entry->flags.indicator_on = 1;
-					} else {
-						entry->flags.indicator_on = wwin->flags.focused;
-						entry->flags.indicator_type = MI_DIAMOND;
-					}
+					updateEntryState(entry, wwin);
 					break;
 				}
 				break;
@@ -384,16 +398,39 @@ static void observer(void *self, WMNotification * notif)
 		UpdateSwitchMenu(wwin->screen_ptr, wwin, ACTION_REMOVE);
 	else if (strcmp(name, WMNChangedWorkspace) == 0)
 		UpdateSwitchMenu(wwin->screen_ptr, wwin, ACTION_CHANGE_WORKSPACE);
-	else if (strcmp(name, WMNChangedFocus) == 0)
-		UpdateSwitchMenu(wwin->screen_ptr, wwin, ACTION_CHANGE_STATE);
 	else if (strcmp(name, WMNChangedName) == 0)
 		UpdateSwitchMenu(wwin->screen_ptr, wwin, ACTION_CHANGE);
 	else if (strcmp(name, WMNChangedState) == 0) {
-		if (strcmp((char *)data, "omnipresent") == 0) {
+		/* other state changes are picked up by stateObserver() */
+		if (strcmp((char *)data, "omnipresent") == 0)
 			UpdateSwitchMenu(wwin->screen_ptr, wwin, ACTION_CHANGE_WORKSPACE);
-		} else {
-			UpdateSwitchMenu(wwin->screen_ptr, wwin, ACTION_CHANGE_STATE);
-		}
+	}
+}
+
+/*
+ * Runs from the ASAP notification queue, so the window that posted may be
+ * gone already: refresh the indicator of every entry instead.
+ */
+static void stateObserver(void *self, WMNotification * notif)
+{
+	WScreen *scr;
+	WMenu *menu;
+	int i, j;
+
+	/* Parameters not used, but tell the compiler that it is ok */
+	(void) self;
+	(void) notif;
+
+	for (i = 0; i < w_global.screen_count; i++) {
+		scr = wScreenWithNumber(i);
+		menu = scr->switch_menu;
+		if (!menu)
+			continue;
+
+		for (j = 0; j < menu->entry_no; j++)
+			updateEntryState(menu->entries[j], (WWindow *) menu->entries[j]->clientdata);
+
+		wMenuPaint(menu);
 	}
 }
 
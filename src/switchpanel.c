@@ -98,7 +98,8 @@ static Bool sameWindowClass(WWindow *wwin, WWindow *curwin)
 {
 	if (!wwin->wm_class || !curwin->wm_class)
 		return False;
-	if (strcmp(wwin->wm_class, curwin->wm_class))
+	/* the names are interned */
+	if (wwin->wm_class != curwin->wm_class)
 		return False;
 
 	return True;
@@ -24,6 +24,7 @@
 
 #include "screen.h"
 #include "wcore.h"
+#include "stats.h"
 
 /* texture relief */
 #define WREL_RAISED	0
@@ -175,7 +176,7 @@ void wTexturePaintTitlebar(struct WWindow *wwin, WTexture *texture, Pixmap *tdat
                            int repaint);
 
 
-#define FREE_PIXMAP(p) if ((p)!=None) XFreePixmap(dpy, (p)), (p)=None
+#define FREE_PIXMAP(p) if ((p)!=None) wStatsRemovePixmap(p), XFreePixmap(dpy, (p)), (p)=None
 
 void wDrawBevel(Drawable d, unsigned width, unsigned height,
                 WTexSolid *texture, int relief);
@@ -29,6 +29,7 @@ typedef struct WStacking {
 	struct _WCoreWindow *under;
 	short window_level;
 	struct _WCoreWindow *child_of;	/* owner for transient window */
+	int order;			/* place in the screen's stacking_order */
 } WStacking;
 
 typedef struct _WCoreWindow {
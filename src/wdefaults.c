@@ -23,6 +23,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <string.h>
 #include <strings.h>
@@ -52,6 +53,11 @@
 /* type converters */
 static int getBool(WMPropList *, WMPropList *);
 static char *getString(WMPropList *, WMPropList *);
+static void resolve_attributes(const char *instance, const char *class,
+			       WWindowAttributes *attr, WWindowAttributes *mask,
+			       Bool useGlobalDefault);
+static WMPropList *lookup_generic_value(const char *instance, const char *class,
+					WMPropList *option, Bool default_icon);
 static WMPropList *ANoTitlebar = NULL;
 static WMPropList *ANoResizebar;
 static WMPropList *ANoMiniaturizeButton;
@@ -163,22 +169,210 @@ static WMPropList *get_value(WMPropList * dict_win, WMPropList * dict_class, WMP
 	return default_value;
 }
 
-static WMPropList *get_value_from_instanceclass(const char *value)
+/* An instance/class pair, both interned (or NULL), used as a cache key */
+typedef struct WindowName {
+	const char *instance;
+	const char *class;
+} WindowName;
+
+static unsigned hashWindowName(const void *data)
 {
-	WMPropList *key, *val = NULL;
+	const WindowName *name = data;
 
-	if (!value)
-		return NULL;
+	return (unsigned)(((uintptr_t)name->instance >> 3) * 31 + ((uintptr_t)name->class >> 3));
+}
+
+static Bool isSameWindowName(const void *a, const void *b)
+{
+	const WindowName *na = a, *nb = b;
+
+	/* the names are interned */
+	return na->instance == nb->instance && na->class == nb->class;
+}
+
+static const WMHashTableCallbacks windowNameCallbacks = {
+	hashWindowName, isSameWindowName, NULL, NULL
+};
+
+/*
+ * The WMWindowAttributes keys ("instance.class", "instance" or "class")
+ * looked up for a window, cached by interned name so that the same few
+ * names do not build a new key on every lookup. Sessions that see a lot
+ * of different clients would make it grow forever, so it is started over
+ * when it holds WINDOW_NAME_CACHE_SIZE names, and when the domain changes.
+ */
+#define WINDOW_NAME_CACHE_SIZE	256
+
+typedef struct WindowKey {
+	WindowName name;
+	WMPropList *key;
+} WindowKey;
+
+static WMHashTable *windowKeys = NULL;
+
+/*
+ * What was resolved from WMWindowAttributes for an instance/class pair,
+ * so that the windows of an application already seen do not repeat the
+ * dozens of dictionary lookups. The values are only valid for the current
+ * contents of the domain, see wDefaultFlushWindowAttributes(). Like the
+ * keys, the records are started over when they hold WINDOW_NAME_CACHE_SIZE
+ * names, as they are only a shortcut to what the domain holds.
+ */
+typedef struct WindowRecord {
+	WindowName name;
+	unsigned int filled;		/* bit per useGlobalDefault */
+	WWindowAttributes attr[2];
+	WWindowAttributes mask[2];
+
+	unsigned int resolved;		/* RESOLVED_* bits for the values below */
+	WMPropList *icon[2];		/* without and with the "*" default */
+	WMPropList *start_workspace;
+} WindowRecord;
+
+#define RESOLVED_ICON		(1 << 0)
+#define RESOLVED_DEFAULT_ICON	(1 << 1)
+#define RESOLVED_WORKSPACE	(1 << 2)
+
+static WMHashTable *windowRecords = NULL;
+
+static void intern_window_name(WindowName *name, const char *instance, const char *class)
+{
+	name->instance = WMInternString(instance);
+	name->class = WMInternString(class);
+}
+
+static void release_window_name(WindowName *name)
+{
+	WMReleaseInternedString(name->instance);
+	WMReleaseInternedString(name->class);
+}
+
+static void flush_window_keys(void)
+{
+	WMHashEnumerator e;
+	WindowKey *wk;
+
+	if (!windowKeys)
+		return;
+
+	e = WMEnumerateHashTable(windowKeys);
+	while ((wk = WMNextHashEnumeratorItem(&e)) != NULL) {
+		WMReleasePropList(wk->key);
+		release_window_name(&wk->name);
+		wfree(wk);
+	}
+	WMResetHashTable(windowKeys);
+}
+
+/*
+ * The returned key is owned by the cache and must not be released. It is
+ * only valid until the next call, retain it to keep it longer.
+ */
+static WMPropList *get_window_key(const char *instance, const char *class)
+{
+	WindowKey probe, *wk;
+	char *buffer;
+
+	if (!windowKeys)
+		windowKeys = WMCreateHashTable(windowNameCallbacks);
+
+	intern_window_name(&probe.name, instance, class);
+
+	wk = WMHashGet(windowKeys, &probe.name);
+	if (wk) {
+		release_window_name(&probe.name);
+		return wk->key;
+	}
+
+	if (WMCountHashTable(windowKeys) >= WINDOW_NAME_CACHE_SIZE)
+		flush_window_keys();
+
+	/* the new entry keeps the references taken above */
+	wk = wmalloc(sizeof(WindowKey));
+	wk->name = probe.name;
+	if (instance && class) {
+		buffer = StrConcatDot(instance, class);
+		wk->key = WMCreatePLString(buffer);
+		wfree(buffer);
+	} else {
+		wk->key = WMCreatePLString(instance ? instance : class);
+	}
+	WMHashInsert(windowKeys, &wk->name, wk);
+
+	return wk->key;
+}
+
+static void flush_window_records(void)
+{
+	WMHashEnumerator e;
+	WindowRecord *wr;
+	int i;
+
+	if (!windowRecords)
+		return;
+
+	e = WMEnumerateHashTable(windowRecords);
+	while ((wr = WMNextHashEnumeratorItem(&e)) != NULL) {
+		for (i = 0; i < wlengthof(wr->icon); i++) {
+			if (wr->icon[i])
+				WMReleasePropList(wr->icon[i]);
+		}
+		if (wr->start_workspace)
+			WMReleasePropList(wr->start_workspace);
+		release_window_name(&wr->name);
+		wfree(wr);
+	}
+	WMResetHashTable(windowRecords);
+}
+
+static WindowRecord *get_window_record(const char *instance, const char *class)
+{
+	WindowName name;
+	WindowRecord *wr;
+
+	if (!windowRecords)
+		windowRecords = WMCreateHashTable(windowNameCallbacks);
+
+	intern_window_name(&name, instance, class);
+
+	wr = WMHashGet(windowRecords, &name);
+	if (wr) {
+		release_window_name(&name);
+		return wr;
+	}
+
+	if (WMCountHashTable(windowRecords) >= WINDOW_NAME_CACHE_SIZE)
+		flush_window_records();
+
+	wr = wmalloc(sizeof(WindowRecord));
+	wr->name = name;
+	WMHashInsert(windowRecords, &wr->name, wr);
+
+	return wr;
+}
+
+/*
+ * Forgets everything resolved from WMWindowAttributes. Must be called
+ * whenever the domain is reloaded or changed in place.
+ */
+void wDefaultFlushWindowAttributes(void)
+{
+	flush_window_keys();
+	flush_window_records();
+}
 
-	key = WMCreatePLString(value);
+static WMPropList *get_value_from_instanceclass(const char *instance, const char *class)
+{
+	WMPropList *val = NULL;
+
+	if (!instance && !class)
+		return NULL;
 
 	WMPLSetCaseSensitive(True);
 
 	if (w_global.domain.window_attr->dictionary)
-		val = key ? WMGetFromPLDictionary(w_global.domain.window_attr->dictionary, key) : NULL;
-
-	if (key)
-		WMReleasePropList(key);
+		val = WMGetFromPLDictionary(w_global.domain.window_attr->dictionary,
+					    get_window_key(instance, class));
 
 	WMPLSetCaseSensitive(False);
 
@@ -200,22 +394,80 @@ void wDefaultFillAttributes(const char *instance, const char *class,
 			    WWindowAttributes *attr, WWindowAttributes *mask,
 			    Bool useGlobalDefault)
 {
-	WMPropList *value, *dw, *dc, *dn, *da;
-	char *buffer;
-
-	dw = dc = dn = da = NULL;
+	WindowRecord *wr;
+	unsigned char *dst, *dst_mask;
+	const unsigned char *src, *src_mask;
+	int global = useGlobalDefault ? 1 : 0;
+	size_t i;
 
 	if (!ANoTitlebar)
 		init_wdefaults();
 
-	if (class && instance) {
-		buffer = StrConcatDot(instance, class);
-		dw = get_value_from_instanceclass(buffer);
-		wfree(buffer);
+	wr = get_window_record(instance, class);
+	if (!(wr->filled & (1 << global))) {
+		resolve_attributes(instance, class, &wr->attr[global], &wr->mask[global], useGlobalDefault);
+		wr->filled |= 1 << global;
+	}
+
+	/* all the fields are bits, so the defined ones can be merged bytewise */
+	dst = (unsigned char *)attr;
+	dst_mask = (unsigned char *)mask;
+	src = (const unsigned char *)&wr->attr[global];
+	src_mask = (const unsigned char *)&wr->mask[global];
+	for (i = 0; i < sizeof(WWindowAttributes); i++) {
+		dst[i] = (dst[i] & ~src_mask[i]) | (src[i] & src_mask[i]);
+		if (mask)
+			dst_mask[i] |= src_mask[i];
+	}
+}
+
+static WMPropList *get_generic_value(const char *instance, const char *class,
+				     WMPropList *option, Bool default_icon)
+{
+	WindowRecord *wr;
+	WMPropList **value;
+	unsigned int bit;
+
+	wr = get_window_record(instance, class);
+
+	if (option == AIcon && default_icon) {
+		value = &wr->icon[1];
+		bit = RESOLVED_DEFAULT_ICON;
+	} else if (option == AIcon) {
+		value = &wr->icon[0];
+		bit = RESOLVED_ICON;
+	} else if (option == AStartWorkspace && default_icon) {
+		value = &wr->start_workspace;
+		bit = RESOLVED_WORKSPACE;
+	} else {
+		return lookup_generic_value(instance, class, option, default_icon);
+	}
+
+	if (!(wr->resolved & bit)) {
+		*value = lookup_generic_value(instance, class, option, default_icon);
+		if (*value)
+			WMRetainPropList(*value);
+		wr->resolved |= bit;
 	}
 
-	dn = get_value_from_instanceclass(instance);
-	dc = get_value_from_instanceclass(class);
+	return *value;
+}
+
+static void resolve_attributes(const char *instance, const char *class,
+			       WWindowAttributes *attr, WWindowAttributes *mask,
+			       Bool useGlobalDefault)
+{
+	WMPropList *value, *dw, *dc, *dn, *da;
+
+	dw = dc = dn = da = NULL;
+
+	if (class && instance)
+		dw = get_value_from_instanceclass(instance, class);
+
+	if (instance)
+		dn = get_value_from_instanceclass(instance, NULL);
+	if (class)
+		dc = get_value_from_instanceclass(NULL, class);
 
 	WMPLSetCaseSensitive(True);
 
@@ -310,10 +562,10 @@ void wDefaultFillAttributes(const char *instance, const char *class,
 	WMPLSetCaseSensitive(False);
 }
 
-static WMPropList *get_generic_value(const char *instance, const char *class,
-				     WMPropList *option, Bool default_icon)
+static WMPropList *lookup_generic_value(const char *instance, const char *class,
+					WMPropList *option, Bool default_icon)
 {
-	WMPropList *value, *key, *dict;
+	WMPropList *value, *dict;
 
 	value = NULL;
 
@@ -321,15 +573,8 @@ static WMPropList *get_generic_value(const char *instance, const char *class,
 
 	/* Search the icon name using class and instance */
 	if (class && instance) {
-		char *buffer;
-
-		buffer = wmalloc(strlen(class) + strlen(instance) + 2);
-		sprintf(buffer, "%s.%s", instance, class);
-		key = WMCreatePLString(buffer);
-		wfree(buffer);
-
-		dict = WMGetFromPLDictionary(w_global.domain.window_attr->dictionary, key);
-		WMReleasePropList(key);
+		dict = WMGetFromPLDictionary(w_global.domain.window_attr->dictionary,
+					     get_window_key(instance, class));
 
 		if (dict)
 			value = WMGetFromPLDictionary(dict, option);
@@ -337,10 +582,8 @@ static WMPropList *get_generic_value(const char *instance, const char *class,
 
 	/* Search the icon name using instance */
 	if (!value && instance) {
-		key = WMCreatePLString(instance);
-
-		dict = WMGetFromPLDictionary(w_global.domain.window_attr->dictionary, key);
-		WMReleasePropList(key);
+		dict = WMGetFromPLDictionary(w_global.domain.window_attr->dictionary,
+					     get_window_key(instance, NULL));
 
 		if (dict)
 			value = WMGetFromPLDictionary(dict, option);
@@ -348,10 +591,8 @@ static WMPropList *get_generic_value(const char *instance, const char *class,
 
 	/* Search the icon name using class */
 	if (!value && class) {
-		key = WMCreatePLString(class);
-
-		dict = WMGetFromPLDictionary(w_global.domain.window_attr->dictionary, key);
-		WMReleasePropList(key);
+		dict = WMGetFromPLDictionary(w_global.domain.window_attr->dictionary,
+					     get_window_key(NULL, class));
 
 		if (dict)
 			value = WMGetFromPLDictionary(dict, option);
@@ -549,16 +790,8 @@ void wDefaultChangeIcon(const char *instance, const char *class, const char *fil
 
 	WMPLSetCaseSensitive(True);
 
-	if (instance && class) {
-		char *buffer;
-
-		buffer = StrConcatDot(instance, class);
-		key = WMCreatePLString(buffer);
-		wfree(buffer);
-	} else if (instance) {
-		key = WMCreatePLString(instance);
-	} else if (class) {
-		key = WMCreatePLString(class);
+	if (instance || class) {
+		key = WMRetainPropList(get_window_key(instance, class));
 	} else {
 		key = WMRetainPropList(AnyWindow);
 	}
@@ -587,6 +820,7 @@ void wDefaultChangeIcon(const char *instance, const char *class, const char *fil
 	} else if (icon_value != NULL && !same) {
 		WMPutInPLDictionary(dict, key, icon_value);
 	}
+	wDefaultFlushWindowAttributes();
 
 	if (!wPreferences.flags.noupdates)
 		UpdateDomainFile(db);
@@ -621,6 +855,7 @@ void wDefaultPurgeInfo(const char *instance, const char *class)
 			WMRemoveFromPLDictionary(dict, AIcon);
 		}
 		WMRemoveFromPLDictionary(w_global.domain.window_attr->dictionary, key);
+		wDefaultFlushWindowAttributes();
 		UpdateDomainFile(w_global.domain.window_attr);
 	}
 
@@ -60,6 +60,7 @@
 #include "superfluous.h"
 #include "rootmenu.h"
 #include "placement.h"
+#include "framegrid.h"
 #include "misc.h"
 #include "startup.h"
 #include "winmenu.h"
@@ -115,6 +116,7 @@ static void appearanceObserver(void *self, WMNotification * notif)
 			wFrameWindowResize(wwin->frame, wwin->frame->core->width, wwin->frame->top_width - 1);
 			wwin->client.y = wwin->frame_y - wwin->client.height + wwin->frame->top_width;
 			wWindowSynthConfigureNotify(wwin);
+			wFrameGridUpdate(wwin);
 		}
 	}
 	if (flags & WTextureSettings)
@@ -174,6 +176,7 @@ void wWindowDestroy(WWindow *wwin)
 		wwin->screen_ptr->cmap_window = NULL;
 
 	WMRemoveNotificationObserver(wwin);
+	WMCancelDeferredNotifications(wwin);
 
 	wwin->flags.destroyed = 1;
 
@@ -199,17 +202,16 @@ void wWindowDestroy(WWindow *wwin)
 		}
 	}
 
+	wFrameGridRemove(wwin);
+
 	if (wwin->normal_hints)
 		XFree(wwin->normal_hints);
 
 	if (wwin->wm_hints)
 		XFree(wwin->wm_hints);
 
-	if (wwin->wm_instance)
-		XFree(wwin->wm_instance);
-
-	if (wwin->wm_class)
-		XFree(wwin->wm_class);
+	WMReleaseInternedString(wwin->wm_instance);
+	WMReleaseInternedString(wwin->wm_class);
 
 	if (wwin->wm_gnustep_attr)
 		wfree(wwin->wm_gnustep_attr);
@@ -296,8 +298,8 @@ static void discard_hints_from_gtk(WWindow *wwin)
 	unsigned char *result;
 	int status;
 
-	status = XGetWindowProperty(dpy, wwin->client_win, w_global.atom.desktop.gtk_object_path, 0, 16, False,
-	                            AnyPropertyType, &type, &format, &nb_item, &nb_remain, &result);
+	status = PropGetWindowProperty(wwin->client_win, w_global.atom.desktop.gtk_object_path, 0, 16,
+				       AnyPropertyType, &type, &format, &nb_item, &nb_remain, &result);
 	if (status != Success)
 		return;
 
@@ -472,7 +474,7 @@ static void fixLeaderProperties(WWindow *wwin)
 	Bool haveCommand;
 
 	classHint = XAllocClassHint();
-	clientHints = XGetWMHints(dpy, wwin->client_win);
+	clientHints = PropGetWMHints(wwin->client_win);
 	pid = wNETWMGetPidForWindow(wwin->client_win);
 	if (pid > 0)
 		haveCommand = GetCommandForPid(pid, &argv, &argc);
@@ -494,8 +496,8 @@ static void fixLeaderProperties(WWindow *wwin)
 		window = leaders[i];
 		if (window) {
 			if (XGetClassHint(dpy, window, classHint) == 0) {
-				classHint->res_name = wwin->wm_instance;
-				classHint->res_class = wwin->wm_class;
+				classHint->res_name = (char *)wwin->wm_instance;
+				classHint->res_class = (char *)wwin->wm_class;
 				XSetClassHint(dpy, window, classHint);
 			}
 			hints = XGetWMHints(dpy, window);
@@ -529,7 +531,7 @@ static void fixLeaderProperties(WWindow *wwin)
 		wfree(argv);
 }
 
-static Window createFakeWindowGroupLeader(WScreen *scr, Window win, char *instance, char *class)
+static Window createFakeWindowGroupLeader(WScreen *scr, Window win, const char *instance, const char *class)
 {
 	XClassHint *classHint;
 	XWMHints *hints;
@@ -540,8 +542,8 @@ static Window createFakeWindowGroupLeader(WScreen *scr, Window win, char *instan
 	leader = XCreateSimpleWindow(dpy, scr->root_win, 10, 10, 10, 10, 0, 0, 0);
 	/* set class hint */
 	classHint = XAllocClassHint();
-	classHint->res_name = instance;
-	classHint->res_class = class;
+	classHint->res_name = (char *)instance;
+	classHint->res_class = (char *)class;
 	XSetClassHint(dpy, leader, classHint);
 	XFree(classHint);
 
@@ -614,16 +616,21 @@ WWindow *wManageWindow(WScreen *scr, Window window)
 
 	/* mutex. */
 	XGrabServer(dpy);
+
+	/* the properties come back with the sync */
+	PropPrefetchProperties(window);
 	XSync(dpy, False);
 
 	/* make sure the window is still there */
 	if (!XGetWindowAttributes(dpy, window, &wattribs)) {
+		PropPrefetchDone();
 		XUngrabServer(dpy);
 		return NULL;
 	}
 
 	/* if it's an override-redirect, ignore it */
 	if (wattribs.override_redirect) {
+		PropPrefetchDone();
 		XUngrabServer(dpy);
 		return NULL;
 	}
@@ -632,6 +639,7 @@ WWindow *wManageWindow(WScreen *scr, Window window)
 
 	/* if it's startup and the window is unmapped, don't manage it */
 	if (scr->flags.startup && wm_state < 0 && wattribs.map_state == IsUnmapped) {
+		PropPrefetchDone();
 		XUngrabServer(dpy);
 		return NULL;
 	}
@@ -690,7 +698,7 @@ WWindow *wManageWindow(WScreen *scr, Window window)
 	if (wwin->client_leader != None)
 		wwin->main_window = wwin->client_leader;
 
-	wwin->wm_hints = XGetWMHints(dpy, window);
+	wwin->wm_hints = PropGetWMHints(window);
 
 	if (wwin->wm_hints) {
 		if (wwin->wm_hints->flags & StateHint) {
@@ -720,7 +728,7 @@ WWindow *wManageWindow(WScreen *scr, Window window)
 
 	PropGetProtocols(window, &wwin->protocols);
 
-	if (!XGetTransientForHint(dpy, window, &wwin->transient_for)) {
+	if (!PropGetTransientFor(window, &wwin->transient_for)) {
 		wwin->transient_for = None;
 	} else {
 		if (wwin->transient_for == None || wwin->transient_for == window) {
@@ -775,7 +783,8 @@ WWindow *wManageWindow(WScreen *scr, Window window)
         }
 
 	if (!withdraw && wwin->main_window && WFLAGP(wwin, shared_appicon)) {
-		char *buffer, *instance, *class;
+		const char *instance, *class;
+		char *buffer;
 		WFakeGroupLeader *fPtr;
 		int index;
 
@@ -820,11 +829,8 @@ WWindow *wManageWindow(WScreen *scr, Window window)
 			wwin->main_window = fPtr->leader;
 		}
 
-		if (instance)
-			free(instance);
-
-		if (class)
-			free(class);
+		WMReleaseInternedString(instance);
+		WMReleaseInternedString(class);
 #undef ADEQUATE
 	}
 
@@ -1112,6 +1118,9 @@ WWindow *wManageWindow(WScreen *scr, Window window)
 
 	wNETWMCheckInitialFrameState(wwin);
 
+	/* from here on the properties may be changed by ourselves */
+	PropPrefetchDone();
+
 	/* setup button images */
 	wWindowUpdateButtonImages(wwin);
 
@@ -1989,6 +1998,7 @@ void wWindowChangeWorkspace(WWindow *wwin, int workspace)
 	if (!IS_OMNIPRESENT(wwin)) {
 		int oldWorkspace = wwin->frame->workspace;
 		wwin->frame->workspace = workspace;
+		wFrameGridUpdate(wwin);
 		WMPostNotificationName(WMNChangedWorkspace, wwin, (void *)(uintptr_t) oldWorkspace);
 	}
 
@@ -2132,6 +2142,8 @@ void wWindowConfigure(WWindow *wwin, int req_x, int req_y, int req_width, int re
 		wWindowSetShape(wwin);
 #endif
 
+	wFrameGridUpdate(wwin);
+
 	if (synth_notify)
 		wWindowSynthConfigureNotify(wwin);
 
@@ -2169,6 +2181,7 @@ void wWindowMove(WWindow *wwin, int req_x, int req_y)
 
 	wwin->frame_x = req_x;
 	wwin->frame_y = req_y;
+	wFrameGridUpdate(wwin);
 
 #ifdef CONFIGURE_WINDOW_WHILE_MOVING
 	if (synth_notify)
@@ -2355,6 +2368,8 @@ void wWindowConfigureBorders(WWindow *wwin)
 		if (w_global.xext.shape.supported && wwin->flags.shaped)
 			wWindowSetShape(wwin);
 #endif
+
+		wFrameGridUpdate(wwin);
 	}
 }
 
@@ -2637,10 +2652,8 @@ WMagicNumber wWindowAddSavedState(const char *instance, const char *class,
 
 	memset(wstate, 0, sizeof(WWindowState));
 	wstate->pid = pid;
-	if (instance)
-		wstate->instance = wstrdup(instance);
-	if (class)
-		wstate->class = wstrdup(class);
+	wstate->instance = WMInternString(instance);
+	wstate->class = WMInternString(class);
 	if (command)
 		wstate->command = wstrdup(command);
 	wstate->state = state;
@@ -2667,7 +2680,8 @@ static inline int is_same(const char *x, const char *y)
 
 WMagicNumber wWindowGetSavedState(Window win)
 {
-	char *instance, *class, *command = NULL;
+	const char *instance, *class;
+	char *command = NULL;
 	WWindowState *wstate = windowState;
 
 	if (!wstate)
@@ -2679,8 +2693,9 @@ WMagicNumber wWindowGetSavedState(Window win)
 
 	if (PropGetWMClass(win, &class, &instance)) {
 		while (wstate) {
-			if (is_same(instance, wstate->instance) &&
-			    is_same(class, wstate->class) &&
+			/* the names are interned, so they can be compared directly */
+			if (instance == wstate->instance &&
+			    class == wstate->class &&
 			    is_same(command, wstate->command)) {
 				break;
 			}
@@ -2692,10 +2707,8 @@ WMagicNumber wWindowGetSavedState(Window win)
 
 	if (command)
 		wfree(command);
-	if (instance)
-		free(instance);
-	if (class)
-		free(class);
+	WMReleaseInternedString(instance);
+	WMReleaseInternedString(class);
 
 	return wstate;
 }
@@ -2751,11 +2764,8 @@ void wWindowDeleteSavedStatesForPID(pid_t pid)
 
 static void release_wwindowstate(WWindowState *wstate)
 {
-	if (wstate->instance)
-		wfree(wstate->instance);
-
-	if (wstate->class)
-		wfree(wstate->class);
+	WMReleaseInternedString(wstate->instance);
+	WMReleaseInternedString(wstate->class);
 
 	if (wstate->command)
 		wfree(wstate->command);
@@ -189,6 +189,13 @@ typedef struct WWindow {
 	struct WFrameWindow *frame;		/* the frame window */
 	int frame_x, frame_y;			/* position of the frame in root*/
 
+	struct {
+		struct WFrameGrid *grid;	/* spatial index the frame is in */
+		int x1, y1, x2, y2;		/* cells covered by the frame */
+		int edges[4];			/* edges of the frame, see framegrid.h */
+		unsigned int stamp;		/* last query that returned it */
+	} grid;
+
 	struct {
 		int x, y;
 		unsigned int width, height;	/* original geometry of the window */
@@ -214,8 +221,8 @@ typedef struct WWindow {
 
 	XSizeHints *normal_hints;		/* WM_NORMAL_HINTS */
 	XWMHints *wm_hints;			/* WM_HINTS (optional) */
-	char *wm_instance;			/* instance of WM_CLASS */
-	char *wm_class;				/* class of WM_CLASS */
+	const char *wm_instance;		/* instance of WM_CLASS, interned */
+	const char *wm_class;			/* class of WM_CLASS, interned */
 	GNUstepWMAttributes *wm_gnustep_attr;	/* GNUstep window attributes */
 
 	int state;				/* state as in ICCCM */
@@ -317,8 +324,8 @@ typedef struct WSavedState {
 } WSavedState;
 
 typedef struct WWindowState {
-    char *instance;
-    char *class;
+    const char *instance;	       /* interned */
+    const char *class;		       /* interned */
     char *command;
     pid_t pid;
     WSavedState *state;
@@ -702,6 +702,7 @@ static void saveSettings(WMWidget *button, void *client_data)
 
 	WMReleasePropList(key);
 	WMReleasePropList(winDic);
+	wDefaultFlushWindowAttributes();
 
 	UpdateDomainFile(db);
 
@@ -876,7 +877,7 @@ static void revertSettings(WMWidget *button, void *client_data)
 	WWindow *wwin = panel->inspected;
 	WApplication *wapp = wApplicationOf(wwin->main_window);
 	int i, n, workspace, level;
-	char *wm_instance = NULL, *wm_class = NULL;
+	const char *wm_instance = NULL, *wm_class = NULL;
 
 	/* Parameter not used, but tell the compiler that it is ok */
 	(void) button;
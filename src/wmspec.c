@@ -48,6 +48,7 @@
 #include "stacking.h"
 #include "xinerama.h"
 #include "properties.h"
+#include "stats.h"
 
 
 /* Root Window Properties */
@@ -247,19 +248,41 @@ static atomitem_t atomNames[] = {
 
 static void observer(void *self, WMNotification *notif);
 static void wsobserver(void *self, WMNotification *notif);
+static void stackingObserver(void *self, WMNotification *notif);
 
-static void updateClientList(WScreen *scr);
-static void updateClientListStacking(WScreen *scr, WWindow *);
+static void markDirty(WScreen *scr, int property);
+static void flushProperties(void *cdata);
 
-static void updateWorkspaceNames(WScreen *scr);
 static void updateCurrentWorkspace(WScreen *scr);
 static void updateWorkspaceCount(WScreen *scr);
 static void wNETWMShowingDesktop(WScreen *scr, Bool show);
 
+/*
+ * The root window properties that pagers and taskbars read whenever they
+ * change. They are only marked dirty when something happens and written
+ * once the event queue is empty, and not at all if they did not change.
+ */
+enum {
+	NET_CLIENT_LIST,
+	NET_CLIENT_LIST_STACKING,
+	NET_WORKAREA,
+	NET_DESKTOP_NAMES,
+	NET_ACTIVE_WINDOW,
+
+	NET_DIRTY_PROPERTIES
+};
+
 typedef struct NetData {
 	WScreen *scr;
 	WReservedArea *strut;
 	WWindow **show_desktop;
+
+	unsigned int dirty;		/* bit mask of the properties to write */
+	WMHandlerID flushID;
+	struct {
+		unsigned char *value;	/* what was last written */
+		int length;		/* in bytes, -1 if nothing was */
+	} written[NET_DIRTY_PROPERTIES];
 } NetData;
 
 static void setSupportedHints(WScreen *scr)
@@ -461,9 +484,9 @@ RImage *get_window_image_from_x11(Window window)
 	unsigned long *property, *data;
 
 	/* Get the icon from X11 Window */
-	if (XGetWindowProperty(dpy, window, net_wm_icon, 0L, LONG_MAX,
-			       False, XA_CARDINAL, &type, &format, &items, &rest,
-			       (unsigned char **)&property) != Success || !property)
+	if (PropGetWindowProperty(window, net_wm_icon, 0L, LONG_MAX,
+				  XA_CARDINAL, &type, &format, &items, &rest,
+				  (unsigned char **)&property) != Success || !property)
 		return NULL;
 
 	if (type != XA_CARDINAL || format != 32 || items < 2) {
@@ -522,9 +545,9 @@ static void updateWindowOpacity(WWindow *wwin)
 
 	/* We don't care about this ourselves, but other programs need us to copy
 	 * this to the frame window. */
-	if (XGetWindowProperty(dpy, wwin->client_win, net_wm_window_opacity, 0L, 1L,
-				False, XA_CARDINAL, &type, &format, &items, &rest,
-				(unsigned char **)&property) != Success)
+	if (PropGetWindowProperty(wwin->client_win, net_wm_window_opacity, 0L, 1L,
+				  XA_CARDINAL, &type, &format, &items, &rest,
+				  (unsigned char **)&property) != Success)
 		return;
 
 	if (type == None) {
@@ -618,11 +641,25 @@ void wNETWMInitStuff(WScreen *scr)
 	data->scr = scr;
 	data->strut = NULL;
 	data->show_desktop = NULL;
+	for (i = 0; i < NET_DIRTY_PROPERTIES; i++)
+		data->written[i].length = -1;
 
 	scr->netdata = data;
 
 	setSupportedHints(scr);
 
+	PropAddPrefetchAtom(net_wm_name);
+	PropAddPrefetchAtom(net_wm_pid);
+	PropAddPrefetchAtom(net_wm_desktop);
+	PropAddPrefetchAtom(net_wm_state);
+	PropAddPrefetchAtom(net_wm_window_type);
+	PropAddPrefetchAtom(net_wm_strut);
+	PropAddPrefetchAtom(net_wm_strut_partial);
+	PropAddPrefetchAtom(net_wm_handled_icons);
+	PropAddPrefetchAtom(net_wm_icon_geometry);
+	PropAddPrefetchAtom(net_wm_icon);
+	PropAddPrefetchAtom(net_wm_window_opacity);
+
 	WMAddNotificationObserver(observer, data, WMNManaged, NULL);
 	WMAddNotificationObserver(observer, data, WMNUnmanaged, NULL);
 	WMAddNotificationObserver(observer, data, WMNChangedWorkspace, NULL);
@@ -636,19 +673,28 @@ void wNETWMInitStuff(WScreen *scr)
 	WMAddNotificationObserver(wsobserver, data, WMNWorkspaceChanged, NULL);
 	WMAddNotificationObserver(wsobserver, data, WMNWorkspaceNameChanged, NULL);
 
-	updateClientList(scr);
-	updateClientListStacking(scr, NULL);
+	WMAddNotificationObserver(stackingObserver, data, WMNChangedStacking, NULL);
+	WMAddNotificationObserver(stackingObserver, data, WMNResetStacking, NULL);
+
 	updateWorkspaceCount(scr);
-	updateWorkspaceNames(scr);
 	updateShowDesktop(scr, False);
 
 	wScreenUpdateUsableArea(scr);
+
+	markDirty(scr, NET_CLIENT_LIST);
+	markDirty(scr, NET_CLIENT_LIST_STACKING);
+	markDirty(scr, NET_DESKTOP_NAMES);
 }
 
 void wNETWMCleanup(WScreen *scr)
 {
 	int i;
 
+	if (scr->netdata && scr->netdata->flushID) {
+		WMDeleteIdleHandler(scr->netdata->flushID);
+		scr->netdata->flushID = NULL;
+	}
+
 	for (i = 0; i < wlengthof(atomNames); i++)
 		XDeleteProperty(dpy, scr->root_win, *atomNames[i].atom);
 }
@@ -701,14 +747,53 @@ void wNETWMUpdateActions(WWindow *wwin, Bool del)
 
 void wNETWMUpdateWorkarea(WScreen *scr)
 {
-	WArea total_usable;
-	int nb_workspace;
-
 	if (!scr->netdata) {
 		/* If the _NET_xxx were not initialised, it not necessary to do anything */
 		return;
 	}
 
+	markDirty(scr, NET_WORKAREA);
+}
+
+/* Writes the property if it is not what was last written there */
+static void writeProperty(WScreen *scr, int property, Atom atom, Atom type, int format,
+			  const void *value, int nitems)
+{
+	NetData *data = scr->netdata;
+	/* Xlib wants longs for 32 bits properties */
+	int length = nitems * (format == 32 ? sizeof(long) : format / 8);
+
+	if (data->written[property].length == length
+	    && memcmp(data->written[property].value, value, length) == 0) {
+		wStatsAddPropertyWrite(False);
+		return;
+	}
+
+	XChangeProperty(dpy, scr->root_win, atom, type, format, PropModeReplace,
+			(const unsigned char *)value, nitems);
+	wStatsAddPropertyWrite(True);
+
+	data->written[property].value = wrealloc(data->written[property].value, WMAX(length, 1));
+	memcpy(data->written[property].value, value, length);
+	data->written[property].length = length;
+}
+
+static void markDirty(WScreen *scr, int property)
+{
+	NetData *data = scr->netdata;
+
+	wStatsAddPropertyRequest();
+
+	data->dirty |= 1 << property;
+	if (!data->flushID)
+		data->flushID = WMAddIdleHandler(flushProperties, scr);
+}
+
+static void updateWorkarea(WScreen *scr)
+{
+	WArea total_usable;
+	int nb_workspace;
+
 	if (!scr->usableArea) {
 		/* If we don't have any info, we fall back on using the complete screen area */
 		total_usable.x1 = 0;
@@ -759,8 +844,8 @@ void wNETWMUpdateWorkarea(WScreen *scr)
 			property_value[4 * i + 3] = total_usable.y2 - total_usable.y1;
 		}
 
-		XChangeProperty(dpy, scr->root_win, net_workarea, XA_CARDINAL, 32, PropModeReplace,
-		                (unsigned char *) property_value, nb_workspace * 4);
+		writeProperty(scr, NET_WORKAREA, net_workarea, XA_CARDINAL, 32,
+			      property_value, nb_workspace * 4);
 	}
 }
 
@@ -815,50 +900,34 @@ static void updateClientList(WScreen *scr)
 		windows[count++] = wwin->client_win;
 		wwin = wwin->prev;
 	}
-	XChangeProperty(dpy, scr->root_win, net_client_list, XA_WINDOW, 32,
-			PropModeReplace, (unsigned char *)windows, count);
+	writeProperty(scr, NET_CLIENT_LIST, net_client_list, XA_WINDOW, 32, windows, count);
 
 	wfree(windows);
-	XFlush(dpy);
 }
 
-static void updateClientListStacking(WScreen *scr, WWindow *wwin_excl)
+static void updateClientListStacking(WScreen *scr)
 {
-	WWindow *wwin;
-	Window *client_list, *client_list_reverse;
-	int client_count, i;
+	Window *client_list;
+	int first;
 	WCoreWindow *tmp;
 	WMBagIterator iter;
 
-	/* update client list */
-	i = scr->window_count + 1;
-	client_list = (Window *) wmalloc(sizeof(Window) * i);
-	client_list_reverse = (Window *) wmalloc(sizeof(Window) * i);
+	/* the property is bottom first, fill it from the end */
+	first = scr->window_count;
+	client_list = (Window *) wmalloc(sizeof(Window) * (first + 1));
 
-	client_count = 0;
 	WM_ETARETI_BAG(scr->stacking_list, tmp, iter) {
 		while (tmp) {
-			wwin = wWindowFor(tmp->window);
-			/* wwin_excl is a window to exclude from the list
-			   (e.g. it's now unmanaged) */
-			if (wwin && (wwin != wwin_excl))
-				client_list[client_count++] = wwin->client_win;
+			if (tmp->descriptor.parent_type == WCLASS_WINDOW && first > 0)
+				client_list[--first] = ((WWindow *) tmp->descriptor.parent)->client_win;
 			tmp = tmp->stacking->under;
 		}
 	}
 
-	for (i = 0; i < client_count; i++) {
-		Window w = client_list[client_count - i - 1];
-		client_list_reverse[i] = w;
-	}
-
-	XChangeProperty(dpy, scr->root_win, net_client_list_stacking, XA_WINDOW, 32,
-			PropModeReplace, (unsigned char *)client_list_reverse, client_count);
+	writeProperty(scr, NET_CLIENT_LIST_STACKING, net_client_list_stacking, XA_WINDOW, 32,
+		      client_list + first, scr->window_count - first);
 
 	wfree(client_list);
-	wfree(client_list_reverse);
-
-	XFlush(dpy);
 }
 
 static void updateWorkspaceCount(WScreen *scr)
@@ -895,8 +964,7 @@ static void updateWorkspaceNames(WScreen *scr)
 		len += (curr_size + 1);
 	}
 
-	XChangeProperty(dpy, scr->root_win, net_desktop_names, utf8_string, 8,
-			PropModeReplace, (unsigned char *)buf, len);
+	writeProperty(scr, NET_DESKTOP_NAMES, net_desktop_names, utf8_string, 8, buf, len);
 }
 
 static void updateFocusHint(WScreen *scr)
@@ -908,8 +976,30 @@ static void updateFocusHint(WScreen *scr)
 	else
 		window = scr->focused_window->client_win;
 
-	XChangeProperty(dpy, scr->root_win, net_active_window, XA_WINDOW, 32,
-			PropModeReplace, (unsigned char *)&window, 1);
+	writeProperty(scr, NET_ACTIVE_WINDOW, net_active_window, XA_WINDOW, 32, &window, 1);
+}
+
+static void flushProperties(void *cdata)
+{
+	WScreen *scr = (WScreen *) cdata;
+	NetData *data = scr->netdata;
+	unsigned int dirty = data->dirty;
+
+	data->dirty = 0;
+	data->flushID = NULL;
+
+	if (dirty & (1 << NET_CLIENT_LIST))
+		updateClientList(scr);
+	if (dirty & (1 << NET_CLIENT_LIST_STACKING))
+		updateClientListStacking(scr);
+	if (dirty & (1 << NET_WORKAREA))
+		updateWorkarea(scr);
+	if (dirty & (1 << NET_DESKTOP_NAMES))
+		updateWorkspaceNames(scr);
+	if (dirty & (1 << NET_ACTIVE_WINDOW))
+		updateFocusHint(scr);
+
+	XFlush(dpy);
 }
 
 static void updateWorkspaceHint(WWindow *wwin, Bool fake, Bool del)
@@ -981,12 +1071,12 @@ static Bool updateStrut(WScreen *scr, Window w, Bool adding)
 		unsigned long nitems_ret, bytes_after_ret;
 		long *data = NULL;
 
-		if ((XGetWindowProperty(dpy, w, net_wm_strut, 0, 4, False,
-				       XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
-				       &bytes_after_ret, (unsigned char **)&data) == Success && data) ||
-		    ((XGetWindowProperty(dpy, w, net_wm_strut_partial, 0, 12, False,
-				       XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
-				       &bytes_after_ret, (unsigned char **)&data) == Success && data))) {
+		if ((PropGetWindowProperty(w, net_wm_strut, 0, 4,
+					   XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
+					   &bytes_after_ret, (unsigned char **)&data) == Success && data) ||
+		    ((PropGetWindowProperty(w, net_wm_strut_partial, 0, 12,
+					    XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
+					    &bytes_after_ret, (unsigned char **)&data) == Success && data))) {
 
 			/* XXX: This is strictly incorrect in the case of net_wm_strut_partial...
 			 * Discard the start and end properties from the partial strut and treat it as
@@ -1348,9 +1438,9 @@ static void updateWindowType(WWindow *wwin)
 	unsigned long nitems_ret, bytes_after_ret;
 	long *data = NULL;
 
-	if (XGetWindowProperty(dpy, wwin->client_win, net_wm_window_type, 0, 1,
-			       False, XA_ATOM, &type_ret, &fmt_ret, &nitems_ret,
-			       &bytes_after_ret, (unsigned char **)&data) == Success && data) {
+	if (PropGetWindowProperty(wwin->client_win, net_wm_window_type, 0, 1,
+				  XA_ATOM, &type_ret, &fmt_ret, &nitems_ret,
+				  &bytes_after_ret, (unsigned char **)&data) == Success && data) {
 
 		int i;
 		Atom *type = (Atom *) data;
@@ -1377,9 +1467,9 @@ void wNETWMCheckClientHints(WWindow *wwin, int *layer, int *workspace)
 	unsigned long nitems_ret, bytes_after_ret;
 	long *data = NULL;
 
-	if (XGetWindowProperty(dpy, wwin->client_win, net_wm_desktop, 0, 1, False,
-			       XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
-			       &bytes_after_ret, (unsigned char **)&data) == Success && data) {
+	if (PropGetWindowProperty(wwin->client_win, net_wm_desktop, 0, 1,
+				  XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
+				  &bytes_after_ret, (unsigned char **)&data) == Success && data) {
 
 		long desktop = *data;
 		XFree(data);
@@ -1390,9 +1480,9 @@ void wNETWMCheckClientHints(WWindow *wwin, int *layer, int *workspace)
 			*workspace = desktop;
 	}
 
-	if (XGetWindowProperty(dpy, wwin->client_win, net_wm_state, 0, 1, False,
-			       XA_ATOM, &type_ret, &fmt_ret, &nitems_ret,
-			       &bytes_after_ret, (unsigned char **)&data) == Success && data) {
+	if (PropGetWindowProperty(wwin->client_win, net_wm_state, 0, 1,
+				  XA_ATOM, &type_ret, &fmt_ret, &nitems_ret,
+				  &bytes_after_ret, (unsigned char **)&data) == Success && data) {
 
 		Atom *state = (Atom *) data;
 		for (i = 0; i < nitems_ret; ++i)
@@ -1401,9 +1491,9 @@ void wNETWMCheckClientHints(WWindow *wwin, int *layer, int *workspace)
 		XFree(data);
 	}
 
-	if (XGetWindowProperty(dpy, wwin->client_win, net_wm_window_type, 0, 1, False,
-			       XA_ATOM, &type_ret, &fmt_ret, &nitems_ret,
-			       &bytes_after_ret, (unsigned char **)&data) == Success && data) {
+	if (PropGetWindowProperty(wwin->client_win, net_wm_window_type, 0, 1,
+				  XA_ATOM, &type_ret, &fmt_ret, &nitems_ret,
+				  &bytes_after_ret, (unsigned char **)&data) == Success && data) {
 
 		Atom *type = (Atom *) data;
 		for (i = 0; i < nitems_ret; ++i) {
@@ -1429,9 +1519,9 @@ static Bool updateNetIconInfo(WWindow *wwin)
 	Bool hasState = False;
 	Bool old_state = wwin->flags.net_handle_icon;
 
-	if (XGetWindowProperty(dpy, wwin->client_win, net_wm_handled_icons, 0, 1, False,
-			       XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
-			       &bytes_after_ret, (unsigned char **)&data) == Success && data) {
+	if (PropGetWindowProperty(wwin->client_win, net_wm_handled_icons, 0, 1,
+				  XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
+				  &bytes_after_ret, (unsigned char **)&data) == Success && data) {
 		long handled = *data;
 		wwin->flags.net_handle_icon = (handled != 0);
 		XFree(data);
@@ -1441,9 +1531,9 @@ static Bool updateNetIconInfo(WWindow *wwin)
 		wwin->flags.net_handle_icon = False;
 	}
 
-	if (XGetWindowProperty(dpy, wwin->client_win, net_wm_icon_geometry, 0, 4, False,
-			       XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
-			       &bytes_after_ret, (unsigned char **)&data) == Success && data) {
+	if (PropGetWindowProperty(wwin->client_win, net_wm_icon_geometry, 0, 4,
+				  XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
+				  &bytes_after_ret, (unsigned char **)&data) == Success && data) {
 
 #ifdef NETWM_PROPER
 		if (wwin->flags.net_handle_icon)
@@ -1692,9 +1782,9 @@ int wNETWMGetPidForWindow(Window window)
 	long *data = NULL;
 	int pid;
 
-	if (XGetWindowProperty(dpy, window, net_wm_pid, 0, 1, False,
-			       XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
-			       &bytes_after_ret, (unsigned char **)&data) == Success && data) {
+	if (PropGetWindowProperty(window, net_wm_pid, 0, 1,
+				  XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
+				  &bytes_after_ret, (unsigned char **)&data) == Success && data) {
 		pid = *data;
 		XFree(data);
 	} else {
@@ -1746,30 +1836,27 @@ static void observer(void *self, WMNotification *notif)
 	NetData *ndata = (NetData *) self;
 
 	if (strcmp(name, WMNManaged) == 0 && wwin) {
-		updateClientList(wwin->screen_ptr);
-		updateClientListStacking(wwin->screen_ptr, NULL);
+		markDirty(wwin->screen_ptr, NET_CLIENT_LIST);
+		markDirty(wwin->screen_ptr, NET_CLIENT_LIST_STACKING);
 		updateStateHint(wwin, True, False);
 
 		updateStrut(wwin->screen_ptr, wwin->client_win, False);
 		updateStrut(wwin->screen_ptr, wwin->client_win, True);
 		wScreenUpdateUsableArea(wwin->screen_ptr);
 	} else if (strcmp(name, WMNUnmanaged) == 0 && wwin) {
-		updateClientList(wwin->screen_ptr);
-		updateClientListStacking(wwin->screen_ptr, wwin);
+		/* the window is out of the lists by the time they are written */
+		markDirty(wwin->screen_ptr, NET_CLIENT_LIST);
+		markDirty(wwin->screen_ptr, NET_CLIENT_LIST_STACKING);
 		updateWorkspaceHint(wwin, False, True);
 		updateStateHint(wwin, False, True);
 		wNETWMUpdateActions(wwin, True);
 
 		updateStrut(wwin->screen_ptr, wwin->client_win, False);
 		wScreenUpdateUsableArea(wwin->screen_ptr);
-	} else if (strcmp(name, WMNResetStacking) == 0 && wwin) {
-		updateClientListStacking(wwin->screen_ptr, NULL);
-		updateStateHint(wwin, False, False);
 	} else if (strcmp(name, WMNChangedStacking) == 0 && wwin) {
-		updateClientListStacking(wwin->screen_ptr, NULL);
 		updateStateHint(wwin, False, False);
 	} else if (strcmp(name, WMNChangedFocus) == 0) {
-		updateFocusHint(ndata->scr);
+		markDirty(ndata->scr, NET_ACTIVE_WINDOW);
 	} else if (strcmp(name, WMNChangedWorkspace) == 0 && wwin) {
 		updateWorkspaceHint(wwin, False, False);
 		updateStateHint(wwin, True, False);
@@ -1778,6 +1865,20 @@ static void observer(void *self, WMNotification *notif)
 	}
 }
 
+/*
+ * A single user action can restack dozens of windows, the stacking list
+ * is written once they are all done.
+ */
+static void stackingObserver(void *self, WMNotification *notif)
+{
+	NetData *ndata = (NetData *) self;
+
+	/* Parameter not used, but tell the compiler that it is ok */
+	(void) notif;
+
+	markDirty(ndata->scr, NET_CLIENT_LIST_STACKING);
+}
+
 static void wsobserver(void *self, WMNotification *notif)
 {
 	WScreen *scr = (WScreen *) WMGetNotificationObject(notif);
@@ -1788,16 +1889,16 @@ static void wsobserver(void *self, WMNotification *notif)
 
 	if (strcmp(name, WMNWorkspaceCreated) == 0) {
 		updateWorkspaceCount(scr);
-		updateWorkspaceNames(scr);
+		markDirty(scr, NET_DESKTOP_NAMES);
 		wNETWMUpdateWorkarea(scr);
 	} else if (strcmp(name, WMNWorkspaceDestroyed) == 0) {
 		updateWorkspaceCount(scr);
-		updateWorkspaceNames(scr);
+		markDirty(scr, NET_DESKTOP_NAMES);
 		wNETWMUpdateWorkarea(scr);
 	} else if (strcmp(name, WMNWorkspaceChanged) == 0) {
 		updateCurrentWorkspace(scr);
 	} else if (strcmp(name, WMNWorkspaceNameChanged) == 0) {
-		updateWorkspaceNames(scr);
+		markDirty(scr, NET_DESKTOP_NAMES);
 	}
 }
 
@@ -45,6 +45,7 @@
 #include "dock.h"
 #include "actions.h"
 #include "workspace.h"
+#include "framegrid.h"
 #include "appicon.h"
 #include "wmspec.h"
 #include "xinerama.h"
@@ -107,6 +108,8 @@ int wWorkspaceNew(WScreen *scr)
 		if (!wPreferences.flags.noclip)
 			wspace->clip = wDockCreate(scr, WM_CLIP, NULL);
 
+		wspace->grid = wFrameGridCreate(scr);
+
 		list = wmalloc(sizeof(WWorkspace *) * scr->workspace_count);
 
 		for (i = 0; i < scr->workspace_count - 1; i++)
@@ -167,6 +170,7 @@ Bool wWorkspaceDelete(WScreen * scr, int workspace)
 				wfree(scr->workspaces[i]->name);
 			if (scr->workspaces[i]->map)
 				RReleaseImage(scr->workspaces[i]->map);
+			wFrameGridDestroy(scr->workspaces[i]->grid);
 			wfree(scr->workspaces[i]);
 		}
 	}
@@ -175,6 +179,12 @@ Bool wWorkspaceDelete(WScreen * scr, int workspace)
 
 	scr->workspace_count--;
 
+	/* omnipresent windows may have been left in the deleted grid */
+	for (tmp = scr->focused_window; tmp; tmp = tmp->prev) {
+		if (!tmp->grid.grid)
+			wFrameGridUpdate(tmp);
+	}
+
 	/* update menu */
 	wWorkspaceMenuUpdate(scr, scr->workspace_menu);
 	/* clip workspace menu */
@@ -537,6 +547,7 @@ void wWorkspaceForceChange(WScreen * scr, int workspace)
 					WApplication *wapp = wApplicationOf(tmp->main_window);
 
 					tmp->frame->workspace = workspace;
+					wFrameGridUpdate(tmp);
 
 					if (wapp) {
 						wapp->last_workspace = workspace;
@@ -28,6 +28,7 @@ typedef struct WWorkspace {
     char *name;
     struct WDock *clip;
     RImage *map;
+    struct WFrameGrid *grid;	       /* frames of the windows in it */
 } WWorkspace;
 
 void wWorkspaceMake(WScreen *scr, int count);
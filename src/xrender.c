@@ -0,0 +1,292 @@
+/* xrender.c - textures drawn by the X server
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "wconfig.h"
+
+#ifdef USE_XRENDER
+
+#include <stdlib.h>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/Xrender.h>
+
+#include "WindowMaker.h"
+#include "screen.h"
+#include "texture.h"
+#include "xrender.h"
+
+/*
+ * The gradients are given to the server as linear gradients laid out like
+ * the ones wrlib renders, so instead of an image of the whole texture
+ * only a few color stops have to be sent. The reliefs are then drawn on
+ * top of them with the same lines as RBevelImage().
+ */
+
+static XRenderColor renderColor(const RColor *color)
+{
+	XRenderColor xcolor;
+
+	xcolor.red = color->red * 0x101;
+	xcolor.green = color->green * 0x101;
+	xcolor.blue = color->blue * 0x101;
+	xcolor.alpha = 0xffff;
+
+	return xcolor;
+}
+
+Picture wXRenderCreateTexture(WScreen *scr, WTexture *texture, int width, int height)
+{
+	XLinearGradient line;
+	XRenderPictureAttributes attributes;
+	XFixed *stops;
+	XRenderColor *colors;
+	RColor *pair[3], **list;
+	Picture picture;
+	int style, length, segment, count, i, n;
+
+	if (!w_global.xext.xrender.supported || width <= 0 || height <= 0)
+		return None;
+	if (!XRenderFindVisualFormat(dpy, scr->w_visual))
+		return None;
+
+	switch (texture->any.type) {
+	case WTEX_HGRADIENT:
+	case WTEX_MHGRADIENT:
+		style = RGRD_HORIZONTAL;
+		break;
+	case WTEX_VGRADIENT:
+	case WTEX_MVGRADIENT:
+		style = RGRD_VERTICAL;
+		break;
+	case WTEX_DGRADIENT:
+	case WTEX_MDGRADIENT:
+		style = RGRD_DIAGONAL;
+		break;
+	default:
+		return None;
+	}
+
+	if (texture->any.type == WTEX_HGRADIENT || texture->any.type == WTEX_VGRADIENT
+	    || texture->any.type == WTEX_DGRADIENT) {
+		pair[0] = &texture->gradient.color1;
+		pair[1] = &texture->gradient.color2;
+		pair[2] = NULL;
+		list = pair;
+	} else {
+		list = &texture->mgradient.colors[1];
+	}
+	for (count = 0; list[count] != NULL; count++)
+		;
+
+	/* wrlib does not make a diagonal of a single row or column */
+	if (style == RGRD_DIAGONAL && width == 1)
+		style = RGRD_VERTICAL;
+	else if (style == RGRD_DIAGONAL && height == 1)
+		style = RGRD_HORIZONTAL;
+
+	switch (style) {
+	case RGRD_HORIZONTAL:
+		length = width;
+		line.p1.x = XDoubleToFixed(0.5);
+		line.p1.y = 0;
+		line.p2.x = XDoubleToFixed(length + 0.5);
+		line.p2.y = 0;
+		break;
+
+	case RGRD_VERTICAL:
+		length = height;
+		line.p1.x = 0;
+		line.p1.y = XDoubleToFixed(0.5);
+		line.p2.x = 0;
+		line.p2.y = XDoubleToFixed(length + 0.5);
+		break;
+
+	default:
+		{
+			/*
+			 * Every row is the same horizontal gradient of 2 * width - 1
+			 * pixels, shifted left by (width - 1) / (height - 1) pixels
+			 * from the row above.
+			 */
+			double a = (double)(width - 1) / (double)(height - 1);
+			double k;
+
+			length = 2 * width - 1;
+			k = length / (1.0 + a * a);
+			line.p1.x = XDoubleToFixed(0.5);
+			line.p1.y = XDoubleToFixed(0.5);
+			line.p2.x = XDoubleToFixed(0.5 + k);
+			line.p2.y = XDoubleToFixed(0.5 + k * a);
+
+			if (count > 2 && count > height)
+				count = height;
+		}
+		break;
+	}
+	if (count > 2 && count > length)
+		count = length;
+
+	stops = wmalloc((count + 2) * sizeof(XFixed));
+	colors = wmalloc((count + 2) * sizeof(XRenderColor));
+
+	/* the colors are evenly spaced, what is left of the length takes the last one */
+	if (count == 1) {
+		stops[0] = XDoubleToFixed(0.0);
+		colors[0] = renderColor(list[0]);
+		n = 1;
+		segment = 0;
+	} else {
+		segment = length / (count - 1);
+		for (i = 0; i < count; i++) {
+			stops[i] = XDoubleToFixed((double)(i * segment) / length);
+			colors[i] = renderColor(list[i]);
+		}
+		n = count;
+	}
+	if (segment * (count - 1) < length) {
+		stops[n] = XDoubleToFixed(1.0);
+		colors[n] = colors[n - 1];
+		n++;
+	}
+
+	picture = XRenderCreateLinearGradient(dpy, &line, stops, colors, n);
+	wfree(stops);
+	wfree(colors);
+
+	attributes.repeat = RepeatPad;
+	XRenderChangePicture(dpy, picture, CPRepeat, &attributes);
+
+	return picture;
+}
+
+static void drawRelief(Picture picture, int width, int height, int relief)
+{
+	RColor light, dark, black;
+
+	if (width < 3 || height < 3)
+		return;
+
+	light.alpha = 0;
+	light.red = light.green = light.blue = 80;
+
+	dark.alpha = 0;
+	dark.red = dark.green = dark.blue = 40;
+
+	black.alpha = 255;
+	black.red = black.green = black.blue = 0;
+
+	switch (relief) {
+	case WREL_RAISED:
+		/* RBEV_RAISED2 */
+		wXRenderOperateLine(picture, RAddOperation, 0, 0, width - 1, 0, &light);
+		wXRenderOperateLine(picture, RAddOperation, 0, 1, 0, height - 1, &light);
+
+		wXRenderOperateLine(picture, RSubtractOperation, 0, height - 2, width - 3, height - 2, &dark);
+		wXRenderDrawLine(picture, 0, height - 1, width - 1, height - 1, &black);
+
+		wXRenderOperateLine(picture, RSubtractOperation, width - 2, 0, width - 2, height - 2, &dark);
+		wXRenderDrawLine(picture, width - 1, 0, width - 1, height - 2, &black);
+		break;
+
+	case WREL_MENUENTRY:
+		wXRenderOperateLine(picture, RAddOperation, 1, 0, width - 2, 0, &light);
+		wXRenderOperateLine(picture, RAddOperation, 0, 0, 0, height - 1, &light);
+
+		wXRenderOperateLine(picture, RSubtractOperation, width - 1, 0, width - 1, height - 1, &dark);
+		wXRenderOperateLine(picture, RSubtractOperation, 1, height - 2, width - 2, height - 2, &dark);
+
+		wXRenderDrawLine(picture, 0, height - 1, width - 1, height - 1, &black);
+		break;
+	}
+}
+
+Pixmap wXRenderCopyTexture(WScreen *scr, Picture texture, int x, int y, int width, int height,
+			   int relief, Picture *picture)
+{
+	Pixmap pixmap;
+	Picture dest;
+
+	pixmap = XCreatePixmap(dpy, scr->w_win, width, height, scr->w_depth);
+	dest = XRenderCreatePicture(dpy, pixmap, XRenderFindVisualFormat(dpy, scr->w_visual), 0, NULL);
+
+	XRenderComposite(dpy, PictOpSrc, texture, None, dest, x, y, 0, 0, 0, 0, width, height);
+	drawRelief(dest, width, height, relief);
+
+	if (picture)
+		*picture = dest;
+	else
+		XRenderFreePicture(dpy, dest);
+
+	return pixmap;
+}
+
+/* the lines are always horizontal or vertical, so they are rectangles */
+static void lineRect(int x0, int y0, int x1, int y1, int *x, int *y, unsigned *width, unsigned *height)
+{
+	*x = WMIN(x0, x1);
+	*y = WMIN(y0, y1);
+	*width = abs(x1 - x0) + 1;
+	*height = abs(y1 - y0) + 1;
+}
+
+void wXRenderOperateLine(Picture picture, int operation, int x0, int y0, int x1, int y1,
+			 const RColor *color)
+{
+	XRenderColor xcolor = renderColor(color);
+	int x, y;
+	unsigned width, height;
+
+	lineRect(x0, y0, x1, y1, &x, &y, &width, &height);
+
+	switch (operation) {
+	case RAddOperation:
+		XRenderFillRectangle(dpy, PictOpAdd, picture, &xcolor, x, y, width, height);
+		break;
+
+	case RSubtractOperation:
+		if (w_global.xext.xrender.blend) {
+			/* the difference with white inverts, and a - b = ~(~a + b) */
+			XRenderColor white = { 0xffff, 0xffff, 0xffff, 0xffff };
+
+			XRenderFillRectangle(dpy, PictOpDifference, picture, &white, x, y, width, height);
+			XRenderFillRectangle(dpy, PictOpAdd, picture, &xcolor, x, y, width, height);
+			XRenderFillRectangle(dpy, PictOpDifference, picture, &white, x, y, width, height);
+		} else {
+			/* darken about as much with some transparent black */
+			XRenderColor shade = { 0, 0, 0, xcolor.red };
+
+			XRenderFillRectangle(dpy, PictOpOver, picture, &shade, x, y, width, height);
+		}
+		break;
+	}
+}
+
+void wXRenderDrawLine(Picture picture, int x0, int y0, int x1, int y1, const RColor *color)
+{
+	XRenderColor xcolor = renderColor(color);
+	int x, y;
+	unsigned width, height;
+
+	lineRect(x0, y0, x1, y1, &x, &y, &width, &height);
+	XRenderFillRectangle(dpy, PictOpSrc, picture, &xcolor, x, y, width, height);
+}
+
+#endif  /* USE_XRENDER */
@@ -0,0 +1,57 @@
+/* xrender.h - textures drawn by the X server
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef WMXRENDER_H
+#define WMXRENDER_H
+
+#ifdef USE_XRENDER
+
+#include <X11/extensions/Xrender.h>
+
+#include "screen.h"
+#include "texture.h"
+
+/*
+ * Returns a picture with the texture at the given size, drawn by the
+ * server, or None if the texture has to be rendered with wrlib: the
+ * extension is missing or the texture is not a plain gradient.
+ * It is freed with XRenderFreePicture().
+ */
+Picture wXRenderCreateTexture(WScreen *scr, WTexture *texture, int width, int height);
+
+/*
+ * Copies the part of the texture at x, y in a new pixmap of the screen
+ * and gives it the relief, WREL_FLAT, WREL_RAISED or WREL_MENUENTRY.
+ * If picture is not NULL, it gets a picture of the pixmap to draw more
+ * in it, to be freed by the caller.
+ */
+Pixmap wXRenderCopyTexture(WScreen *scr, Picture texture, int x, int y, int width, int height,
+			   int relief, Picture *picture);
+
+/* like ROperateLine() and RDrawLine(), for horizontal and vertical lines */
+void wXRenderOperateLine(Picture picture, int operation, int x0, int y0, int x1, int y1,
+			 const RColor *color);
+
+void wXRenderDrawLine(Picture picture, int x0, int y0, int x1, int y1, const RColor *color);
+
+#endif  /* USE_XRENDER */
+
+#endif  /* WMXRENDER_H */